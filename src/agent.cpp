@@ -0,0 +1,347 @@
+#include "agent.h"
+
+#include <stdexcept>
+
+#include "belief.h"
+
+namespace wumpus {
+
+int Agent_view::index_of(int number) const
+{
+    for (int i = 0; i < num_rooms; ++i)
+        if (numbers[i] == number)
+            return i;
+    return -1;
+}
+
+Agent_view agent_view(const Game& game)
+{
+    const Hunt_state& hunt = game.get_state();
+    const int room = hunt.player_room();
+    std::array<int, connections_per_room> adjacent_rooms;
+    for (int i = 0; i < connections_per_room; ++i)
+        adjacent_rooms[i] = hunt.numbers[room_connections[room][i]];
+    return {hunt.numbers,
+            hunt.numbers[room],
+            adjacent_rooms,
+            hunt.arrows,
+            hunt.hazards.percepts()};
+}
+
+void Agent::begin_hunt(const Agent_view&)
+{
+}
+
+void Agent::on_event(Event)
+{
+}
+
+int play_hunt(Game& game, Agent& agent, Rng& rng, int max_turns)
+{
+    agent.begin_hunt(agent_view(game));
+    int turns = 0;
+    while (!game.is_hunt_over())
+    {
+        if (turns == max_turns)
+        {
+            game.quit();
+            break;
+        }
+        const Agent_action action = agent.next_action(agent_view(game), rng);
+        ++turns;
+        switch (action.type)
+        {
+        case Agent_action::Type::move:
+            if (game.can_move(action.targets[0]))
+                game.move(action.targets[0]);
+            break;
+        case Agent_action::Type::shoot:
+            if (game.can_shoot(action.targets))
+                game.shoot(action.targets);
+            break;
+        case Agent_action::Type::quit:
+            game.quit();
+            break;
+        }
+    }
+    return turns;
+}
+
+namespace {
+
+const Room_mask all_rooms = room_bit(num_rooms) - 1;
+
+Agent_action move_to(int room)
+{
+    return {Agent_action::Type::move, {{room, -1, -1}}};
+}
+
+Agent_action shoot_at(int room)
+{
+    return {Agent_action::Type::shoot, {{room, -1, -1}}};
+}
+
+// Returns one of the rooms in a non-empty mask, chosen uniformly.
+int random_room(Room_mask rooms, Rng& rng)
+{
+    int count = 0;
+    for (Room_mask rest = rooms; rest; rest &= rest - 1)
+        ++count;
+    for (int i = rng.uniform(0, count); i > 0; --i)
+        rooms &= rooms - 1;
+    return room_index(rooms);
+}
+
+// Wanders the cave at random and shoots into a random adjacent room whenever
+// it smells the wumpus.
+class Random_walker : public Agent
+{
+public:
+    Agent_action next_action(const Agent_view& view, Rng& rng) override
+    {
+        const int target =
+            view.adjacent_rooms[rng.uniform(0, connections_per_room)];
+        if (view.percepts.wumpus && view.arrows > 0)
+            return shoot_at(target);
+        return move_to(target);
+    }
+};
+
+// Keeps to rooms it has proved safe. A room without a draft or a rustle
+// clears its neighbours of pits and bats, and a room without a smell clears
+// them of the wumpus. The wumpus is next to every room it was smelled from
+// since it last moved; once that leaves one room, the mapper shoots there.
+// With no safe room left to explore, it shoots at a room the wumpus may be
+// in, or else steps into a room it knows nothing of.
+class Cautious_mapper : public Agent
+{
+public:
+    void begin_hunt(const Agent_view&) override
+    {
+        visited = 0;
+        hazard_free = 0;
+        known_bats = 0;
+        last_move = -1;
+        forget_wumpus();
+    }
+
+    void on_event(Event event) override
+    {
+        // Only the first carry starts from a room the mapper knows.
+        if (event == Event::bat_carried && last_move >= 0)
+            known_bats |= room_bit(last_move);
+        else if (event == Event::wumpus_moved)
+            forget_wumpus();
+        last_move = -1;
+    }
+
+    Agent_action next_action(const Agent_view& view, Rng& rng) override
+    {
+        const int room = view.index_of(view.player_room);
+        observe(room, view.percepts);
+
+        const Room_mask adjacent = adjacency_masks[room];
+        const Room_mask suspects = wumpus_possible & ~wumpus_free & adjacent;
+        const Room_mask safe =
+            adjacent & hazard_free & wumpus_free & ~known_bats;
+        const bool can_shoot = view.percepts.wumpus && view.arrows > 0;
+        if (can_shoot && suspects && !(suspects & (suspects - 1)))
+            return shoot_at(view.numbers[room_index(suspects)]);
+        if (can_shoot && suspects && !(safe & ~visited))
+            return shoot_at(view.numbers[random_room(suspects, rng)]);
+
+        // Explore next door if it is safe, else walk the safe rooms towards
+        // one left to explore, else step into the unknown.
+        const Room_mask unexplored =
+            hazard_free & wumpus_free & ~known_bats & ~visited;
+        Room_mask choices = safe & ~visited;
+        if (!choices && unexplored)
+            choices = safe;
+        if (!choices)
+            choices = adjacent & ~known_bats & ~visited;
+        if (!choices)
+            choices = adjacent & ~known_bats;
+        if (!choices)
+            choices = adjacent;
+        last_move = random_room(choices, rng);
+        return move_to(view.numbers[last_move]);
+    }
+
+private:
+    Room_mask visited;
+    // The rooms proved free of pits and bats.
+    Room_mask hazard_free;
+    // The rooms proved free of the wumpus, and those it may be in, since it
+    // last moved.
+    Room_mask wumpus_free;
+    Room_mask wumpus_possible;
+    Room_mask known_bats;
+    // The room of the last move, until the game has answered it.
+    int last_move;
+
+    void observe(int room, const Percepts& percepts)
+    {
+        const Room_mask adjacent = adjacency_masks[room];
+        visited |= room_bit(room);
+        hazard_free |= room_bit(room);
+        wumpus_free |= room_bit(room);
+        if (!percepts.bat && !percepts.pit)
+            hazard_free |= adjacent;
+        if (percepts.wumpus)
+            wumpus_possible &= adjacent;
+        else
+            wumpus_free |= adjacent;
+    }
+
+    void forget_wumpus()
+    {
+        wumpus_free = 0;
+        wumpus_possible = all_rooms;
+    }
+};
+
+// Tracks the exact posterior over hazard layouts. It shoots along the
+// neighbour most likely to kill the wumpus once that chance is high enough,
+// and otherwise moves to the neighbour least likely to end the hunt,
+// preferring rooms it has visited less.
+class Belief_shooter : public Agent
+{
+public:
+    void begin_hunt(const Agent_view& view) override
+    {
+        belief.reset(view.index_of(view.player_room));
+        visits.fill(0);
+        last = Last_action::none;
+        carried = false;
+        wumpus_moved = false;
+    }
+
+    void on_event(Event event) override
+    {
+        if (event == Event::bat_carried)
+            carried = true;
+        else if (event == Event::wumpus_moved)
+            wumpus_moved = true;
+    }
+
+    Agent_action next_action(const Agent_view& view, Rng& rng) override
+    {
+        const int room = view.index_of(view.player_room);
+        update(room, view.percepts);
+        ++visits[room];
+        const Hazard_probabilities probabilities = belief.probabilities();
+
+        // Ties go to the first neighbour from a random start.
+        const int start = rng.uniform(0, connections_per_room);
+        if (view.arrows > 0)
+        {
+            double best_kill = 0;
+            int best_target = -1;
+            for (int i = 0; i < connections_per_room; ++i)
+            {
+                const int target =
+                    room_connections[room][(start + i) % connections_per_room];
+                const Arrow_odds odds = arrow_odds(room, {{target, -1, -1}});
+                double kill = 0;
+                for (int wumpus = 0; wumpus < num_rooms; ++wumpus)
+                    kill += probabilities.wumpus[wumpus] * odds.kill[wumpus];
+                if (kill > best_kill)
+                {
+                    best_kill = kill;
+                    best_target = target;
+                }
+            }
+            if (best_kill >= shoot_threshold)
+            {
+                last = Last_action::shoot;
+                last_room = room;
+                last_path = {{best_target, -1, -1}};
+                return shoot_at(view.numbers[best_target]);
+            }
+        }
+
+        double least_danger = 0;
+        int best_target = -1;
+        for (int i = 0; i < connections_per_room; ++i)
+        {
+            const int target =
+                room_connections[room][(start + i) % connections_per_room];
+            const double danger = probabilities.wumpus[target] +
+                probabilities.pit[target] +
+                bat_danger * probabilities.bat[target] +
+                visit_danger * visits[target];
+            if (best_target < 0 || danger < least_danger)
+            {
+                least_danger = danger;
+                best_target = target;
+            }
+        }
+        last = Last_action::move;
+        last_room = best_target;
+        return move_to(view.numbers[best_target]);
+    }
+
+private:
+    // A bat only moves the player, so it counts for less than a pit.
+    static constexpr double bat_danger = 0.25;
+    static constexpr double visit_danger = 0.02;
+    static constexpr double shoot_threshold = 0.4;
+
+    enum class Last_action
+    {
+        none,
+        move,
+        shoot
+    };
+
+    Belief belief{0};
+    std::array<int, num_rooms> visits;
+    Last_action last;
+    // The room moved to, or shot from, and the path of the arrow.
+    int last_room;
+    std::array<int, arrow_range> last_path;
+    bool carried;
+    bool wumpus_moved;
+
+    // Brings the belief up to date with what followed the last action and
+    // with the room the player is now in.
+    void update(int room, const Percepts& percepts)
+    {
+        if (last == Last_action::move && carried)
+        {
+            belief.observe_bat(last_room);
+            belief.observe_dropped();
+        }
+        else if (last == Last_action::shoot && wumpus_moved)
+        {
+            belief.observe_missed_arrow(last_room, last_path);
+            belief.observe_wumpus_moved();
+        }
+        carried = false;
+        wumpus_moved = false;
+        belief.observe_room(room, percepts);
+    }
+};
+
+constexpr double Belief_shooter::bat_danger;
+constexpr double Belief_shooter::visit_danger;
+constexpr double Belief_shooter::shoot_threshold;
+}
+
+const std::vector<std::string>& agent_names()
+{
+    static const std::vector<std::string> names{"walker", "mapper", "believer"};
+    return names;
+}
+
+std::unique_ptr<Agent> make_agent(const std::string& name)
+{
+    if (name == "walker")
+        return std::make_unique<Random_walker>();
+    if (name == "mapper")
+        return std::make_unique<Cautious_mapper>();
+    if (name == "believer")
+        return std::make_unique<Belief_shooter>();
+    throw std::invalid_argument("Unknown agent: " + name);
+}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "events.h"
+#include "game.h"
+#include "random.h"
+
+namespace wumpus {
+
+// What a player sees of a hunt: the numbered map the GUI draws, the room they
+// are in, the rooms next to it, the arrows left and the percepts. Rooms are
+// given by number.
+struct Agent_view
+{
+    // The number of the room at each index of room_connections.
+    const std::array<std::int8_t, num_rooms>& numbers;
+    int player_room;
+    std::array<int, connections_per_room> adjacent_rooms;
+    int arrows;
+    Percepts percepts;
+
+    // Returns the index of the room with the given number.
+    int index_of(int number) const;
+};
+
+// Returns what the player of the game sees.
+Agent_view agent_view(const Game& game);
+
+struct Agent_action
+{
+    enum class Type
+    {
+        move,
+        shoot,
+        quit
+    } type;
+    // The room to move to, or the path of the arrow, by number. Unused
+    // entries are -1.
+    std::array<int, arrow_range> targets;
+};
+
+// A strategy for playing hunts. The game an agent plays reports its events
+// to the agent, which learns of bat carries and wumpus moves that way.
+class Agent : public Event_sink
+{
+public:
+    // Called once a hunt is set up, before the first action.
+    virtual void begin_hunt(const Agent_view& view);
+    // Chooses the next action. rng is the agent's own, so that hunts are
+    // reproducible.
+    virtual Agent_action next_action(const Agent_view& view, Rng& rng) = 0;
+
+    void on_event(Event event) override;
+};
+
+// Plays the hunt set up in the game, which must report its events to the
+// agent, asking the agent for every action. Actions the game does not allow
+// are skipped; after max_turns turns the game quits for the agent. Returns
+// the number of actions the agent chose, which leaves out that quit.
+int play_hunt(Game& game, Agent& agent, Rng& rng, int max_turns);
+
+// Returns the names of the baseline agents:
+//   walker   wanders at random and shoots a random neighbour on smelling the
+//            wumpus.
+//   mapper   keeps to rooms it has proved safe, marking rooms off from the
+//            percepts, and shoots only when it has pinned the wumpus down.
+//   believer tracks the exact posterior over layouts, moves to the least
+//            dangerous neighbour and shoots when a kill is likely enough.
+const std::vector<std::string>& agent_names();
+
+// Returns a new agent of the given name. Throws std::invalid_argument if
+// there is no such agent.
+std::unique_ptr<Agent> make_agent(const std::string& name);
+}
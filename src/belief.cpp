@@ -0,0 +1,354 @@
+#include "belief.h"
+
+namespace wumpus {
+
+static_assert(
+    num_bats == 2 && num_pits == 2,
+    "The layouts are enumerated as pairs of bats and pairs of pits");
+
+namespace {
+
+Room_mask bats_of(std::uint64_t layout)
+{
+    return static_cast<Room_mask>(layout);
+}
+
+Room_mask pits_of(std::uint64_t layout)
+{
+    return static_cast<Room_mask>(layout >> 32);
+}
+
+std::uint64_t mix(std::uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Adds the probability of each flight of an arrow to the odds, for every room
+// the wumpus could be in. visited holds the rooms the arrow has passed.
+void add_flights(
+    int player_room,
+    const std::array<int, arrow_range>& path,
+    int step,
+    int previous_room,
+    int current_room,
+    Room_mask visited,
+    float probability,
+    Arrow_odds& odds)
+{
+    if (step == arrow_range)
+    {
+        for (int room = 0; room < num_rooms; ++room)
+            if (!(visited & room_bit(room)))
+                odds.miss[room] += probability;
+        return;
+    }
+
+    std::array<int, connections_per_room> next_rooms;
+    int num_next_rooms = 0;
+    int target = path[step];
+    if (target >= 0 && target != previous_room &&
+        (adjacency_masks[current_room] & room_bit(target)))
+    {
+        next_rooms[num_next_rooms++] = target;
+    }
+    else
+    {
+        for (int room : room_connections[current_room])
+            if (room != previous_room)
+                next_rooms[num_next_rooms++] = room;
+    }
+
+    const float share = probability / num_next_rooms;
+    for (int i = 0; i < num_next_rooms; ++i)
+    {
+        int room = next_rooms[i];
+        if (room == player_room)
+            continue; // The arrow hits the player.
+        if (!(visited & room_bit(room)))
+            odds.kill[room] += share;
+        add_flights(
+            player_room,
+            path,
+            step + 1,
+            current_room,
+            room,
+            visited | room_bit(room),
+            share,
+            odds);
+    }
+}
+}
+
+Arrow_odds arrow_odds(
+    int player_room, const std::array<int, arrow_range>& path)
+{
+    Arrow_odds odds{};
+    add_flights(
+        player_room,
+        path,
+        0,
+        -1,
+        player_room,
+        room_bit(player_room),
+        1.0f,
+        odds);
+    return odds;
+}
+
+// Keeps the layouts for which keep(i) holds, compacting every array in place.
+template <typename Predicate>
+void Belief::keep_layouts_if(Predicate keep)
+{
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < layouts.size(); ++i)
+    {
+        if (!keep(i))
+            continue;
+        if (kept != i)
+        {
+            layouts[kept] = layouts[i];
+            for (std::vector<float>& weights : wumpus_weights)
+                weights[kept] = weights[i];
+        }
+        ++kept;
+    }
+    layouts.resize(kept);
+    for (std::vector<float>& weights : wumpus_weights)
+        weights.resize(kept);
+}
+
+Belief::Belief(int player_room)
+{
+    reset(player_room);
+}
+
+Belief::Belief(const Belief& other)
+    : layouts{other.layouts}, wumpus_weights(other.wumpus_weights)
+{
+}
+
+Belief& Belief::operator=(const Belief& other)
+{
+    layouts = other.layouts;
+    wumpus_weights = other.wumpus_weights;
+    return *this;
+}
+
+void Belief::reset(int player_room)
+{
+    layouts.clear();
+    for (std::vector<float>& weights : wumpus_weights)
+        weights.clear();
+
+    const Room_mask player = room_bit(player_room);
+    for (int bat1 = 0; bat1 < num_rooms; ++bat1)
+    {
+        for (int bat2 = bat1 + 1; bat2 < num_rooms; ++bat2)
+        {
+            Room_mask bats = room_bit(bat1) | room_bit(bat2);
+            if (bats & player)
+                continue;
+            for (int pit1 = 0; pit1 < num_rooms; ++pit1)
+            {
+                for (int pit2 = pit1 + 1; pit2 < num_rooms; ++pit2)
+                {
+                    Room_mask pits = room_bit(pit1) | room_bit(pit2);
+                    if (pits & (player | bats))
+                        continue;
+                    layouts.push_back(
+                        bats | static_cast<std::uint64_t>(pits) << 32);
+                    Room_mask occupied = player | bats | pits;
+                    for (int room = 0; room < num_rooms; ++room)
+                        wumpus_weights[room].push_back(
+                            occupied & room_bit(room) ? 0.0f : 1.0f);
+                }
+            }
+        }
+    }
+    normalize();
+}
+
+double Belief::observe_room(int room, const Percepts& percepts)
+{
+    const Room_mask here = room_bit(room);
+    const Room_mask adjacent = adjacency_masks[room];
+    keep_layouts_if([this, here, adjacent, &percepts](std::size_t i) {
+        Room_mask bats = bats_of(layouts[i]);
+        Room_mask pits = pits_of(layouts[i]);
+        return !((bats | pits) & here) &&
+            ((bats & adjacent) != 0) == percepts.bat &&
+            ((pits & adjacent) != 0) == percepts.pit;
+    });
+
+    std::array<float, num_rooms> likelihoods;
+    for (int i = 0; i < num_rooms; ++i)
+    {
+        bool is_adjacent = (adjacent & room_bit(i)) != 0;
+        likelihoods[i] = i != room && is_adjacent == percepts.wumpus ? 1 : 0;
+    }
+    return weigh_wumpus(likelihoods);
+}
+
+double Belief::observe_bat(int room)
+{
+    const Room_mask here = room_bit(room);
+    keep_layouts_if([this, here](std::size_t i) {
+        return (bats_of(layouts[i]) & here) && !(pits_of(layouts[i]) & here);
+    });
+
+    std::array<float, num_rooms> likelihoods;
+    for (int i = 0; i < num_rooms; ++i)
+        likelihoods[i] = i != room ? 1 : 0;
+    return weigh_wumpus(likelihoods);
+}
+
+double Belief::observe_dropped()
+{
+    // Each drop is uniform over all rooms and repeats on a room with a bat
+    // but no wumpus, so the player lands in each of the other rooms with
+    // probability one over their number.
+    const float usual = 1.0f / (num_rooms - num_bats);
+    const float with_wumpus = 1.0f / (num_rooms - num_bats + 1);
+    for (int room = 0; room < num_rooms; ++room)
+    {
+        std::vector<float>& weights = wumpus_weights[room];
+        for (std::size_t i = 0; i < layouts.size(); ++i)
+            weights[i] *= bats_of(layouts[i]) & room_bit(room) ? with_wumpus
+                                                              : usual;
+    }
+    return normalize();
+}
+
+double Belief::observe_missed_arrow(
+    int player_room, const std::array<int, arrow_range>& path)
+{
+    return weigh_wumpus(arrow_odds(player_room, path).miss);
+}
+
+void Belief::observe_wumpus_moved()
+{
+    // The tunnels run both ways, so the wumpus reaches a room from exactly
+    // the rooms adjacent to it.
+    const float share = 1.0f / connections_per_room;
+    const std::size_t size = layouts.size();
+    for (int room = 0; room < num_rooms; ++room)
+    {
+        const auto& from = room_connections[room];
+        const float* from0 = wumpus_weights[from[0]].data();
+        const float* from1 = wumpus_weights[from[1]].data();
+        const float* from2 = wumpus_weights[from[2]].data();
+        std::vector<float>& moved = scratch[room];
+        moved.resize(size);
+        for (std::size_t i = 0; i < size; ++i)
+            moved[i] = share * (from0[i] + from1[i] + from2[i]);
+    }
+    wumpus_weights.swap(scratch);
+}
+
+Hazard_probabilities Belief::probabilities() const
+{
+    Hazard_probabilities result{};
+    const std::size_t size = layouts.size();
+    std::vector<float> totals(size, 0.0f);
+    for (int room = 0; room < num_rooms; ++room)
+    {
+        const float* weights = wumpus_weights[room].data();
+        float sum = 0;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            sum += weights[i];
+            totals[i] += weights[i];
+        }
+        result.wumpus[room] = sum;
+    }
+
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        for (Room_mask bats = bats_of(layouts[i]); bats; bats &= bats - 1)
+            result.bat[room_index(bats)] += totals[i];
+        for (Room_mask pits = pits_of(layouts[i]); pits; pits &= pits - 1)
+            result.pit[room_index(pits)] += totals[i];
+    }
+    return result;
+}
+
+std::size_t Belief::size() const
+{
+    return layouts.size();
+}
+
+std::uint64_t Belief::fingerprint() const
+{
+    return fingerprint(cave_automorphisms().front());
+}
+
+std::uint64_t Belief::fingerprint(const Automorphism& automorphism) const
+{
+    // Each layout is hashed with its weights rounded to 2^-24, and the hashes
+    // are summed so that the order of the layouts does not matter: relabelling
+    // the rooms reorders them.
+    const std::size_t size = layouts.size();
+    std::vector<std::uint64_t> hashes(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        Room_mask bats = automorphism(bats_of(layouts[i]));
+        Room_mask pits = automorphism(pits_of(layouts[i]));
+        hashes[i] = mix(bats | static_cast<std::uint64_t>(pits) << 32);
+    }
+    for (int room = 0; room < num_rooms; ++room)
+    {
+        const std::uint64_t image = automorphism(room);
+        const float* weights = wumpus_weights[room].data();
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            auto weight =
+                static_cast<std::uint64_t>(weights[i] * 16777216.0f + 0.5f);
+            if (weight != 0)
+                hashes[i] += mix(weight << 8 | image);
+        }
+    }
+
+    std::uint64_t hash = 0;
+    for (std::uint64_t layout_hash : hashes)
+        hash += mix(layout_hash);
+    return hash;
+}
+
+double Belief::weigh_wumpus(const std::array<float, num_rooms>& likelihoods)
+{
+    for (int room = 0; room < num_rooms; ++room)
+        for (float& weight : wumpus_weights[room])
+            weight *= likelihoods[room];
+    return normalize();
+}
+
+// Drops the layouts left without weight and scales the rest to sum to one.
+// Returns the total weight before scaling.
+double Belief::normalize()
+{
+    const std::size_t size = layouts.size();
+    std::vector<float>& totals = scratch[0];
+    totals.assign(size, 0.0f);
+    for (const std::vector<float>& weights : wumpus_weights)
+        for (std::size_t i = 0; i < size; ++i)
+            totals[i] += weights[i];
+
+    double total = 0;
+    for (float layout_total : totals)
+        total += layout_total;
+    keep_layouts_if([&totals](std::size_t i) { return totals[i] != 0; });
+    if (total == 0)
+        return 0;
+
+    const float scale = static_cast<float>(1.0 / total);
+    for (std::vector<float>& weights : wumpus_weights)
+        for (float& weight : weights)
+            weight *= scale;
+    return total;
+}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+#include "symmetry.h"
+
+namespace wumpus {
+
+struct Hazard_probabilities
+{
+    std::array<double, num_rooms> wumpus;
+    std::array<double, num_rooms> bat;
+    std::array<double, num_rooms> pit;
+};
+
+// For each room the wumpus could be in, the probability that an arrow kills
+// it and the probability that the arrow misses both it and the player.
+struct Arrow_odds
+{
+    std::array<float, num_rooms> kill;
+    std::array<float, num_rooms> miss;
+};
+
+// Returns the odds of an arrow shot from the given room along the given path
+// (room indices, or -1 for none), following the rules of
+// Game::get_next_room_for_arrow_flight().
+Arrow_odds arrow_odds(
+    int player_room, const std::array<int, arrow_range>& path);
+
+// The exact posterior over hazard layouts given what the player has observed.
+// Rooms are given by index.
+//
+// The bats and pits never move, so the belief is stored as one entry per
+// possible bat and pit layout, packed as two room masks, together with the
+// weight of each wumpus room under that layout. The weights are stored room by
+// room, so every update is a straight pass over flat arrays that the compiler
+// vectorizes, and a wumpus move sums three of those arrays into each room.
+class Belief
+{
+public:
+    // Starts a hunt with the player in the given room, which is known to be
+    // free of hazards.
+    explicit Belief(int player_room);
+
+    // Copies the belief without its working storage.
+    Belief(const Belief& other);
+    Belief& operator=(const Belief& other);
+
+    void reset(int player_room);
+
+    // Each observation returns its probability under the belief before the
+    // update. An observation of probability zero leaves the belief empty.
+
+    // The player is alive in the given room and has the given percepts. The
+    // room therefore holds no hazard.
+    double observe_room(int room, const Percepts& percepts);
+    // The player entered the given room and was carried away by its bat.
+    double observe_bat(int room);
+    // The bats dropped the player in some room. Call this after observe_bat()
+    // and before observing the room the player ends up in: rooms holding a bat
+    // but no wumpus are passed over, so the layout decides how likely each
+    // landing room is.
+    double observe_dropped();
+    // An arrow shot from the given room along the given path (room indices,
+    // or -1 for none) hit neither the wumpus nor the player.
+    double observe_missed_arrow(
+        int player_room, const std::array<int, arrow_range>& path);
+    // The wumpus moved to a random adjacent room.
+    void observe_wumpus_moved();
+
+    Hazard_probabilities probabilities() const;
+
+    // Returns the number of bat and pit layouts still possible.
+    std::size_t size() const;
+
+    // Returns a hash of the belief. The weights are rounded first, so beliefs
+    // reached through equivalent observations hash alike.
+    std::uint64_t fingerprint() const;
+    // Returns the hash of the belief with its rooms relabelled by the given
+    // automorphism. Beliefs that are images of each other under symmetries
+    // of the cave can be matched by comparing these.
+    std::uint64_t fingerprint(const Automorphism& automorphism) const;
+
+private:
+    // The bats in the low half and the pits in the high half.
+    std::vector<std::uint64_t> layouts;
+    // For each wumpus room, the weight of that room under each layout.
+    std::array<std::vector<float>, num_rooms> wumpus_weights;
+    // Reused working storage of the same shape.
+    std::array<std::vector<float>, num_rooms> scratch;
+
+    template <typename Predicate>
+    void keep_layouts_if(Predicate keep);
+    double weigh_wumpus(const std::array<float, num_rooms>& likelihoods);
+    double normalize();
+};
+}
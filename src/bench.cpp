@@ -0,0 +1,822 @@
+// Benchmarks of the game core and of the GUI layout math. Prints the time per
+// operation of each benchmark as JSON and, given a baseline printed by an
+// earlier run, fails if any benchmark got slower than the tolerance allows.
+// With --allocations, counts the heap allocations of each benchmark instead
+// and fails if any allocates once running.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cave.h"
+#include "cave_engine.h"
+#include "cave_game.h"
+#include "cave_layout.h"
+#include "game.h"
+#include "game_pool.h"
+#include "hunt_lanes.h"
+#include "random.h"
+
+using namespace wumpus;
+
+namespace {
+
+// Every benchmark folds its results into this, so that the compiler cannot
+// drop the work being measured.
+volatile std::uint64_t checksum;
+
+// The number of times the program has allocated from the heap, counted by the
+// replacement operator new below.
+std::uint64_t allocations;
+
+// Counts the events, as a GUI sink would consume them through a virtual call.
+class Counting_sink : public Event_sink
+{
+public:
+    std::uint64_t events{0};
+
+    void on_event(Event) override
+    {
+        ++events;
+    }
+};
+
+struct Benchmark
+{
+    std::string name;
+    // Runs the given number of operations.
+    void (*run)(long long);
+};
+
+// Returns a hunt with the player in room 0 and the hazards out of reach of
+// the rooms around it, so that moves and shots do not end it.
+Hunt_state quiet_hunt()
+{
+    Null_event_sink sink;
+    Silent_game game{sink, 1};
+    game.init_hunt();
+    Hunt_state hunt = game.get_state();
+    hunt.hazards.player = room_bit(0);
+    hunt.hazards.wumpus = room_bit(19);
+    hunt.hazards.bats = room_bit(17) | room_bit(18);
+    hunt.hazards.pits = room_bit(15) | room_bit(16);
+    return hunt;
+}
+
+void init_hunt(long long n)
+{
+    Counting_sink sink;
+    Game game{sink, 1};
+    std::uint64_t sum = 0;
+    for (long long i = 0; i < n; ++i)
+    {
+        game.init_hunt();
+        sum += game.get_hazard_masks().wumpus;
+    }
+    checksum = sum;
+}
+
+void place_player_and_hazards(long long n)
+{
+    Rng rng{1};
+    std::uint64_t sum = 0;
+    for (long long i = 0; i < n; ++i)
+        sum += random_hazard_masks(rng).pits;
+    checksum = sum;
+}
+
+// Walks back and forth between two rooms that are free of hazards.
+void move(long long n)
+{
+    Counting_sink sink;
+    Game game{sink, 1};
+    const Hunt_state hunt = quiet_hunt();
+    game.set_state(hunt);
+    const int here = hunt.numbers[0];
+    const int there = hunt.numbers[1];
+    for (long long i = 0; i < n; ++i)
+        game.move(i % 2 ? here : there);
+    checksum = game.get_hazard_masks().player;
+}
+
+// Shoots a crooked arrow that misses, which wakes the wumpus.
+void shoot(long long n)
+{
+    Counting_sink sink;
+    Game game{sink, 1};
+    const Hunt_state hunt = quiet_hunt();
+    const std::array<int, arrow_range> targets{
+        {hunt.numbers[1], hunt.numbers[2], -1}};
+    std::uint64_t sum = 0;
+    for (long long i = 0; i < n; ++i)
+    {
+        game.set_state(hunt);
+        game.shoot(targets);
+        sum += game.get_hazard_masks().wumpus;
+    }
+    checksum = sum;
+}
+
+// Every hazard is adjacent, so every percept is reported.
+void inform_player_of_hazards(long long n)
+{
+    Counting_sink sink;
+    Game game{sink, 1};
+    Hunt_state hunt = quiet_hunt();
+    hunt.hazards.wumpus = room_bit(1);
+    hunt.hazards.bats = room_bit(4);
+    hunt.hazards.pits = room_bit(5);
+    game.set_state(hunt);
+    for (long long i = 0; i < n; ++i)
+        game.inform_player_of_hazards();
+    checksum = sink.events;
+}
+
+void get_percepts(long long n)
+{
+    Counting_sink sink;
+    Game game{sink, 1};
+    game.init_hunt();
+    std::uint64_t sum = 0;
+    for (long long i = 0; i < n; ++i)
+    {
+        Percepts percepts = game.get_percepts();
+        sum += percepts.wumpus + percepts.bat + percepts.pit;
+    }
+    checksum = sum;
+}
+
+// Moves into a bat in a cave where half the rooms have one, so that the
+// hazard check usually follows a chain of drops.
+void check_room_hazards_bat_chain(long long n)
+{
+    Counting_sink sink;
+    Game game{sink, 1};
+    Hunt_state hunt = quiet_hunt();
+    hunt.hazards.bats = 0x000aaaaa;
+    hunt.hazards.pits = 0;
+    const int bat_room = hunt.numbers[1];
+    for (long long i = 0; i < n; ++i)
+    {
+        game.set_state(hunt);
+        game.move(bat_room);
+    }
+    checksum = sink.events;
+}
+
+// Plays whole hunts, wandering at random and shooting into a random adjacent
+// room whenever the wumpus is near.
+void full_hunt(long long n)
+{
+    Null_event_sink sink;
+    Silent_game game{sink, 1};
+    Rng rng{2};
+    std::uint64_t sum = 0;
+    for (long long i = 0; i < n; ++i)
+    {
+        game.init_hunt();
+        for (int turn = 0; !game.is_hunt_over(); ++turn)
+        {
+            const Hunt_state& hunt = game.get_state();
+            const auto& adjacent_rooms = room_connections[hunt.player_room()];
+            const std::array<int, arrow_range> targets{
+                {hunt.numbers
+                     [adjacent_rooms[rng.uniform(0, connections_per_room)]],
+                 -1,
+                 -1}};
+            if (turn == 1000)
+                game.quit();
+            else if (game.get_percepts().wumpus && game.can_shoot(targets))
+                game.shoot(targets);
+            else
+                game.move(targets[0]);
+        }
+        sum += static_cast<int>(game.get_game_state());
+    }
+    checksum = sum;
+}
+
+// Plays whole hunts like full_hunt() through games taken from a pool, with
+// events dispatched at run time and the percepts reported every turn, as a
+// server holding many sessions would.
+void pooled_hunts(long long n)
+{
+    static Game_pool<Game, Counting_sink> pool{8};
+    Rng rng{2};
+    std::uint64_t sum = 0;
+    for (long long i = 0; i < n; ++i)
+    {
+        const int slot = pool.acquire(i);
+        Game& game = pool.game(slot);
+        for (int turn = 0; !game.is_hunt_over(); ++turn)
+        {
+            game.inform_player_of_hazards();
+            const Hunt_state& hunt = game.get_state();
+            const auto& adjacent_rooms = room_connections[hunt.player_room()];
+            const std::array<int, arrow_range> targets{
+                {hunt.numbers
+                     [adjacent_rooms[rng.uniform(0, connections_per_room)]],
+                 -1,
+                 -1}};
+            if (turn == 1000)
+                game.quit();
+            else if (game.get_percepts().wumpus && game.can_shoot(targets))
+                game.shoot(targets);
+            else
+                game.move(targets[0]);
+        }
+        game.end_hunt();
+        sum += pool.sink(slot).events;
+        pool.release(slot);
+    }
+    checksum = sum;
+}
+
+void layout_room_centers(long long n)
+{
+    const Point size{1280.0f, 600.0f};
+    float sum = 0;
+    for (long long i = 0; i < n; ++i)
+    {
+        Point center = room_center(static_cast<int>(i % num_rooms), size);
+        sum += center.x + center.y;
+    }
+    checksum = static_cast<std::uint64_t>(sum);
+}
+
+void layout_build(long long n)
+{
+    std::uint64_t sum = 0;
+    for (long long i = 0; i < n; ++i)
+    {
+        Cave_layout layout{{1280.0f + i % 2, 600.0f}};
+        sum += static_cast<std::uint64_t>(layout.center(0).x);
+    }
+    checksum = sum;
+}
+
+// Hit tests clicks spread over the whole window, most of them on no room.
+void layout_hit_test(long long n)
+{
+    const Cave_layout layout{{1280.0f, 600.0f}};
+    std::uint64_t sum = 0;
+    for (long long i = 0; i < n; ++i)
+    {
+        Point click{static_cast<float>(i * 37 % 1280),
+                    static_cast<float>(i * 101 % 600)};
+        sum += layout.room_at(click) + 1;
+    }
+    checksum = sum;
+}
+
+// Plays whole hunts like cave_hunts(), eight at a time through the given lane
+// kernel. Counts hunts, so the times compare with cave_hunts_static.
+void lane_hunts(Lane_kernel kernel, long long n)
+{
+    Hunt_lanes lanes{};
+    Lane_actions actions{};
+    Lane_rngs rngs{};
+    std::int32_t percepts[num_lanes];
+    for (int lane = 0; lane < num_lanes; ++lane)
+    {
+        seed_lane(lanes.rngs, lane, lane + 1);
+        seed_lane(rngs, lane, num_lanes + lane + 1);
+        actions.path[1][lane] = -1;
+        actions.path[2][lane] = -1;
+    }
+    init_hunts(kernel, lanes, 0xff);
+    std::uint64_t sum = 0;
+    for (long long hunts = 0; hunts < n;)
+    {
+        get_percepts(kernel, lanes, percepts);
+        random_adjacent_rooms(
+            kernel, rngs, 0xff, lanes.player_room, actions.path[0]);
+        for (int lane = 0; lane < num_lanes; ++lane)
+        {
+            actions.type[lane] =
+                percepts[lane] & wumpus_percept && lanes.arrows[lane] > 0
+                ? Lane_action::shoot
+                : Lane_action::move;
+        }
+        step(kernel, lanes, actions);
+
+        std::uint32_t ended = 0;
+        for (int lane = 0; lane < num_lanes; ++lane)
+        {
+            if (lanes.state[lane] != static_cast<int>(Game_state::none))
+            {
+                sum += lanes.state[lane];
+                ended |= 1u << lane;
+                ++hunts;
+            }
+        }
+        if (ended)
+            init_hunts(kernel, lanes, ended);
+    }
+    checksum = sum;
+}
+
+void lane_hunts_scalar(long long n)
+{
+    lane_hunts(Lane_kernel::scalar, n);
+}
+
+// Uses the fastest kernel the processor supports.
+void lane_hunts_best(long long n)
+{
+    lane_hunts(best_lane_kernel(), n);
+}
+
+// A cave of a million rooms, built once on first use.
+const Cave& large_cave()
+{
+    static const Cave cave = []() {
+        Rng rng{1};
+        return Cave::random_regular(1000000, 3, rng);
+    }();
+    return cave;
+}
+
+// Sets up hunts in the large cave, which costs no more than in the original.
+void large_cave_init_hunt(long long n)
+{
+    Null_event_sink sink;
+    Silent_cave_game game{large_cave(), sink, Cave_rules{}, 1};
+    std::uint64_t sum = 0;
+    for (long long i = 0; i < n; ++i)
+    {
+        game.init_hunt();
+        sum += game.get_wumpus_room();
+    }
+    checksum = sum;
+}
+
+// Walks at random through the large cave, which misses the cache on most
+// steps.
+void large_cave_walk(long long n)
+{
+    Null_event_sink sink;
+    Silent_cave_game game{large_cave(), sink, Cave_rules{0, 0, 0}, 1};
+    game.init_hunt();
+    Rng rng{2};
+    std::uint64_t sum = 0;
+    for (long long i = 0; i < n; ++i)
+    {
+        const Cave::Adjacent_rooms rooms =
+            large_cave().adjacent_rooms(game.get_player_room());
+        game.move(rooms[rng.uniform(0, rooms.size())]);
+        if (game.is_hunt_over())
+            game.init_hunt();
+        sum += game.get_percepts().wumpus;
+    }
+    checksum = sum;
+}
+
+// Plays whole hunts in the original cave through the given engine, walking at
+// random and shooting at the first smell of the wumpus.
+void cave_hunts(Cave_engine engine, long long n)
+{
+    const Cave cave = Cave::dodecahedron();
+    Null_event_sink sink;
+    Rng rng{2};
+    std::uint64_t sum = 0;
+    with_cave_game(engine, cave, Cave_rules{}, sink, 1, [&](auto& game) {
+        for (long long i = 0; i < n; ++i)
+        {
+            game.init_hunt();
+            while (!game.is_hunt_over())
+            {
+                const Cave::Adjacent_rooms rooms =
+                    cave.adjacent_rooms(game.get_player_room());
+                const std::array<int, arrow_range> path{
+                    {rooms[rng.uniform(0, rooms.size())], -1, -1}};
+                if (game.get_percepts().wumpus && game.can_shoot(path))
+                    game.shoot(path);
+                else
+                    game.move(path[0]);
+            }
+            sum += static_cast<int>(game.get_game_state());
+        }
+    });
+    checksum = sum;
+}
+
+void cave_hunts_generic(long long n)
+{
+    cave_hunts(Cave_engine::generic, n);
+}
+
+void cave_hunts_static(long long n)
+{
+    cave_hunts(Cave_engine::dodecahedron, n);
+}
+
+const std::vector<Benchmark> benchmarks{
+    {"init_hunt", init_hunt},
+    {"place_player_and_hazards", place_player_and_hazards},
+    {"move", move},
+    {"shoot", shoot},
+    {"inform_player_of_hazards", inform_player_of_hazards},
+    {"get_percepts", get_percepts},
+    {"check_room_hazards_bat_chain", check_room_hazards_bat_chain},
+    {"full_hunt", full_hunt},
+    {"pooled_hunts", pooled_hunts},
+    {"layout_room_centers", layout_room_centers},
+    {"layout_build", layout_build},
+    {"layout_hit_test", layout_hit_test},
+    {"cave_hunts_generic", cave_hunts_generic},
+    {"cave_hunts_static", cave_hunts_static},
+    {"lane_hunts_scalar", lane_hunts_scalar},
+    {"lane_hunts_best", lane_hunts_best},
+    {"large_cave_init_hunt", large_cave_init_hunt},
+    {"large_cave_walk", large_cave_walk}};
+
+struct Options
+{
+    std::string filter;
+    double min_time{0.05};
+    int repetitions{5};
+    std::string baseline;
+    double tolerance{0.15};
+    // Counts the allocations of each benchmark instead of timing it.
+    bool allocations{false};
+};
+
+struct Result
+{
+    std::string name;
+    long long iterations{0};
+    double ns_per_op{0};
+};
+
+double time_run(const Benchmark& benchmark, long long iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    benchmark.run(iterations);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Grows the number of iterations until a run takes the minimum time, then
+// takes the median time per operation over the repetitions. A first untimed
+// run does any setup the benchmark keeps between runs.
+Result measure(const Benchmark& benchmark, const Options& options)
+{
+    benchmark.run(1);
+    long long iterations = 1;
+    double seconds = time_run(benchmark, iterations);
+    while (seconds < options.min_time)
+    {
+        double scale = seconds > 0 ? 1.5 * options.min_time / seconds : 100;
+        iterations = static_cast<long long>(
+            iterations * std::min(std::max(scale, 2.0), 100.0));
+        seconds = time_run(benchmark, iterations);
+    }
+
+    std::vector<double> samples{seconds};
+    while (static_cast<int>(samples.size()) < options.repetitions)
+        samples.push_back(time_run(benchmark, iterations));
+    std::nth_element(
+        samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+
+    Result result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.ns_per_op = samples[samples.size() / 2] * 1e9 / iterations;
+    return result;
+}
+
+struct Allocation_result
+{
+    std::string name;
+    long long iterations{0};
+    double allocations_per_op{0};
+};
+
+// Counts the allocations of the given number of operations once the
+// benchmark is running, as the difference between runs of twice as many and
+// as many operations, so that allocations made on setting up a run do not
+// count.
+Allocation_result count_allocations(
+    const Benchmark& benchmark, long long iterations)
+{
+    benchmark.run(1);
+    std::uint64_t start = allocations;
+    benchmark.run(iterations);
+    const std::uint64_t once = allocations - start;
+    start = allocations;
+    benchmark.run(2 * iterations);
+    const std::uint64_t twice = allocations - start;
+
+    Allocation_result result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.allocations_per_op =
+        twice > once ? static_cast<double>(twice - once) / iterations : 0;
+    return result;
+}
+
+void print_json(std::ostream& out, const std::vector<Result>& results)
+{
+    out << "{\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        out << "    {\"name\": \"" << results[i].name
+            << "\", \"iterations\": " << results[i].iterations
+            << ", \"ns_per_op\": " << std::fixed << std::setprecision(3)
+            << results[i].ns_per_op << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+void print_json(
+    std::ostream& out, const std::vector<Allocation_result>& results)
+{
+    out << "{\n  \"allocations\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        out << "    {\"name\": \"" << results[i].name
+            << "\", \"iterations\": " << results[i].iterations
+            << ", \"allocations_per_op\": " << std::fixed
+            << std::setprecision(3) << results[i].allocations_per_op << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+// Reads the time per operation of each benchmark from JSON printed by
+// print_json().
+std::map<std::string, double> read_baseline(const std::string& path)
+{
+    std::ifstream in{path};
+    if (!in)
+        throw std::runtime_error("Cannot read baseline " + path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string json = ss.str();
+
+    std::map<std::string, double> baseline;
+    const std::string name_key = "\"name\": \"";
+    const std::string time_key = "\"ns_per_op\": ";
+    for (std::size_t pos = json.find(name_key); pos != std::string::npos;
+         pos = json.find(name_key, pos))
+    {
+        pos += name_key.size();
+        std::size_t end = json.find('"', pos);
+        std::size_t time = json.find(time_key, end);
+        if (end == std::string::npos || time == std::string::npos)
+            throw std::runtime_error("Malformed baseline " + path);
+        baseline[json.substr(pos, end - pos)] =
+            std::strtod(json.c_str() + time + time_key.size(), nullptr);
+        pos = time;
+    }
+    return baseline;
+}
+
+// Prints how each result compares with the baseline and returns the number of
+// regressions.
+int compare(
+    const std::vector<Result>& results,
+    const std::map<std::string, double>& baseline,
+    double tolerance)
+{
+    int regressions = 0;
+    std::cerr << std::fixed << std::setprecision(3);
+    for (const Result& result : results)
+    {
+        auto it = baseline.find(result.name);
+        if (it == baseline.end())
+        {
+            std::cerr << result.name << ": not in the baseline" << std::endl;
+            continue;
+        }
+        const double change = result.ns_per_op / it->second - 1;
+        const bool regressed = change > tolerance;
+        regressions += regressed;
+        std::cerr << result.name << ": " << it->second << " -> "
+                  << result.ns_per_op << " ns (" << std::showpos
+                  << std::setprecision(1) << 100 * change << std::noshowpos
+                  << std::setprecision(3) << "%)"
+                  << (regressed ? " REGRESSION" : "") << std::endl;
+    }
+    return regressions;
+}
+
+void print_usage()
+{
+    std::cerr << "Usage: wumpus_bench [--filter TEXT] [--min-time SECONDS] "
+                 "[--repetitions N]\n"
+                 "                    [--baseline FILE] [--tolerance "
+                 "FRACTION]\n"
+                 "       wumpus_bench --allocations [--filter TEXT]"
+              << std::endl;
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--allocations")
+        {
+            options.allocations = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--filter")
+            options.filter = value;
+        else if (arg == "--min-time")
+            options.min_time = std::stod(value);
+        else if (arg == "--repetitions")
+            options.repetitions = std::stoi(value);
+        else if (arg == "--baseline")
+            options.baseline = value;
+        else if (arg == "--tolerance")
+            options.tolerance = std::stod(value);
+        else
+            throw std::invalid_argument("Unknown option: " + arg);
+    }
+    if (options.min_time <= 0 || options.repetitions < 1)
+        throw std::invalid_argument("Invalid timing options");
+    return options;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    std::map<std::string, double> baseline;
+    try
+    {
+        options = parse_options(argc, argv);
+        if (!options.baseline.empty())
+            baseline = read_baseline(options.baseline);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    if (options.allocations)
+    {
+        // Steady-state play must not allocate; neither should anything else
+        // measured here once it is running.
+        const long long iterations = 1000;
+        std::vector<Allocation_result> results;
+        for (const Benchmark& benchmark : benchmarks)
+            if (benchmark.name.find(options.filter) != std::string::npos)
+                results.push_back(count_allocations(benchmark, iterations));
+        print_json(std::cout, results);
+
+        int allocating = 0;
+        for (const Allocation_result& result : results)
+        {
+            if (result.allocations_per_op > 0)
+            {
+                std::cerr << result.name << ": allocates" << std::endl;
+                ++allocating;
+            }
+        }
+        return allocating == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    std::vector<Result> results;
+    for (const Benchmark& benchmark : benchmarks)
+        if (benchmark.name.find(options.filter) != std::string::npos)
+            results.push_back(measure(benchmark, options));
+    print_json(std::cout, results);
+
+    if (options.baseline.empty())
+        return EXIT_SUCCESS;
+    int regressions = compare(results, baseline, options.tolerance);
+    return regressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Counts every allocation for --allocations. Every form of new and delete
+// is replaced, so that memory from malloc only ever goes back to free.
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    ++allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+#if defined(__cpp_aligned_new) && !defined(_WIN32)
+
+// Over-aligned types come through here, when the language has them. Windows
+// has no aligned_alloc, and its aligned memory cannot go to free.
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    ++allocations;
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    // The size must be a multiple of the alignment.
+    const std::size_t rounded = (std::max<std::size_t>(size, 1) + align - 1) /
+        align * align;
+    if (void* pointer = std::aligned_alloc(align, rounded))
+        return pointer;
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(
+    void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](
+    void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+#endif
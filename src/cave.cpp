@@ -0,0 +1,282 @@
+#include "cave.h"
+
+#include <algorithm>
+#include <istream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+
+#include "game.h"
+
+namespace wumpus {
+
+namespace {
+
+std::uint64_t edge_key(int room, int other_room)
+{
+    return static_cast<std::uint64_t>(std::min(room, other_room)) << 32 |
+        static_cast<std::uint32_t>(std::max(room, other_room));
+}
+
+// Checks the size of a grid or torus, whose rooms have up to four tunnels.
+void check_dimensions(int width, int height, int minimum)
+{
+    if (width < minimum || height < minimum ||
+        4LL * width * height > std::numeric_limits<std::int32_t>::max())
+    {
+        throw std::invalid_argument("Invalid cave dimensions");
+    }
+}
+}
+
+Cave Cave::dodecahedron()
+{
+    Cave cave;
+    cave.offsets.push_back(0);
+    for (const auto& connections : room_connections)
+    {
+        cave.rooms.insert(
+            cave.rooms.end(), connections.begin(), connections.end());
+        cave.offsets.push_back(static_cast<std::int32_t>(cave.rooms.size()));
+    }
+    return cave;
+}
+
+Cave Cave::random_regular(int num_rooms, int degree, Rng& rng)
+{
+    if (degree < 1 || degree >= num_rooms ||
+        static_cast<long long>(num_rooms) * degree % 2 != 0 ||
+        static_cast<long long>(num_rooms) * degree >
+            std::numeric_limits<std::int32_t>::max())
+    {
+        throw std::invalid_argument("No regular cave of that size");
+    }
+
+    // Pair up degree stubs per room at random, then repair each loop or
+    // parallel tunnel by swapping ends with a random good tunnel. There are
+    // only a few such tunnels on average, whatever the size of the cave.
+    std::vector<std::int32_t> stubs;
+    stubs.reserve(static_cast<std::size_t>(num_rooms) * degree);
+    for (int room = 0; room < num_rooms; ++room)
+        stubs.insert(stubs.end(), degree, room);
+    for (std::size_t i = stubs.size() - 1; i > 0; --i)
+        std::swap(stubs[i], stubs[rng.uniform(0, static_cast<int>(i) + 1)]);
+
+    const int num_edges = static_cast<int>(stubs.size() / 2);
+    std::vector<std::pair<int, int>> edges(num_edges);
+    std::unordered_set<std::uint64_t> keys;
+    keys.reserve(num_edges);
+    std::vector<int> bad_edges;
+    std::vector<bool> is_bad(num_edges);
+    for (int i = 0; i < num_edges; ++i)
+    {
+        edges[i] = {stubs[2 * i], stubs[2 * i + 1]};
+        if (edges[i].first == edges[i].second ||
+            !keys.insert(edge_key(edges[i].first, edges[i].second)).second)
+        {
+            bad_edges.push_back(i);
+            is_bad[i] = true;
+        }
+    }
+
+    const int max_attempts = 1000 * (static_cast<int>(bad_edges.size()) + 1);
+    int attempts = 0;
+    for (int bad : bad_edges)
+    {
+        while (true)
+        {
+            if (++attempts > max_attempts)
+                throw std::runtime_error("Cannot build a regular cave");
+            int other = rng.uniform(0, num_edges);
+            int a = edges[bad].first;
+            int b = edges[bad].second;
+            int c = edges[other].first;
+            int d = edges[other].second;
+            if (rng.uniform(0, 2))
+                std::swap(c, d);
+            if (is_bad[other] || a == c || b == d ||
+                edge_key(a, c) == edge_key(b, d) ||
+                keys.count(edge_key(a, c)) || keys.count(edge_key(b, d)))
+            {
+                continue;
+            }
+            keys.erase(edge_key(c, d));
+            keys.insert(edge_key(a, c));
+            keys.insert(edge_key(b, d));
+            edges[bad] = {a, c};
+            edges[other] = {b, d};
+            is_bad[bad] = false;
+            break;
+        }
+    }
+    return from_edges(num_rooms, edges);
+}
+
+Cave Cave::grid(int width, int height)
+{
+    check_dimensions(width, height, 1);
+    std::vector<std::pair<int, int>> edges;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            int room = y * width + x;
+            if (x + 1 < width)
+                edges.emplace_back(room, room + 1);
+            if (y + 1 < height)
+                edges.emplace_back(room, room + width);
+        }
+    }
+    return from_edges(width * height, edges);
+}
+
+Cave Cave::torus(int width, int height)
+{
+    // Narrower tori would join some rooms twice.
+    check_dimensions(width, height, 3);
+    // The tunnels of each room run left, right, up and down, in the order of
+    // Torus_topology, so the two give the same hunts from the same seed.
+    Cave cave;
+    cave.offsets.reserve(width * height + 1);
+    cave.rooms.reserve(4 * width * height);
+    cave.offsets.push_back(0);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            cave.rooms.push_back(y * width + (x + width - 1) % width);
+            cave.rooms.push_back(y * width + (x + 1) % width);
+            cave.rooms.push_back((y + height - 1) % height * width + x);
+            cave.rooms.push_back((y + 1) % height * width + x);
+            cave.offsets.push_back(
+                static_cast<std::int32_t>(cave.rooms.size()));
+        }
+    }
+    return cave;
+}
+
+Cave Cave::from_edges(
+    int num_rooms, const std::vector<std::pair<int, int>>& edges)
+{
+    if (num_rooms < 1 ||
+        edges.size() >
+            static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+    {
+        throw std::invalid_argument("Invalid cave size");
+    }
+
+    Cave cave;
+    cave.offsets.assign(num_rooms + 1, 0);
+    for (const auto& edge : edges)
+    {
+        if (edge.first < 0 || edge.first >= num_rooms || edge.second < 0 ||
+            edge.second >= num_rooms)
+        {
+            throw std::invalid_argument("Tunnel to a room out of range");
+        }
+        if (edge.first == edge.second)
+            throw std::invalid_argument("Tunnel from a room to itself");
+        ++cave.offsets[edge.first + 1];
+        ++cave.offsets[edge.second + 1];
+    }
+    for (int room = 0; room < num_rooms; ++room)
+        cave.offsets[room + 1] += cave.offsets[room];
+
+    std::vector<std::int32_t> next{
+        cave.offsets.begin(), cave.offsets.end() - 1};
+    cave.rooms.resize(cave.offsets.back());
+    for (const auto& edge : edges)
+    {
+        cave.rooms[next[edge.first]++] = edge.second;
+        cave.rooms[next[edge.second]++] = edge.first;
+    }
+
+    std::vector<std::int32_t> sorted;
+    for (int room = 0; room < num_rooms; ++room)
+    {
+        Adjacent_rooms adjacent = cave.adjacent_rooms(room);
+        sorted.assign(adjacent.begin(), adjacent.end());
+        std::sort(sorted.begin(), sorted.end());
+        if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+            throw std::invalid_argument("Parallel tunnels between two rooms");
+        // The wumpus, bats and arrows pick a tunnel at random.
+        if (adjacent.size() == 0)
+            throw std::invalid_argument("Room without tunnels");
+    }
+
+    // A hunt cannot be won in a room the player can never reach.
+    std::vector<char> is_reached(num_rooms, 0);
+    std::vector<std::int32_t> stack{0};
+    is_reached[0] = 1;
+    int num_reached = 1;
+    while (!stack.empty())
+    {
+        const int room = stack.back();
+        stack.pop_back();
+        for (int adjacent : cave.adjacent_rooms(room))
+        {
+            if (is_reached[adjacent])
+                continue;
+            is_reached[adjacent] = 1;
+            ++num_reached;
+            stack.push_back(adjacent);
+        }
+    }
+    if (num_reached != num_rooms)
+        throw std::invalid_argument("The cave is not connected");
+    return cave;
+}
+
+Cave Cave::read_edges(std::istream& in)
+{
+    int num_rooms = -1;
+    std::vector<std::pair<int, int>> edges;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields{line};
+        if (num_rooms < 0)
+        {
+            if (!(fields >> num_rooms))
+                throw std::invalid_argument("Expected the number of rooms");
+            continue;
+        }
+        std::pair<int, int> edge;
+        if (!(fields >> edge.first >> edge.second))
+            throw std::invalid_argument("Expected a tunnel: " + line);
+        edges.push_back(edge);
+    }
+    return from_edges(num_rooms, edges);
+}
+
+bool Cave::are_adjacent(int room, int other_room) const
+{
+    for (int adjacent_room : adjacent_rooms(room))
+        if (adjacent_room == other_room)
+            return true;
+    return false;
+}
+
+void sample_rooms(Rng& rng, int num_rooms, int count, std::int32_t* output)
+{
+    if (count > num_rooms)
+        throw std::invalid_argument("Not enough rooms to sample");
+
+    // Floyd's algorithm picks a uniform set, with one draw per room; a
+    // shuffle of the handful of rooms picked then makes the order uniform.
+    int size = 0;
+    for (int j = num_rooms - count; j < num_rooms; ++j)
+    {
+        int room = rng.uniform(0, j + 1);
+        if (std::find(output, output + size, room) != output + size)
+            room = j;
+        output[size++] = room;
+    }
+    for (int i = count - 1; i > 0; --i)
+        std::swap(output[i], output[rng.uniform(0, i + 1)]);
+}
+}
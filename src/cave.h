@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <utility>
+#include <vector>
+
+#include "random.h"
+
+namespace wumpus {
+
+// A cave of any shape and size, up to millions of rooms, joined by two-way
+// tunnels. Rooms are numbered from 0. The rooms adjacent to each room are
+// stored in compressed sparse row form: one flat array of rooms, with the
+// adjacent rooms of room i in [offsets[i], offsets[i + 1]).
+class Cave
+{
+public:
+    // The rooms adjacent to some room, as a range over the flat array.
+    class Adjacent_rooms
+    {
+    public:
+        Adjacent_rooms(const std::int32_t* first, const std::int32_t* last)
+            : first{first}, last{last}
+        {
+        }
+
+        const std::int32_t* begin() const
+        {
+            return first;
+        }
+
+        const std::int32_t* end() const
+        {
+            return last;
+        }
+
+        int size() const
+        {
+            return static_cast<int>(last - first);
+        }
+
+        int operator[](int i) const
+        {
+            return first[i];
+        }
+
+    private:
+        const std::int32_t* first;
+        const std::int32_t* last;
+    };
+
+    // The cave of the original game, with the tunnels of room_connections in
+    // the same order.
+    static Cave dodecahedron();
+    // A uniformly shuffled graph in which every room has the given number of
+    // tunnels, without loops or parallel tunnels.
+    static Cave random_regular(int num_rooms, int degree, Rng& rng);
+    // A width by height grid in which each room is joined to the rooms beside
+    // it.
+    static Cave grid(int width, int height);
+    // A grid whose edges wrap around, so every room has four tunnels.
+    static Cave torus(int width, int height);
+    // Builds a cave from a list of tunnels between rooms in [0, num_rooms).
+    // Throws std::invalid_argument for loops, parallel tunnels, rooms out of
+    // range, rooms without tunnels or caves that are not connected.
+    static Cave from_edges(
+        int num_rooms, const std::vector<std::pair<int, int>>& edges);
+    // Reads a cave as the number of rooms followed by one tunnel per line,
+    // given as two rooms. Lines starting with '#' are ignored.
+    static Cave read_edges(std::istream& in);
+
+    int num_rooms() const
+    {
+        return static_cast<int>(offsets.size()) - 1;
+    }
+
+    int num_edges() const
+    {
+        return static_cast<int>(rooms.size()) / 2;
+    }
+
+    Adjacent_rooms adjacent_rooms(int room) const
+    {
+        return {rooms.data() + offsets[room], rooms.data() + offsets[room + 1]};
+    }
+
+    bool are_adjacent(int room, int other_room) const;
+
+private:
+    std::vector<std::int32_t> offsets;
+    std::vector<std::int32_t> rooms;
+
+    Cave() = default;
+};
+
+// Writes count distinct rooms of a cave with num_rooms rooms to the output,
+// in random order, drawn uniformly with Floyd's algorithm. The work depends
+// only on the count, not on the size of the cave.
+void sample_rooms(Rng& rng, int num_rooms, int count, std::int32_t* output);
+}
@@ -0,0 +1,34 @@
+#include "cave_engine.h"
+
+namespace wumpus {
+
+const char* cave_engine_name(Cave_engine engine)
+{
+    switch (engine)
+    {
+    case Cave_engine::generic:
+        return "generic";
+    case Cave_engine::dodecahedron:
+        return "dodecahedron";
+    case Cave_engine::torus_4x4:
+        return "torus_4x4";
+    case Cave_engine::torus_8x8:
+        return "torus_8x8";
+    default:
+        throw std::logic_error("Invalid cave engine");
+    }
+}
+
+Cave_engine select_cave_engine(const Cave& cave, const Cave_rules& rules)
+{
+    if (!matches_rules<Classic_rules>(rules))
+        return Cave_engine::generic;
+    if (matches_topology<Dodecahedron_topology>(cave))
+        return Cave_engine::dodecahedron;
+    if (matches_topology<Torus_4x4_topology>(cave))
+        return Cave_engine::torus_4x4;
+    if (matches_topology<Torus_8x8_topology>(cave))
+        return Cave_engine::torus_8x8;
+    return Cave_engine::generic;
+}
+}
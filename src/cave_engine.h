@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+
+#include "cave.h"
+#include "cave_game.h"
+#include "static_cave_game.h"
+
+namespace wumpus {
+
+// The engines that can play a hunt: Basic_cave_game, for any cave, and the
+// prebuilt specializations of Static_cave_game.
+enum class Cave_engine
+{
+    generic,
+    dodecahedron,
+    torus_4x4,
+    torus_8x8
+};
+
+// Returns the name of the given engine, such as "dodecahedron".
+const char* cave_engine_name(Cave_engine engine);
+
+// Returns whether the cave has the rooms and tunnels of the topology, with
+// the tunnels of every room in the same order.
+template <typename Topology>
+bool matches_topology(const Cave& cave)
+{
+    if (cave.num_rooms() != Topology::num_rooms)
+        return false;
+    for (int room = 0; room < Topology::num_rooms; ++room)
+    {
+        const Cave::Adjacent_rooms rooms = cave.adjacent_rooms(room);
+        if (rooms.size() != Topology::degree)
+            return false;
+        for (int i = 0; i < Topology::degree; ++i)
+            if (rooms[i] != Topology::adjacent_room(room, i))
+                return false;
+    }
+    return true;
+}
+
+// Returns whether the rules are those of the specialization.
+template <typename Rules>
+bool matches_rules(const Cave_rules& rules)
+{
+    return rules.bats == Rules::num_bats && rules.pits == Rules::num_pits &&
+        rules.arrows == Rules::num_arrows && arrow_range == Rules::arrow_range;
+}
+
+// Returns the fastest engine for the cave and rules: a specialization whose
+// topology and rules match, or else the generic engine.
+Cave_engine select_cave_engine(const Cave& cave, const Cave_rules& rules);
+
+// Sets up the given engine for the cave and rules and calls play(game) with
+// it. play must accept a game of any engine, so it is usually a generic
+// lambda; the choice is made once here rather than on every action. All
+// engines play the same hunts from the same seed. Throws std::logic_error if
+// a specialization is asked for a cave or rules it does not match.
+template <typename Sink, typename Play>
+void with_cave_game(
+    Cave_engine engine,
+    const Cave& cave,
+    const Cave_rules& rules,
+    Sink& sink,
+    std::uint64_t seed,
+    Play&& play)
+{
+    if (engine != Cave_engine::generic &&
+        engine != select_cave_engine(cave, rules))
+    {
+        throw std::logic_error("The engine does not match the cave");
+    }
+
+    switch (engine)
+    {
+    case Cave_engine::generic:
+    {
+        Basic_cave_game<Sink> game{cave, sink, rules, seed};
+        play(game);
+        break;
+    }
+    case Cave_engine::dodecahedron:
+    {
+        Static_cave_game<Dodecahedron_topology, Classic_rules, Sink> game{
+            sink, seed};
+        play(game);
+        break;
+    }
+    case Cave_engine::torus_4x4:
+    {
+        Static_cave_game<Torus_4x4_topology, Classic_rules, Sink> game{
+            sink, seed};
+        play(game);
+        break;
+    }
+    case Cave_engine::torus_8x8:
+    {
+        Static_cave_game<Torus_8x8_topology, Classic_rules, Sink> game{
+            sink, seed};
+        play(game);
+        break;
+    }
+    }
+}
+}
@@ -0,0 +1,50 @@
+#include "cave_game.h"
+
+#include <stdexcept>
+
+namespace wumpus {
+
+Runtime_cave_policy::Runtime_cave_policy(
+    const Cave& cave, const Cave_rules& rules)
+    : cave{cave}, rules(rules)
+{
+    if (rules.bats < 0 || rules.pits < 0 || rules.arrows < 0)
+        throw std::invalid_argument("Negative numbers of hazards or arrows");
+    if (cave.num_rooms() < 2 + rules.bats + rules.pits)
+        throw std::invalid_argument("The cave is too small for the hazards");
+    // Sized only now that the counts are known to be sound.
+    bat_rooms.resize(rules.bats);
+    pit_rooms.resize(rules.pits);
+    sampled.resize(2 + rules.bats + rules.pits);
+}
+
+template <typename Sink>
+Basic_cave_game<Sink>::Basic_cave_game(
+    const Cave& cave, Sink& sink, const Cave_rules& rules, std::uint64_t seed)
+    : Cave_hunt<Runtime_cave_policy, Sink>{sink, seed, cave, rules}
+{
+}
+
+template <typename Sink>
+const Cave& Basic_cave_game<Sink>::get_cave() const
+{
+    return this->cave.get_cave();
+}
+
+template <typename Sink>
+const std::vector<std::int32_t>& Basic_cave_game<Sink>::get_bat_rooms() const
+{
+    return this->cave.get_bat_rooms();
+}
+
+template <typename Sink>
+const std::vector<std::int32_t>& Basic_cave_game<Sink>::get_pit_rooms() const
+{
+    return this->cave.get_pit_rooms();
+}
+
+template class Cave_hunt<Runtime_cave_policy, Event_sink>;
+template class Cave_hunt<Runtime_cave_policy, Null_event_sink>;
+template class Basic_cave_game<Event_sink>;
+template class Basic_cave_game<Null_event_sink>;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "cave.h"
+#include "cave_hunt.h"
+#include "events.h"
+#include "game.h"
+#include "random.h"
+
+namespace wumpus {
+
+// The numbers of things in a hunt, which may differ from the original game
+// in large caves.
+struct Cave_rules
+{
+    int bats{num_bats};
+    int pits{num_pits};
+    int arrows{num_arrows};
+};
+
+// The Cave_hunt policy for a Cave of any shape or size. The hazards are kept
+// as lists of rooms, so that nothing grows with the size of the cave but the
+// cave itself.
+class Runtime_cave_policy
+{
+public:
+    using Room = int;
+    static constexpr int arrow_range = wumpus::arrow_range;
+
+    // Keeps a reference to the cave. Throws std::invalid_argument if a count
+    // in the rules is negative, or the cave has too few rooms for the player
+    // and the hazards.
+    Runtime_cave_policy(const Cave& cave, const Cave_rules& rules);
+
+    const Cave& get_cave() const
+    {
+        return cave;
+    }
+
+    int num_rooms() const
+    {
+        return cave.num_rooms();
+    }
+
+    int degree(int room) const
+    {
+        return cave.adjacent_rooms(room).size();
+    }
+
+    int adjacent_room(int room, int i) const
+    {
+        return cave.adjacent_rooms(room)[i];
+    }
+
+    bool are_adjacent(int room, int other_room) const
+    {
+        return cave.are_adjacent(room, other_room);
+    }
+
+    int num_bats() const
+    {
+        return rules.bats;
+    }
+
+    int num_pits() const
+    {
+        return rules.pits;
+    }
+
+    int num_arrows() const
+    {
+        return rules.arrows;
+    }
+
+    std::int32_t* sampled_rooms()
+    {
+        return sampled.data();
+    }
+
+    void place_hazards(
+        const std::int32_t* bat_rooms_first,
+        const std::int32_t* pit_rooms_first)
+    {
+        std::copy(
+            bat_rooms_first, bat_rooms_first + rules.bats, bat_rooms.begin());
+        std::copy(
+            pit_rooms_first, pit_rooms_first + rules.pits, pit_rooms.begin());
+    }
+
+    bool has_bat(int room) const
+    {
+        return std::find(bat_rooms.begin(), bat_rooms.end(), room) !=
+            bat_rooms.end();
+    }
+
+    bool has_pit(int room) const
+    {
+        return std::find(pit_rooms.begin(), pit_rooms.end(), room) !=
+            pit_rooms.end();
+    }
+
+    Percepts percepts(int player_room, int wumpus_room) const
+    {
+        Percepts percepts;
+        for (int room : cave.adjacent_rooms(player_room))
+        {
+            percepts.wumpus = percepts.wumpus || room == wumpus_room;
+            percepts.bat = percepts.bat || has_bat(room);
+            percepts.pit = percepts.pit || has_pit(room);
+        }
+        return percepts;
+    }
+
+    const std::vector<std::int32_t>& get_bat_rooms() const
+    {
+        return bat_rooms;
+    }
+
+    const std::vector<std::int32_t>& get_pit_rooms() const
+    {
+        return pit_rooms;
+    }
+
+private:
+    const Cave& cave;
+    Cave_rules rules;
+    std::vector<std::int32_t> bat_rooms;
+    std::vector<std::int32_t> pit_rooms;
+    // Working storage for sampling the starting rooms.
+    std::vector<std::int32_t> sampled;
+};
+
+// The game played in a Cave of any shape or size, with the rules of
+// Basic_game. Rooms are given by index into the cave, as they have no
+// numbers. Setting up a hunt samples the starting rooms with sample_rooms().
+template <typename Sink>
+class Basic_cave_game : public Cave_hunt<Runtime_cave_policy, Sink>
+{
+public:
+    // The game keeps a reference to the cave. Throws std::invalid_argument if
+    // a count in the rules is negative, or the cave has too few rooms for the
+    // player and the hazards.
+    Basic_cave_game(
+        const Cave& cave,
+        Sink& sink,
+        const Cave_rules& rules = Cave_rules{},
+        std::uint64_t seed = random_seed());
+
+    const Cave& get_cave() const;
+    const std::vector<std::int32_t>& get_bat_rooms() const;
+    const std::vector<std::int32_t>& get_pit_rooms() const;
+};
+
+extern template class Cave_hunt<Runtime_cave_policy, Event_sink>;
+extern template class Cave_hunt<Runtime_cave_policy, Null_event_sink>;
+extern template class Basic_cave_game<Event_sink>;
+extern template class Basic_cave_game<Null_event_sink>;
+
+using Cave_game = Basic_cave_game<Event_sink>;
+using Silent_cave_game = Basic_cave_game<Null_event_sink>;
+}
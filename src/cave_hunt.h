@@ -0,0 +1,296 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include "cave.h"
+#include "events.h"
+#include "game.h"
+#include "random.h"
+#include "telemetry.h"
+
+namespace wumpus {
+
+// The rules of a hunt in a cave, written once for every cave engine. The
+// Cave_policy describes the cave and keeps the hazards in whatever form suits
+// it, and must provide:
+//
+//   Room                          the type a room is kept in
+//   arrow_range                   the rooms an arrow flies through at most
+//   num_rooms(), degree(room)     the size of the cave and of each room
+//   adjacent_room(room, i)        the tunnels of each room, in order
+//   are_adjacent(room, other)     false for any other that is not a room
+//   num_bats(), num_pits(), num_arrows()
+//   sampled_rooms()               room for 2 + bats + pits sampled rooms
+//   place_hazards(bats, pits)     from arrays of sampled rooms
+//   has_bat(room), has_pit(room)
+//   percepts(player, wumpus)      what the player senses in the given room
+//
+// Basic_cave_game answers these from a Cave at run time and
+// Static_cave_game from tables built at compile time, which the compiler
+// folds into the rules. Both draw from the generator in the same order, so
+// they play the same hunts from the same seed.
+template <typename Cave_policy, typename Sink>
+class Cave_hunt
+{
+public:
+    using Path = std::array<int, Cave_policy::arrow_range>;
+
+    void seed(std::uint64_t seed);
+
+    void init_hunt();
+
+    bool is_hunt_over() const;
+    void inform_player_of_hazards();
+    void end_hunt();
+
+    bool can_move(int room) const;
+    void move(int room);
+    // The path holds room indices, or -1 for none.
+    bool can_shoot(const Path& path) const;
+    void shoot(const Path& path);
+    void quit();
+
+    int get_player_room() const;
+    int get_wumpus_room() const;
+    Game_state get_game_state() const;
+    int get_arrows() const;
+    Percepts get_percepts() const;
+
+protected:
+    Cave_policy cave;
+
+    // The arguments construct the policy.
+    template <typename... Args>
+    Cave_hunt(Sink& sink, std::uint64_t seed, Args&&... args)
+        : cave{std::forward<Args>(args)...}, sink{sink}, rng{seed}
+    {
+    }
+
+private:
+    using Room = typename Cave_policy::Room;
+
+    Sink& sink;
+    Rng rng;
+
+    Room player_room{0};
+    Room wumpus_room{0};
+    Game_state state{Game_state::none};
+    int arrows{0};
+
+    void check_room_hazards();
+    int get_next_room_for_arrow_flight(
+        int previous_room, int current_room, int target);
+    void move_wumpus();
+};
+
+template <typename Cave_policy, typename Sink>
+void Cave_hunt<Cave_policy, Sink>::seed(std::uint64_t seed)
+{
+    rng.seed(seed);
+}
+
+template <typename Cave_policy, typename Sink>
+void Cave_hunt<Cave_policy, Sink>::init_hunt()
+{
+    telemetry::Timer timer{Timed_operation::init_hunt};
+    telemetry::count_hunt();
+    const int num_bats = cave.num_bats();
+    std::int32_t* rooms = cave.sampled_rooms();
+    sample_rooms(rng, cave.num_rooms(), 2 + num_bats + cave.num_pits(), rooms);
+
+    state = Game_state::none;
+    arrows = cave.num_arrows();
+    player_room = static_cast<Room>(rooms[0]);
+    wumpus_room = static_cast<Room>(rooms[1]);
+    cave.place_hazards(rooms + 2, rooms + 2 + num_bats);
+}
+
+template <typename Cave_policy, typename Sink>
+bool Cave_hunt<Cave_policy, Sink>::is_hunt_over() const
+{
+    return state != Game_state::none;
+}
+
+template <typename Cave_policy, typename Sink>
+void Cave_hunt<Cave_policy, Sink>::inform_player_of_hazards()
+{
+    Percepts percepts = get_percepts();
+    if (percepts.wumpus)
+        sink.on_event(Event::wumpus_adjacent);
+    if (percepts.bat)
+        sink.on_event(Event::bat_adjacent);
+    if (percepts.pit)
+        sink.on_event(Event::pit_adjacent);
+}
+
+template <typename Cave_policy, typename Sink>
+void Cave_hunt<Cave_policy, Sink>::end_hunt()
+{
+    switch (state)
+    {
+    case Game_state::player_eaten:
+        sink.on_event(Event::player_eaten);
+        break;
+    case Game_state::player_fell:
+        sink.on_event(Event::player_fell);
+        break;
+    case Game_state::player_shot:
+        sink.on_event(Event::player_shot);
+        break;
+    case Game_state::wumpus_dead:
+        sink.on_event(Event::wumpus_dead);
+        break;
+    case Game_state::player_quit:
+        sink.on_event(Event::player_quit);
+        break;
+    default:
+        throw std::logic_error("Invalid end of game state");
+    }
+}
+
+template <typename Cave_policy, typename Sink>
+bool Cave_hunt<Cave_policy, Sink>::can_move(int room) const
+{
+    return cave.are_adjacent(player_room, room);
+}
+
+template <typename Cave_policy, typename Sink>
+void Cave_hunt<Cave_policy, Sink>::move(int room)
+{
+    telemetry::Timer timer{Timed_operation::move};
+    telemetry::Turn turn{state};
+    if (can_move(room))
+        player_room = static_cast<Room>(room);
+    check_room_hazards();
+}
+
+template <typename Cave_policy, typename Sink>
+bool Cave_hunt<Cave_policy, Sink>::can_shoot(const Path& path) const
+{
+    return arrows > 0 && can_move(path[0]);
+}
+
+template <typename Cave_policy, typename Sink>
+void Cave_hunt<Cave_policy, Sink>::shoot(const Path& path)
+{
+    telemetry::Timer timer{Timed_operation::shoot};
+    telemetry::Turn turn{state};
+    telemetry::count_arrow();
+    --arrows;
+    int room = player_room;
+    int previous_room = -1;
+    for (int i = 0; i < Cave_policy::arrow_range; ++i)
+    {
+        int next_previous_room = room;
+        room = get_next_room_for_arrow_flight(previous_room, room, path[i]);
+        previous_room = next_previous_room;
+        if (room == wumpus_room)
+        {
+            state = Game_state::wumpus_dead;
+            return;
+        }
+        if (room == player_room)
+        {
+            state = Game_state::player_shot;
+            return;
+        }
+    }
+    move_wumpus();
+}
+
+template <typename Cave_policy, typename Sink>
+void Cave_hunt<Cave_policy, Sink>::quit()
+{
+    telemetry::Turn turn{state};
+    state = Game_state::player_quit;
+}
+
+template <typename Cave_policy, typename Sink>
+int Cave_hunt<Cave_policy, Sink>::get_player_room() const
+{
+    return player_room;
+}
+
+template <typename Cave_policy, typename Sink>
+int Cave_hunt<Cave_policy, Sink>::get_wumpus_room() const
+{
+    return wumpus_room;
+}
+
+template <typename Cave_policy, typename Sink>
+Game_state Cave_hunt<Cave_policy, Sink>::get_game_state() const
+{
+    return state;
+}
+
+template <typename Cave_policy, typename Sink>
+int Cave_hunt<Cave_policy, Sink>::get_arrows() const
+{
+    return arrows;
+}
+
+template <typename Cave_policy, typename Sink>
+Percepts Cave_hunt<Cave_policy, Sink>::get_percepts() const
+{
+    return cave.percepts(player_room, wumpus_room);
+}
+
+template <typename Cave_policy, typename Sink>
+void Cave_hunt<Cave_policy, Sink>::check_room_hazards()
+{
+    while (true)
+    {
+        if (player_room == wumpus_room)
+        {
+            state = Game_state::player_eaten;
+            return;
+        }
+        if (cave.has_pit(player_room))
+        {
+            state = Game_state::player_fell;
+            return;
+        }
+        if (cave.has_bat(player_room))
+        {
+            sink.on_event(Event::bat_carried);
+            telemetry::count_bat_carry();
+            player_room = static_cast<Room>(rng.uniform(0, cave.num_rooms()));
+            continue;
+        }
+        break;
+    }
+}
+
+template <typename Cave_policy, typename Sink>
+int Cave_hunt<Cave_policy, Sink>::get_next_room_for_arrow_flight(
+    int previous_room, int current_room, int target)
+{
+    if (target >= 0 && target != previous_room &&
+        cave.are_adjacent(current_room, target))
+        return target;
+    // Pick one of the other tunnels at random, turning back only from a dead
+    // end.
+    const int degree = cave.degree(current_room);
+    const bool can_turn_back = previous_room < 0 ||
+        (degree == 1 && cave.adjacent_room(current_room, 0) == previous_room);
+    int room = cave.adjacent_room(
+        current_room, rng.uniform(0, degree - (can_turn_back ? 0 : 1)));
+    if (room == previous_room && !can_turn_back)
+        room = cave.adjacent_room(current_room, degree - 1);
+    return room;
+}
+
+template <typename Cave_policy, typename Sink>
+void Cave_hunt<Cave_policy, Sink>::move_wumpus()
+{
+    sink.on_event(Event::wumpus_moved);
+    telemetry::count_wumpus_move();
+    wumpus_room = static_cast<Room>(cave.adjacent_room(
+        wumpus_room, rng.uniform(0, cave.degree(wumpus_room))));
+    if (player_room == wumpus_room)
+        state = Game_state::player_eaten;
+}
+}
@@ -0,0 +1,81 @@
+#include "cave_layout.h"
+
+namespace wumpus {
+
+Cave_layout::Cave_layout(Point cave_size)
+    : cave_size{cave_size}, room_radius{wumpus::room_radius(cave_size)}
+{
+    for (int room = 0; room < num_rooms; ++room)
+        centers[room] = room_center(room, cave_size);
+
+    Point low = centers[0];
+    Point high = centers[0];
+    for (const Point& center : centers)
+    {
+        low = {std::min(low.x, center.x), std::min(low.y, center.y)};
+        high = {std::max(high.x, center.x), std::max(high.y, center.y)};
+    }
+    grid_origin = {low.x - room_radius, low.y - room_radius};
+    cell_size = std::max(2.0f * room_radius, 1.0f);
+    auto cells = [this](float length) {
+        const int count = static_cast<int>(
+            std::ceil((length + 2.0f * room_radius) / cell_size));
+        return std::min(std::max(count, 1), max_grid_side);
+    };
+    columns = cells(high.x - low.x);
+    rows = cells(high.y - low.y);
+
+    // Visits the cells overlapped by the bounding square of each room.
+    auto for_each_cell = [this](int room, auto visit) {
+        const Point center = centers[room];
+        auto cell = [this](float offset, int cells) {
+            int index = static_cast<int>(std::floor(offset / cell_size));
+            return std::min(std::max(index, 0), cells - 1);
+        };
+        const float x = center.x - grid_origin.x;
+        const float y = center.y - grid_origin.y;
+        const int left = cell(x - room_radius, columns);
+        const int right = cell(x + room_radius, columns);
+        const int top = cell(y - room_radius, rows);
+        const int bottom = cell(y + room_radius, rows);
+        for (int y = top; y <= bottom; ++y)
+            for (int x = left; x <= right; ++x)
+                visit(y * columns + x);
+    };
+
+    for (int room = 0; room < num_rooms; ++room)
+        for_each_cell(room, [this](int cell) { ++cell_starts[cell + 1]; });
+    for (int i = 1; i <= columns * rows; ++i)
+        cell_starts[i] += cell_starts[i - 1];
+
+    std::array<int, max_grid_side * max_grid_side> next;
+    std::copy(cell_starts.begin(), cell_starts.end() - 1, next.begin());
+    for (int room = 0; room < num_rooms; ++room)
+    {
+        for_each_cell(room, [this, &next, room](int cell) {
+            cell_rooms[next[cell]++] = room;
+        });
+    }
+}
+
+int Cave_layout::room_at(Point position) const
+{
+    const float offset_x = position.x - grid_origin.x;
+    const float offset_y = position.y - grid_origin.y;
+    if (offset_x < 0 || offset_y < 0)
+        return -1;
+    const int x = static_cast<int>(offset_x / cell_size);
+    const int y = static_cast<int>(offset_y / cell_size);
+    if (x >= columns || y >= rows)
+        return -1;
+
+    const int cell = y * columns + x;
+    for (int i = cell_starts[cell]; i < cell_starts[cell + 1]; ++i)
+    {
+        const int room = cell_rooms[i];
+        if (is_on_circle(position, centers[room], room_radius))
+            return room;
+    }
+    return -1;
+}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "game.h"
+
+namespace wumpus {
+
+// Where the GUI draws the cave, as plain functions of the drawing area so
+// they can be used and measured without a window. The rooms lie on three
+// concentric rings of 5, 10 and 5 rooms around the centre of the area.
+
+struct Point
+{
+    float x{0};
+    float y{0};
+};
+
+// Returns the radius of each room in a cave drawn in an area of the given size.
+inline float room_radius(Point cave_size)
+{
+    return std::min(cave_size.x, cave_size.y) / 22.5f;
+}
+
+// Returns the centre of the room with the given index.
+inline Point room_center(int room, Point cave_size)
+{
+    const float pi = 3.14159265358979f;
+    float ring_radius = 3.0f * room_radius(cave_size);
+    if (room < 5)
+    {
+        room *= 2;
+    }
+    else if (room < 15)
+    {
+        room -= 5;
+        ring_radius *= 2.0f;
+    }
+    else
+    {
+        room -= 15;
+        room *= 2;
+        room += 1;
+        ring_radius *= 3.0f;
+    }
+    const float angle = 2.0f * pi * room / 10.0f;
+    return {ring_radius * std::sin(angle) + cave_size.x / 2.0f,
+            ring_radius * std::cos(angle) + cave_size.y / 2.0f};
+}
+
+inline bool is_on_circle(Point position, Point center, float radius)
+{
+    const float dx = position.x - center.x;
+    const float dy = position.y - center.y;
+    return dx * dx + dy * dy <= radius * radius;
+}
+
+// The room circles for one drawing area, computed once, with a uniform grid
+// over the rooms for hit testing. Each cell is as wide as a room and lists the
+// rooms that overlap it, so finding the room under a point tests at most a
+// few circles and takes no trigonometry. The grid covers only the square
+// around the outer ring, so it has a bounded number of cells whatever the
+// area, and a layout is built without allocating.
+class Cave_layout
+{
+public:
+    Cave_layout() = default;
+    explicit Cave_layout(Point cave_size);
+
+    Point size() const
+    {
+        return cave_size;
+    }
+
+    float radius() const
+    {
+        return room_radius;
+    }
+
+    Point center(int room) const
+    {
+        return centers[room];
+    }
+
+    // Returns the index of the room drawn at the given position, or -1 if
+    // there is none.
+    int room_at(Point position) const;
+
+private:
+    Point cave_size{0, 0};
+    float room_radius{0};
+    std::array<Point, num_rooms> centers{};
+
+    // The outer ring is 20 room radii across, so 10 cells of two radii; the
+    // rest allows for rounding.
+    static const int max_grid_side = 12;
+
+    Point grid_origin{0, 0};
+    float cell_size{1};
+    int columns{0};
+    int rows{0};
+    // The rooms of cell i are cell_rooms[cell_starts[i], cell_starts[i + 1]).
+    // A room overlaps at most four cells, since cells are as wide as a room.
+    std::array<int, max_grid_side * max_grid_side + 1> cell_starts{};
+    std::array<int, 4 * num_rooms> cell_rooms{};
+};
+}
@@ -0,0 +1,127 @@
+#include "command.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace wumpus {
+
+namespace {
+
+bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+}
+
+bool next_word(
+    const char*& begin, const char* end, const char*& word, int& size)
+{
+    while (begin != end && is_blank(*begin))
+        ++begin;
+    word = begin;
+    while (begin != end && !is_blank(*begin))
+        ++begin;
+    size = static_cast<int>(begin - word);
+    return size > 0;
+}
+
+bool parse_number(const char* word, int size, std::uint64_t& value)
+{
+    // Nineteen digits always fit.
+    if (size == 0 || size > 19)
+        return false;
+    value = 0;
+    for (int i = 0; i < size; ++i)
+    {
+        if (word[i] < '0' || word[i] > '9')
+            return false;
+        value = 10 * value + static_cast<std::uint64_t>(word[i] - '0');
+    }
+    return true;
+}
+
+bool parse_command(const char* begin, const char* end, Command& command)
+{
+    const char* word;
+    int size;
+    if (!next_word(begin, end, word, size) || size != 1)
+        return false;
+    int max_targets;
+    switch (word[0])
+    {
+    case 'm':
+        command.type = Command::Type::move;
+        max_targets = 1;
+        break;
+    case 's':
+        command.type = Command::Type::shoot;
+        max_targets = arrow_range;
+        break;
+    case 'q':
+        command.type = Command::Type::quit;
+        max_targets = 0;
+        break;
+    default:
+        return false;
+    }
+
+    command.targets = {{-1, -1, -1}};
+    int num_targets = 0;
+    std::uint64_t room;
+    while (next_word(begin, end, word, size))
+    {
+        if (num_targets == max_targets || !parse_number(word, size, room) ||
+            room < 1 || room > num_rooms)
+            return false;
+        command.targets[num_targets++] = static_cast<int>(room);
+    }
+    return num_targets == max_targets ||
+        (command.type == Command::Type::shoot && num_targets > 0);
+}
+
+Script_reader::Script_reader(const char* begin, const char* end)
+    : position{begin}, end{end}
+{
+}
+
+Script_reader::Line_type Script_reader::next(
+    bool& has_seed, std::uint64_t& seed, Command& command)
+{
+    while (position != end)
+    {
+        const char* line_end = static_cast<const char*>(std::memchr(
+            position, '\n', static_cast<std::size_t>(end - position)));
+        if (!line_end)
+            line_end = end;
+        const char* begin = position;
+        position = line_end == end ? end : line_end + 1;
+        ++line;
+
+        const char* word;
+        int size;
+        const char* rest = begin;
+        if (!next_word(rest, line_end, word, size) || word[0] == '#')
+            continue;
+        if (size == 1 && word[0] == 'g')
+        {
+            has_seed = next_word(rest, line_end, word, size);
+            if ((has_seed && !parse_number(word, size, seed)) ||
+                next_word(rest, line_end, word, size))
+                throw std::runtime_error(
+                    "Line " + std::to_string(line) + ": bad seed");
+            return Line_type::game;
+        }
+        if (!parse_command(begin, line_end, command))
+            throw std::runtime_error(
+                "Line " + std::to_string(line) + ": not a command");
+        return Line_type::command;
+    }
+    return Line_type::end;
+}
+
+long long Script_reader::line_number() const
+{
+    return line;
+}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "game.h"
+
+namespace wumpus {
+
+// The text commands of the game, as listed on the title screen:
+//
+//   m ROOM               moves to an adjacent room
+//   s ROOM [ROOM ROOM]   shoots an arrow along up to arrow_range rooms
+//   q                    quits the hunt
+//
+// Rooms are the numbers shown to the player.
+struct Command
+{
+    enum class Type : std::uint8_t
+    {
+        move,
+        shoot,
+        quit
+    } type{Type::quit};
+    // Room numbers, as passed to the game, or -1 for none. A move uses the
+    // first.
+    std::array<int, arrow_range> targets{{-1, -1, -1}};
+};
+
+// Parses the command in [begin, end), a line without its newline, in place.
+// Returns false if it is not a well-formed command.
+bool parse_command(const char* begin, const char* end, Command& command);
+
+// Splits the next word off the front of [begin, end), skipping blanks.
+// Returns false if there is none.
+bool next_word(
+    const char*& begin, const char* end, const char*& word, int& size);
+
+// Parses a word of decimal digits. Returns false if it is anything else or
+// does not fit.
+bool parse_number(const char* word, int size, std::uint64_t& value);
+
+// Applies a command to the game if its rules allow it. Returns whether it
+// did.
+template <typename Sink>
+bool apply_command(Basic_game<Sink>& game, const Command& command)
+{
+    switch (command.type)
+    {
+    case Command::Type::move:
+        if (!game.can_move(command.targets[0]))
+            return false;
+        game.move(command.targets[0]);
+        return true;
+    case Command::Type::shoot:
+        if (!game.can_shoot(command.targets))
+            return false;
+        game.shoot(command.targets);
+        return true;
+    case Command::Type::quit:
+        game.quit();
+        return true;
+    }
+    return false;
+}
+
+// Reads scripts of hunts in place, one line at a time, without copying.
+// Blank lines and lines starting with # are skipped, "g [SEED]" starts a hunt
+// and every other line is a command for the current hunt.
+class Script_reader
+{
+public:
+    enum class Line_type
+    {
+        end,
+        game,
+        command
+    };
+
+    Script_reader(const char* begin, const char* end);
+
+    // Reads the next line that is not skipped. A game line sets has_seed and
+    // seed, and a command line sets command. Throws std::runtime_error,
+    // naming the line, if it is malformed.
+    Line_type next(bool& has_seed, std::uint64_t& seed, Command& command);
+
+    // The number of the line last read, counting from 1.
+    long long line_number() const;
+
+private:
+    const char* position;
+    const char* end;
+    long long line{0};
+};
+}
@@ -0,0 +1,421 @@
+// Plays scripts of hunts written in the game's text commands, from files or
+// from stdin, and prints each hunt as text or as one compact line. A script
+// holds any number of hunts:
+//
+//   # Comments and blank lines are skipped.
+//   g 42          starts a hunt from seed 42
+//   g             starts a hunt from the next seed
+//   m 7           moves to room 7
+//   s 3 12 9      shoots an arrow along rooms 3, 12 and 9
+//   q             quits
+//
+// A hunt without a seed of its own takes --seed plus 2N if it is the Nth
+// hunt, counting from 0 every hunt of every script, seeded or not, as the
+// other tools number their games. Commands before the first g play such a
+// hunt. A hunt ends at the next g or at the end of its script, over or not.
+// Commands the rules do not allow, or that come after the hunt is over, are
+// rejected and counted.
+// The compact output is one line per hunt:
+//
+//   SEED OUTCOME ACTIONS REJECTED ARROWS
+//
+// where OUTCOME is a game state name, none for a hunt left unfinished.
+// A summary goes to stderr.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "command.h"
+#include "events.h"
+#include "game.h"
+#include "random.h"
+
+using namespace wumpus;
+
+namespace {
+
+struct Options
+{
+    bool compact{false};
+    std::uint64_t seed{random_seed()};
+    std::vector<std::string> paths;
+};
+
+struct Results
+{
+    long long hunts{0};
+    long long actions{0};
+    long long rejected{0};
+    std::array<long long, num_game_states> outcomes{};
+};
+
+// Collects the output and writes it in large blocks.
+class Output
+{
+public:
+    Output()
+    {
+        text.reserve(2 * block_size);
+    }
+
+    std::string& buffer()
+    {
+        return text;
+    }
+
+    void flush_if_full()
+    {
+        if (text.size() >= block_size)
+            flush();
+    }
+
+    void flush()
+    {
+        if (std::fwrite(text.data(), 1, text.size(), stdout) != text.size())
+            throw std::runtime_error("Cannot write the output");
+        text.clear();
+    }
+
+private:
+    static const std::size_t block_size = 1 << 16;
+
+    std::string text;
+};
+
+void append_number(std::string& out, std::uint64_t value)
+{
+    char digits[24];
+    char* end = digits + sizeof digits;
+    char* p = end;
+    do
+    {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value);
+    out.append(p, end);
+}
+
+// Writes the message of each event on a line of its own, unless silenced.
+class Text_sink : public Event_sink
+{
+public:
+    Text_sink(std::string& out, bool is_silent) : out{out}, is_silent{is_silent}
+    {
+    }
+
+    void on_event(Event event) override
+    {
+        if (is_silent)
+            return;
+        out += event_message(event);
+        out += '\n';
+    }
+
+private:
+    std::string& out;
+    const bool is_silent;
+};
+
+// Plays the hunts of one script.
+class Player
+{
+public:
+    Player(const Options& options, Output& output)
+        : options{options},
+          output{output},
+          out{output.buffer()},
+          sink{out, options.compact},
+          game{sink, 0}
+    {
+    }
+
+    void play(const char* begin, const char* end, Results& results)
+    {
+        Script_reader reader{begin, end};
+        bool has_seed;
+        std::uint64_t seed;
+        Command command;
+        while (true)
+        {
+            const Script_reader::Line_type type =
+                reader.next(has_seed, seed, command);
+            if (type == Script_reader::Line_type::end)
+                break;
+            if (type == Script_reader::Line_type::game)
+            {
+                finish_hunt(results);
+                start_hunt(has_seed ? seed : next_seed());
+                continue;
+            }
+            if (!is_playing)
+                start_hunt(next_seed());
+            act(command, results);
+        }
+        finish_hunt(results);
+    }
+
+private:
+    const Options& options;
+    Output& output;
+    std::string& out;
+    Text_sink sink;
+    Game game;
+
+    bool is_playing{false};
+    std::uint64_t hunt_seed{0};
+    long long hunts{0};
+    long long actions{0};
+    long long rejected{0};
+
+    std::uint64_t next_seed() const
+    {
+        return options.seed + 2 * static_cast<std::uint64_t>(hunts);
+    }
+
+    void start_hunt(std::uint64_t seed)
+    {
+        hunt_seed = seed;
+        is_playing = true;
+        actions = 0;
+        rejected = 0;
+        ++hunts;
+        game.seed(seed);
+        game.init_hunt();
+        if (options.compact)
+            return;
+        out += "hunt ";
+        append_number(out, static_cast<std::uint64_t>(hunts));
+        out += " seed ";
+        append_number(out, seed);
+        out += '\n';
+        describe_room();
+    }
+
+    void act(const Command& command, Results& results)
+    {
+        if (!options.compact)
+            echo(command);
+        if (game.is_hunt_over() || !apply_command(game, command))
+        {
+            ++rejected;
+            ++results.rejected;
+            if (!options.compact)
+                out += game.is_hunt_over() ? "The hunt is over.\n"
+                                           : "You cannot do that.\n";
+            return;
+        }
+        ++actions;
+        ++results.actions;
+        if (game.is_hunt_over())
+            game.end_hunt();
+        else if (!options.compact)
+            describe_room();
+    }
+
+    void finish_hunt(Results& results)
+    {
+        if (!is_playing)
+            return;
+        is_playing = false;
+        const Game_state state = game.get_game_state();
+        ++results.hunts;
+        ++results.outcomes[static_cast<int>(state)];
+        if (options.compact)
+        {
+            append_number(out, hunt_seed);
+            out += ' ';
+            out += game_state_name(state);
+            out += ' ';
+            append_number(out, static_cast<std::uint64_t>(actions));
+            out += ' ';
+            append_number(out, static_cast<std::uint64_t>(rejected));
+            out += ' ';
+            append_number(out, static_cast<std::uint64_t>(game.get_arrows()));
+            out += '\n';
+        }
+        else
+        {
+            out += "outcome: ";
+            out += game_state_name(state);
+            out += "\n\n";
+        }
+        output.flush_if_full();
+    }
+
+    void describe_room()
+    {
+        const Hunt_state& hunt = game.get_state();
+        const int room = hunt.player_room();
+        out += "You are in room ";
+        append_number(out, static_cast<std::uint64_t>(hunt.numbers[room]));
+        out += ". Tunnels lead to";
+        for (int adjacent : room_connections[room])
+        {
+            out += ' ';
+            append_number(
+                out, static_cast<std::uint64_t>(hunt.numbers[adjacent]));
+        }
+        out += ". Arrows: ";
+        append_number(out, static_cast<std::uint64_t>(hunt.arrows));
+        out += ".\n";
+        game.inform_player_of_hazards();
+    }
+
+    void echo(const Command& command)
+    {
+        switch (command.type)
+        {
+        case Command::Type::move:
+            out += "> m";
+            break;
+        case Command::Type::shoot:
+            out += "> s";
+            break;
+        case Command::Type::quit:
+            out += "> q";
+            break;
+        }
+        for (int target : command.targets)
+        {
+            if (target < 0)
+                break;
+            out += ' ';
+            append_number(out, static_cast<std::uint64_t>(target));
+        }
+        out += '\n';
+    }
+};
+
+// Reads all of a file, or of stdin for "-", into memory.
+std::vector<char> read_script(const std::string& path)
+{
+    std::FILE* file = path == "-" ? stdin : std::fopen(path.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("Cannot open " + path);
+    std::vector<char> text(1 << 16);
+    std::size_t size = 0;
+    while (true)
+    {
+        size += std::fread(text.data() + size, 1, text.size() - size, file);
+        if (size < text.size())
+            break;
+        text.resize(2 * text.size());
+    }
+    const bool failed = std::ferror(file) != 0;
+    if (file != stdin)
+        std::fclose(file);
+    if (failed)
+        throw std::runtime_error("Cannot read " + path);
+    text.resize(size);
+    return text;
+}
+
+double percent(long long part, long long whole)
+{
+    return 100.0 * part / std::max(whole, 1LL);
+}
+
+void print_usage()
+{
+    std::cerr << "Usage: wumpus_console [--output text|compact] [--seed N] "
+                 "[FILE...]\n"
+                 "Reads stdin if no file is given, or for -."
+              << std::endl;
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-" || arg.compare(0, 2, "--") != 0)
+        {
+            options.paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--output" && (value == "text" || value == "compact"))
+            options.compact = value == "compact";
+        else if (arg == "--output")
+            throw std::invalid_argument("Unknown output: " + value);
+        else if (arg == "--seed")
+            options.seed = std::stoull(value);
+        else
+            throw std::invalid_argument("Unknown option: " + arg);
+    }
+    if (options.paths.empty())
+        options.paths.push_back("-");
+    return options;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        options = parse_options(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    Results results;
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        Output output;
+        Player player{options, output};
+        for (const std::string& path : options.paths)
+        {
+            const std::vector<char> script = read_script(path);
+            try
+            {
+                player.play(
+                    script.data(), script.data() + script.size(), results);
+            }
+            catch (const std::runtime_error& e)
+            {
+                throw std::runtime_error(path + ": " + e.what());
+            }
+        }
+        output.flush();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cerr << "hunts: " << results.hunts << std::endl
+              << std::fixed << std::setprecision(2);
+    for (int i = 0; i < num_game_states; ++i)
+    {
+        std::cerr << game_state_name(static_cast<Game_state>(i)) << ": "
+                  << results.outcomes[i] << " ("
+                  << percent(results.outcomes[i], results.hunts) << "%)"
+                  << std::endl;
+    }
+    std::cerr << "actions: " << results.actions << std::endl
+              << "rejected: " << results.rejected << std::endl
+              << "hunts/sec: " << std::setprecision(0)
+              << results.hunts / elapsed.count() << std::endl;
+    return EXIT_SUCCESS;
+}
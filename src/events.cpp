@@ -0,0 +1,40 @@
+#include "events.h"
+
+#include <array>
+#include <ostream>
+#include <stdexcept>
+
+namespace wumpus {
+
+namespace {
+
+const std::array<std::string, num_events> event_messages{
+    {"You smell the wumpus!",
+     "You hear flapping!",
+     "You feel a breeze!",
+     "You are carried away by a bat!",
+     "You hear the sound of the wumpus moving!",
+     "Congratulations, you have slain the wumpus!",
+     "You have been eaten by the wumpus!",
+     "You have fallen into a bottomless pit!",
+     "You have been hit with your own arrow!",
+     "You flee the cave!"}};
+}
+
+const std::string& event_message(Event event)
+{
+    int index = static_cast<int>(event);
+    if (index < 0 || index >= num_events)
+        throw std::logic_error("Invalid event");
+    return event_messages[index];
+}
+
+Text_event_sink::Text_event_sink(std::ostream& out) : out{out}
+{
+}
+
+void Text_event_sink::on_event(Event event)
+{
+    out << event_message(event) << '\n';
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace wumpus {
+
+// Everything the game reports to the player, as compact codes.
+enum class Event : std::uint8_t
+{
+    wumpus_adjacent,
+    bat_adjacent,
+    pit_adjacent,
+    bat_carried,
+    wumpus_moved,
+    wumpus_dead,
+    player_eaten,
+    player_fell,
+    player_shot,
+    player_quit
+};
+
+const int num_events = static_cast<int>(Event::player_quit) + 1;
+
+// Returns the text shown to the player for the given event.
+const std::string& event_message(Event event);
+
+// Receives the events of a game through a virtual call. Derive from this to
+// consume events at run time.
+class Event_sink
+{
+public:
+    virtual ~Event_sink() = default;
+
+    virtual void on_event(Event event) = 0;
+};
+
+// Discards every event. A game using this sink calls it directly, so the
+// calls compile to nothing.
+class Null_event_sink
+{
+public:
+    void on_event(Event)
+    {
+    }
+};
+
+// Writes the message for each event to a stream, one per line, without
+// flushing.
+class Text_event_sink : public Event_sink
+{
+public:
+    explicit Text_event_sink(std::ostream& out);
+
+    void on_event(Event event) override;
+
+private:
+    std::ostream& out;
+};
+}
@@ -1,33 +1,58 @@
 #include "game.h"
 
-#include <vector>
 #include <algorithm>
 #include <sstream>
-#include <iostream>
 #include <stdexcept>
 
-#include "random.h"
+#include "telemetry.h"
 
 namespace wumpus {
 
-const std::string Game::wumpus_adjacent_message = "You smell the wumpus!";
-const std::string Game::bat_adjacent_message = "You hear flapping!";
-const std::string Game::pit_adjacent_message = "You feel a breeze!";
-const std::string Game::wumpus_dead_message =
-    "Congratulations, you have slain the wumpus!";
-const std::string Game::player_eaten_message =
-    "You have been eaten by the wumpus!";
-const std::string Game::player_dropped_in_random_room_message =
-    "You are carried away by a bat!";
-const std::string Game::player_fell_message =
-    "You have fallen into a bottomless pit!";
-const std::string Game::player_shot_message =
-    "You have been hit with your own arrow!";
-const std::string Game::player_quit_message = "You flee the cave!";
-const std::string Game::wumpus_moves_message =
-    "You hear the sound of the wumpus moving!";
-
-std::string Game::game_info()
+Hazard_masks random_hazard_masks(Rng& rng)
+{
+    // Draw distinct locations with a partial Fisher-Yates shuffle.
+    std::array<int, num_rooms> random_locations;
+    for (int i = 0; i < num_rooms; ++i)
+        random_locations[i] = i;
+    for (int i = 0; i < 2 + num_bats + num_pits; ++i)
+        std::swap(
+            random_locations[i],
+            random_locations[rng.uniform(i, num_rooms)]);
+
+    Hazard_masks hazards;
+    int index = 0;
+    hazards.player = room_bit(random_locations[index++]);
+    hazards.wumpus = room_bit(random_locations[index++]);
+    while (index < 2 + num_bats)
+        hazards.bats |= room_bit(random_locations[index++]);
+    while (index < 2 + num_bats + num_pits)
+        hazards.pits |= room_bit(random_locations[index++]);
+    return hazards;
+}
+
+const char* game_state_name(Game_state state)
+{
+    switch (state)
+    {
+    case Game_state::none:
+        return "none";
+    case Game_state::player_eaten:
+        return "player_eaten";
+    case Game_state::player_fell:
+        return "player_fell";
+    case Game_state::player_shot:
+        return "player_shot";
+    case Game_state::wumpus_dead:
+        return "wumpus_dead";
+    case Game_state::player_quit:
+        return "player_quit";
+    default:
+        throw std::logic_error("Invalid game state");
+    }
+}
+
+template <typename Sink>
+std::string Basic_game<Sink>::game_info()
 {
     std::stringstream ss;
     ss << "Welcome to Hunt the Wumpus." << std::endl
@@ -52,255 +77,274 @@ std::string Game::game_info()
        << num_bats << " bats in the cave." << std::endl
        << "When you enter a room you will be told if a hazard is nearby:"
        << std::endl
-       << "    \"" << wumpus_adjacent_message << "\": It's in an adjacent room."
-       << std::endl
-       << "    \"" << pit_adjacent_message
+       << "    \"" << event_message(Event::wumpus_adjacent)
+       << "\": It's in an adjacent room." << std::endl
+       << "    \"" << event_message(Event::pit_adjacent)
        << "\": One of the adjacent rooms is a bottomless pit." << std::endl
-       << "    \"" << bat_adjacent_message
+       << "    \"" << event_message(Event::bat_adjacent)
        << "\": A giant bat is in an adjacent room." << std::endl;
     return ss.str();
 }
 
-Game::Game(std::ostream& out) : out{out}
+template <typename Sink>
+Basic_game<Sink>::Basic_game(Sink& sink, std::uint64_t seed)
+    : sink{sink}, rng{seed}, hunt{}
 {
-    for (int i = 0; i < num_rooms; ++i)
-    {
-        rooms[i] = Room(i + 1);
-        for (int j = 0; j < connections_per_room; ++j)
-            rooms[i].adjacent_rooms[j] = &rooms[room_connections[i][j]];
-    }
 }
 
-void Game::init_hunt()
+template <typename Sink>
+void Basic_game<Sink>::seed(std::uint64_t seed)
 {
-    state = Game_state::none;
-    arrows = num_arrows;
-    reset_rooms();
-    shuffle_room_numbers();
-    place_player_and_hazards();
+    rng.seed(seed);
 }
 
-void Game::reset_rooms()
+template <typename Sink>
+void Basic_game<Sink>::init_hunt()
 {
-    for (Room& room : rooms)
-    {
-        room.wumpus = false;
-        room.bat = false;
-        room.pit = false;
-    }
+    telemetry::Timer timer{Timed_operation::init_hunt};
+    telemetry::count_hunt();
+    hunt.state = Game_state::none;
+    hunt.arrows = num_arrows;
+    shuffle_room_numbers();
+    place_player_and_hazards();
 }
 
-void Game::shuffle_room_numbers()
+template <typename Sink>
+void Basic_game<Sink>::shuffle_room_numbers()
 {
+    // Start from the identity numbering so that a hunt depends only on the
+    // state of the random number generator.
+    for (int i = 0; i < num_rooms; ++i)
+        hunt.numbers[i] = static_cast<std::int8_t>(i + 1);
     for (int i = 0; i < num_rooms; ++i)
-        std::swap(rooms[i].number, rooms[random(i, num_rooms)].number);
-    sort_adjacent_rooms(); // This is necessary to eliminate patterns in the
-                           // display of adjacent rooms.
+        std::swap(hunt.numbers[i], hunt.numbers[rng.uniform(i, num_rooms)]);
+    hunt.indices[0] = -1;
+    for (int i = 0; i < num_rooms; ++i)
+        hunt.indices[hunt.numbers[i]] = static_cast<std::int8_t>(i);
 }
 
-void Game::sort_adjacent_rooms()
+template <typename Sink>
+void Basic_game<Sink>::place_player_and_hazards()
 {
-    for (Room& room : rooms)
-    {
-        std::sort(
-            std::begin(room.adjacent_rooms),
-            std::end(room.adjacent_rooms),
-            [](Room* first_room, Room* second_room) {
-                return first_room->number < second_room->number;
-            });
-    }
+    hunt.hazards = random_hazard_masks(rng);
 }
 
-void Game::place_player_and_hazards()
+template <typename Sink>
+bool Basic_game<Sink>::is_hunt_over() const
 {
-    std::vector<int> random_locations;
-    for (int i = 0; i < 2 + num_bats + num_pits; ++i)
-        random_locations.push_back(random(0, num_rooms, random_locations));
-
-    int index = 0;
-    player_room = &rooms[random_locations[index++]];
-    wumpus_room = &rooms[random_locations[index++]];
-    ;
-    wumpus_room->wumpus = true;
-    while (index < 2 + num_bats)
-        rooms[random_locations[index++]].bat = true;
-    while (index < 2 + num_bats + num_pits)
-        rooms[random_locations[index++]].pit = true;
+    return hunt.state != Game_state::none;
 }
 
-bool Game::is_hunt_over() const
+template <typename Sink>
+void Basic_game<Sink>::inform_player_of_hazards()
 {
-    return state != Game_state::none;
+    Percepts percepts = hunt.hazards.percepts();
+    if (percepts.wumpus)
+        sink.on_event(Event::wumpus_adjacent);
+    if (percepts.bat)
+        sink.on_event(Event::bat_adjacent);
+    if (percepts.pit)
+        sink.on_event(Event::pit_adjacent);
 }
 
-void Game::inform_player_of_hazards()
+template <typename Sink>
+void Basic_game<Sink>::end_hunt()
 {
-    bool wumpus = false, bat = false, pit = false;
-    for (const Room* room : player_room->adjacent_rooms)
-    {
-        if (room->wumpus)
-            wumpus = true;
-        if (room->bat)
-            bat = true;
-        if (room->pit)
-            pit = true;
-    }
-    if (wumpus)
-        out << wumpus_adjacent_message << std::endl;
-    if (bat)
-        out << bat_adjacent_message << std::endl;
-    if (pit)
-        out << pit_adjacent_message << std::endl;
-}
-
-void Game::end_hunt()
-{
-    switch (state)
+    switch (hunt.state)
     {
     case Game_state::player_eaten:
-        out << player_eaten_message << std::endl;
+        sink.on_event(Event::player_eaten);
         break;
     case Game_state::player_fell:
-        out << player_fell_message << std::endl;
+        sink.on_event(Event::player_fell);
         break;
     case Game_state::player_shot:
-        out << player_shot_message << std::endl;
+        sink.on_event(Event::player_shot);
         break;
     case Game_state::wumpus_dead:
-        out << wumpus_dead_message << std::endl;
+        sink.on_event(Event::wumpus_dead);
         break;
     case Game_state::player_quit:
-        out << player_quit_message << std::endl;
+        sink.on_event(Event::player_quit);
         break;
     default:
         throw std::logic_error("Invalid end of game state");
     }
 }
 
-bool Game::can_move(int target) const
+template <typename Sink>
+bool Basic_game<Sink>::can_move(int target) const
 {
     return target_is_adjacent(target);
 }
 
-void Game::move(int target)
+template <typename Sink>
+void Basic_game<Sink>::move(int target)
 {
-    for (Room* room : player_room->adjacent_rooms)
-        if (room->number == target)
-            player_room = room;
+    telemetry::Timer timer{Timed_operation::move};
+    telemetry::Turn turn{hunt.state};
+    if (target_is_adjacent(target))
+        hunt.hazards.player = room_bit(hunt.index_of(target));
     check_room_hazards();
 }
 
-bool Game::can_shoot(const std::array<int, arrow_range>& targets) const
+template <typename Sink>
+bool Basic_game<Sink>::can_shoot(
+    const std::array<int, arrow_range>& targets) const
 {
-    return arrows > 0 && target_is_adjacent(targets[0]);
+    return hunt.arrows > 0 && target_is_adjacent(targets[0]);
 }
 
-void Game::shoot(const std::array<int, arrow_range>& targets)
+template <typename Sink>
+void Basic_game<Sink>::shoot(
+    const std::array<int, arrow_range>& targets)
 {
-    --arrows;
-    Room* room = player_room;
-    Room* previous_room = nullptr;
+    telemetry::Timer timer{Timed_operation::shoot};
+    telemetry::Turn turn{hunt.state};
+    telemetry::count_arrow();
+    --hunt.arrows;
+    const int player_room = hunt.player_room();
+    int room = player_room;
+    int previous_room = -1;
     for (int i = 0; i < arrow_range; ++i)
     {
-        Room* next_previous_room = room;
+        int next_previous_room = room;
         room = get_next_room_for_arrow_flight(previous_room, room, targets[i]);
         previous_room = next_previous_room;
-        if (room->wumpus)
+        if (hunt.hazards.wumpus & room_bit(room))
         {
-            state = Game_state::wumpus_dead;
+            hunt.state = Game_state::wumpus_dead;
             return;
         }
-        if (room->number == player_room->number)
+        if (room == player_room)
         {
-            state = Game_state::player_shot;
+            hunt.state = Game_state::player_shot;
             return;
         }
     }
     move_wumpus();
 }
 
-void Game::quit()
+template <typename Sink>
+void Basic_game<Sink>::quit()
 {
-    state = Game_state::player_quit;
+    telemetry::Turn turn{hunt.state};
+    hunt.state = Game_state::player_quit;
 }
 
-bool Game::target_is_adjacent(int target) const
+template <typename Sink>
+bool Basic_game<Sink>::target_is_adjacent(int target) const
 {
-    for (const Room* room : player_room->adjacent_rooms)
-        if (room->number == target)
-            return true;
-    return false;
+    int index = hunt.index_of(target);
+    if (index < 0)
+        return false;
+    return (hunt.hazards.adjacent_to_player() & room_bit(index)) != 0;
 }
 
-void Game::check_room_hazards()
+template <typename Sink>
+void Basic_game<Sink>::check_room_hazards()
 {
+    Hazard_masks& hazards = hunt.hazards;
     while (true)
     {
-        if (player_room->wumpus)
+        if (hazards.player & hazards.wumpus)
         {
-            state = Game_state::player_eaten;
+            hunt.state = Game_state::player_eaten;
             return;
         }
-        if (player_room->pit)
+        if (hazards.player & hazards.pits)
         {
-            state = Game_state::player_fell;
+            hunt.state = Game_state::player_fell;
             return;
         }
-        if (player_room->bat)
+        if (hazards.player & hazards.bats)
         {
-            out << player_dropped_in_random_room_message << std::endl;
-            player_room = &rooms[random(0, num_rooms)];
+            sink.on_event(Event::bat_carried);
+            telemetry::count_bat_carry();
+            hazards.player = room_bit(rng.uniform(0, num_rooms));
             continue;
         }
         break;
     }
 }
 
-Room* Game::get_next_room_for_arrow_flight(
-    const Room* previous_room, const Room* current_room, int target) const
+template <typename Sink>
+int Basic_game<Sink>::get_next_room_for_arrow_flight(
+    int previous_room, int current_room, int target)
+{
+    int target_room = hunt.index_of(target);
+    if (target_room >= 0 && target_room != previous_room &&
+        (adjacency_masks[current_room] & room_bit(target_room)))
+        return target_room;
+    std::array<int, connections_per_room> candidate_rooms;
+    int num_candidates = 0;
+    for (int room : room_connections[current_room])
+        if (room != previous_room)
+            candidate_rooms[num_candidates++] = room;
+    return candidate_rooms[rng.uniform(0, num_candidates)];
+}
+
+template <typename Sink>
+void Basic_game<Sink>::move_wumpus()
+{
+    sink.on_event(Event::wumpus_moved);
+    telemetry::count_wumpus_move();
+    Hazard_masks& hazards = hunt.hazards;
+    int wumpus_room = hunt.wumpus_room();
+    hazards.wumpus = room_bit(
+        room_connections[wumpus_room][rng.uniform(0, connections_per_room)]);
+    if (hazards.player & hazards.wumpus)
+        hunt.state = Game_state::player_eaten;
+}
+
+template <typename Sink>
+const Hunt_state& Basic_game<Sink>::get_state() const
 {
-    int previous_number = previous_room ? previous_room->number : 0;
-    if (previous_number != target)
-        for (Room* room : current_room->adjacent_rooms)
-            if (room->number == target)
-                return room;
-    const std::array<Room*, connections_per_room>& candidate_rooms =
-        current_room->adjacent_rooms;
-    return candidate_rooms[random_if(
-        0, connections_per_room, [candidate_rooms, previous_number](int x) {
-            return candidate_rooms[x]->number != previous_number;
-        })];
+    return hunt;
 }
 
-void Game::move_wumpus()
+template <typename Sink>
+void Basic_game<Sink>::set_state(const Hunt_state& state)
 {
-    out << wumpus_moves_message << std::endl;
-    Room* new_wumpus_room =
-        wumpus_room->adjacent_rooms[random(0, connections_per_room)];
-    new_wumpus_room->wumpus = true;
-    wumpus_room->wumpus = false;
-    wumpus_room = new_wumpus_room;
-    if (player_room->wumpus)
-        state = Game_state::player_eaten;
+    hunt = state;
 }
 
-const std::array<Room, num_rooms>& Game::get_rooms() const
+template <typename Sink>
+int Basic_game<Sink>::get_room_number(int room) const
 {
-    return rooms;
+    return hunt.numbers[room];
 }
 
-const Room* Game::get_player_room() const
+template <typename Sink>
+int Basic_game<Sink>::get_player_room() const
 {
-    return player_room;
+    return hunt.player_room();
 }
 
-Game_state Game::get_game_state() const
+template <typename Sink>
+Game_state Basic_game<Sink>::get_game_state() const
 {
-    return state;
+    return hunt.state;
 }
 
-int Game::get_arrows() const
+template <typename Sink>
+int Basic_game<Sink>::get_arrows() const
 {
-    return arrows;
+    return hunt.arrows;
 }
+
+template <typename Sink>
+const Hazard_masks& Basic_game<Sink>::get_hazard_masks() const
+{
+    return hunt.hazards;
+}
+
+template <typename Sink>
+Percepts Basic_game<Sink>::get_percepts() const
+{
+    return hunt.hazards.percepts();
+}
+
+template class Basic_game<Event_sink>;
+template class Basic_game<Null_event_sink>;
 }
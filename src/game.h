@@ -1,13 +1,23 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <string>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "events.h"
+#include "random.h"
 
 namespace wumpus {
 
 const int num_rooms = 20;
 const int connections_per_room = 3;
-const std::array<std::array<int, connections_per_room>, num_rooms> room_connections{
+constexpr std::array<std::array<int, connections_per_room>, num_rooms>
+    room_connections{
     {{{1, 4, 5}},    {{2, 0, 7}},    {{3, 1, 9}},    {{4, 2, 11}},
      {{0, 3, 13}},   {{6, 14, 0}},   {{7, 5, 15}},   {{8, 6, 1}},
      {{9, 7, 16}},   {{10, 8, 2}},   {{11, 9, 17}},  {{12, 10, 3}},
@@ -20,24 +30,86 @@ const int num_pits = 2;
 const int arrow_range = 3;
 const int num_arrows = 5;
 
-struct Room
+// A set of rooms, with bit i standing for the room at index i.
+using Room_mask = std::uint32_t;
+static_assert(num_rooms <= 32, "Every room must fit in a room mask");
+
+constexpr Room_mask room_bit(int index)
+{
+    return Room_mask{1} << index;
+}
+
+// Returns the index of the lowest room in a non-empty mask.
+inline int room_index(Room_mask rooms)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, rooms);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(rooms);
+#endif
+}
+
+struct Adjacency_masks
+{
+    Room_mask masks[num_rooms];
+
+    constexpr Room_mask operator[](int index) const
+    {
+        return masks[index];
+    }
+};
+
+constexpr Adjacency_masks make_adjacency_masks()
+{
+    Adjacency_masks result{};
+    for (int i = 0; i < num_rooms; ++i)
+        for (int j = 0; j < connections_per_room; ++j)
+            result.masks[i] |= room_bit(room_connections[i][j]);
+    return result;
+}
+
+// The rooms adjacent to each room, indexed like room_connections.
+constexpr Adjacency_masks adjacency_masks = make_adjacency_masks();
+
+struct Percepts
 {
-    int number;
     bool wumpus{false};
     bool bat{false};
     bool pit{false};
-    std::array<Room*, connections_per_room> adjacent_rooms;
+};
+
+// The positions of the player and of the hazards as room masks. This holds
+// everything needed for percepts and hazard checks in a few bytes.
+struct Hazard_masks
+{
+    Room_mask player{0};
+    Room_mask wumpus{0};
+    Room_mask bats{0};
+    Room_mask pits{0};
 
-    Room() : number{}
+    Room_mask adjacent_to_player() const
     {
+        return adjacency_masks[room_index(player)];
     }
 
-    explicit Room(int number) : number{number}
+    Percepts percepts() const
     {
+        Room_mask adjacent = adjacent_to_player();
+        Percepts result;
+        result.wumpus = (adjacent & wumpus) != 0;
+        result.bat = (adjacent & bats) != 0;
+        result.pit = (adjacent & pits) != 0;
+        return result;
     }
 };
 
-enum class Game_state
+// Draws the starting rooms of the player, the wumpus, the bats and the pits,
+// all distinct.
+Hazard_masks random_hazard_masks(Rng& rng);
+
+enum class Game_state : std::uint8_t
 {
     none,
     player_eaten,
@@ -47,23 +119,61 @@ enum class Game_state
     player_quit
 };
 
-class Game
+const int num_game_states = static_cast<int>(Game_state::player_quit) + 1;
+
+// Returns the name of the given state, such as "player_eaten".
+const char* game_state_name(Game_state state);
+
+// The complete state of a hunt as a plain value. Rooms are referred to by
+// index into room_connections; the numbers shown to the player are a shuffled
+// labelling of those indices. Copying a Hunt_state is enough to snapshot,
+// restore or branch a hunt.
+struct Hunt_state
 {
-public:
-    static const std::string wumpus_adjacent_message;
-    static const std::string bat_adjacent_message;
-    static const std::string pit_adjacent_message;
-    static const std::string wumpus_dead_message;
-    static const std::string player_eaten_message;
-    static const std::string player_dropped_in_random_room_message;
-    static const std::string player_fell_message;
-    static const std::string player_shot_message;
-    static const std::string player_quit_message;
-    static const std::string wumpus_moves_message;
+    // The number of the room at each index.
+    std::array<std::int8_t, num_rooms> numbers;
+    // The index of each room, looked up by number. Entry 0 is unused.
+    std::array<std::int8_t, num_rooms + 1> indices;
+    Hazard_masks hazards;
+    Game_state state;
+    std::int8_t arrows;
+
+    int player_room() const
+    {
+        return room_index(hazards.player);
+    }
 
+    int wumpus_room() const
+    {
+        return room_index(hazards.wumpus);
+    }
+
+    // Returns the index of the room with the given number, or -1 if there is
+    // no such room.
+    int index_of(int number) const
+    {
+        return number >= 1 && number <= num_rooms ? indices[number] : -1;
+    }
+};
+
+static_assert(
+    std::is_trivially_copyable<Hunt_state>::value,
+    "A hunt must be copyable as plain bytes");
+
+// A game reporting its events to a Sink, which must have an
+// on_event(Event) member. It is instantiated for Event_sink, which dispatches
+// at run time, and for Null_event_sink, which discards everything at no cost.
+template <typename Sink>
+class Basic_game
+{
+public:
     static std::string game_info();
 
-    Game(std::ostream& out);
+    explicit Basic_game(Sink& sink, std::uint64_t seed = random_seed());
+
+    // Restarts the random sequence so that the following hunts can be
+    // reproduced from the given seed.
+    void seed(std::uint64_t seed);
 
     // Game Actions API.
     void init_hunt();
@@ -78,32 +188,35 @@ public:
     void shoot(const std::array<int, arrow_range>& targets);
     void quit();
 
-    // Game State API.
-    const std::array<Room, num_rooms>& get_rooms() const;
-    const Room* get_player_room() const;
+    // Game State API. Rooms are given by index unless stated otherwise.
+    const Hunt_state& get_state() const;
+    void set_state(const Hunt_state& state);
+    int get_room_number(int room) const;
+    int get_player_room() const;
     Game_state get_game_state() const;
     int get_arrows() const;
+    const Hazard_masks& get_hazard_masks() const;
+    Percepts get_percepts() const;
 
 private:
-    std::ostream& out;
-
-    std::array<Room, num_rooms> rooms;
-    Room* player_room{nullptr};
-    Room* wumpus_room{nullptr};
-
-    Game_state state{Game_state::none};
+    Sink& sink;
+    Rng rng;
 
-    int arrows{num_arrows};
+    Hunt_state hunt;
 
-    void reset_rooms();
     void shuffle_room_numbers();
-    void sort_adjacent_rooms();
     void place_player_and_hazards();
 
     bool target_is_adjacent(int target) const;
     void check_room_hazards();
-    Room* get_next_room_for_arrow_flight(
-        const Room* previous_room, const Room* current_room, int target) const;
+    int get_next_room_for_arrow_flight(
+        int previous_room, int current_room, int target);
     void move_wumpus();
 };
+
+extern template class Basic_game<Event_sink>;
+extern template class Basic_game<Null_event_sink>;
+
+using Game = Basic_game<Event_sink>;
+using Silent_game = Basic_game<Null_event_sink>;
 }
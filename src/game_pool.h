@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace wumpus {
+
+// A fixed number of games, each with its own sink, all constructed up front so
+// that handing out a game and starting its hunt never allocates. Game_type is
+// constructed from a Sink& and a seed, like Basic_game<Sink> or
+// Static_cave_game<Topology, Rules, Sink>. Games are referred to by slot.
+template <typename Game_type, typename Sink>
+class Game_pool
+{
+public:
+    explicit Game_pool(int capacity)
+        : slot_count{check_capacity(capacity)}, slots{new Slot[capacity]}
+    {
+        free_slots.reserve(capacity);
+        for (int slot = capacity - 1; slot >= 0; --slot)
+            free_slots.push_back(slot);
+    }
+
+    int capacity() const
+    {
+        return slot_count;
+    }
+
+    int num_free() const
+    {
+        return static_cast<int>(free_slots.size());
+    }
+
+    // Takes a free game, seeds it and starts a hunt. Returns its slot, or -1
+    // if every game is in use.
+    int acquire(std::uint64_t seed)
+    {
+        if (free_slots.empty())
+            return -1;
+        const int slot = free_slots.back();
+        free_slots.pop_back();
+        slots[slot].in_use = true;
+        slots[slot].game.seed(seed);
+        slots[slot].game.init_hunt();
+        return slot;
+    }
+
+    // Returns the game in the slot to the pool. Throws std::logic_error if it
+    // is not in use.
+    void release(int slot)
+    {
+        if (!in_use(slot))
+            throw std::logic_error("Released a game that is not in use");
+        slots[slot].in_use = false;
+        free_slots.push_back(slot);
+    }
+
+    bool in_use(int slot) const
+    {
+        return slot >= 0 && slot < slot_count && slots[slot].in_use;
+    }
+
+    Game_type& game(int slot)
+    {
+        return slots[slot].game;
+    }
+
+    Sink& sink(int slot)
+    {
+        return slots[slot].sink;
+    }
+
+private:
+    static int check_capacity(int capacity)
+    {
+        if (capacity < 1)
+            throw std::invalid_argument("A pool needs at least one game");
+        return capacity;
+    }
+
+    struct Slot
+    {
+        Sink sink;
+        Game_type game{sink, 0};
+        bool in_use{false};
+    };
+
+    const int slot_count;
+    std::unique_ptr<Slot[]> slots;
+    // Filled in reverse, so that slots are handed out lowest first.
+    std::vector<int> free_slots;
+};
+}
@@ -0,0 +1,828 @@
+#include "hunt_lanes.h"
+
+#include <array>
+#include <stdexcept>
+
+#include "cave.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+#define WUMPUS_AVX2_KERNEL 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define WUMPUS_AVX2_KERNEL 0
+#endif
+
+// GCC and Clang compile only the functions marked with this for AVX2, so the
+// rest of the program runs on any processor. MSVC needs no marking.
+#if defined(__GNUC__)
+#define WUMPUS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define WUMPUS_TARGET_AVX2
+#endif
+
+namespace wumpus {
+
+namespace {
+
+const int num_sampled_rooms = 2 + num_bats + num_pits;
+
+// The threshold below which Rng::uniform() rejects a draw for a range.
+constexpr std::uint32_t rejection_threshold(std::uint32_t range)
+{
+    return (0u - range) % range;
+}
+
+// The generator of one lane as an Rng, written back when done.
+class Scalar_rng
+{
+public:
+    Scalar_rng(Lane_rngs& rngs, int lane) : rngs(rngs), lane{lane}, rng{0}
+    {
+        rng.set_state(
+            {{rngs.state[0][lane],
+              rngs.state[1][lane],
+              rngs.state[2][lane],
+              rngs.state[3][lane]}});
+    }
+
+    ~Scalar_rng()
+    {
+        for (int i = 0; i < 4; ++i)
+            rngs.state[i][lane] = rng.get_state()[i];
+    }
+
+    Rng& get()
+    {
+        return rng;
+    }
+
+private:
+    Lane_rngs& rngs;
+    const int lane;
+    Rng rng;
+};
+
+// The scalar kernel steps one lane at a time through its own Rng, mirroring
+// Static_cave_game line by line.
+class Scalar_lane
+{
+public:
+    Scalar_lane(Hunt_lanes& lanes, int lane)
+        : lanes(lanes), lane{lane}, scalar_rng{lanes.rngs, lane},
+          rng(scalar_rng.get())
+    {
+    }
+
+    void init_hunt()
+    {
+        std::array<std::int32_t, num_sampled_rooms> rooms;
+        sample_rooms(rng, num_rooms, num_sampled_rooms, rooms.data());
+        lanes.state[lane] = static_cast<std::int32_t>(Game_state::none);
+        lanes.arrows[lane] = num_arrows;
+        lanes.player_room[lane] = rooms[0];
+        lanes.wumpus_room[lane] = rooms[1];
+        lanes.bats[lane] = 0;
+        for (int i = 2; i < 2 + num_bats; ++i)
+            lanes.bats[lane] |= room_bit(rooms[i]);
+        lanes.pits[lane] = 0;
+        for (int i = 2 + num_bats; i < num_sampled_rooms; ++i)
+            lanes.pits[lane] |= room_bit(rooms[i]);
+    }
+
+    void step(const Lane_actions& actions)
+    {
+        const int target = actions.path[0][lane];
+        switch (actions.type[lane])
+        {
+        case Lane_action::move:
+            if (!is_adjacent(lanes.player_room[lane], target))
+                break;
+            lanes.player_room[lane] = target;
+            check_room_hazards();
+            break;
+        case Lane_action::shoot:
+            if (lanes.arrows[lane] > 0 &&
+                is_adjacent(lanes.player_room[lane], target))
+            {
+                shoot(actions);
+            }
+            break;
+        case Lane_action::quit:
+            set_state(Game_state::player_quit);
+            break;
+        default:
+            break;
+        }
+    }
+
+private:
+    Hunt_lanes& lanes;
+    const int lane;
+    Scalar_rng scalar_rng;
+    Rng& rng;
+
+    static bool is_adjacent(int room, int other_room)
+    {
+        return other_room >= 0 && other_room < num_rooms &&
+            (adjacency_masks[room] & room_bit(other_room));
+    }
+
+    void set_state(Game_state state)
+    {
+        lanes.state[lane] = static_cast<std::int32_t>(state);
+    }
+
+    void check_room_hazards()
+    {
+        std::int32_t& player_room = lanes.player_room[lane];
+        while (true)
+        {
+            if (player_room == lanes.wumpus_room[lane])
+            {
+                set_state(Game_state::player_eaten);
+                return;
+            }
+            if (lanes.pits[lane] & room_bit(player_room))
+            {
+                set_state(Game_state::player_fell);
+                return;
+            }
+            if (lanes.bats[lane] & room_bit(player_room))
+            {
+                player_room = rng.uniform(0, num_rooms);
+                continue;
+            }
+            break;
+        }
+    }
+
+    void shoot(const Lane_actions& actions)
+    {
+        --lanes.arrows[lane];
+        int room = lanes.player_room[lane];
+        int previous_room = -1;
+        for (int i = 0; i < arrow_range; ++i)
+        {
+            const int target = actions.path[i][lane];
+            int next_room;
+            if (target != previous_room && is_adjacent(room, target))
+            {
+                next_room = target;
+            }
+            else
+            {
+                const bool can_turn_back = previous_room < 0;
+                const auto& rooms = room_connections[room];
+                next_room = rooms[rng.uniform(
+                    0, connections_per_room - (can_turn_back ? 0 : 1))];
+                if (next_room == previous_room && !can_turn_back)
+                    next_room = rooms[connections_per_room - 1];
+            }
+            previous_room = room;
+            room = next_room;
+            if (room == lanes.wumpus_room[lane])
+            {
+                set_state(Game_state::wumpus_dead);
+                return;
+            }
+            if (room == lanes.player_room[lane])
+            {
+                set_state(Game_state::player_shot);
+                return;
+            }
+        }
+
+        std::int32_t& wumpus_room = lanes.wumpus_room[lane];
+        wumpus_room = room_connections[wumpus_room]
+                                      [rng.uniform(0, connections_per_room)];
+        if (lanes.player_room[lane] == wumpus_room)
+            set_state(Game_state::player_eaten);
+    }
+};
+
+#if WUMPUS_AVX2_KERNEL
+
+// The generators of all lanes, one state word per register.
+struct Avx2_rng
+{
+    __m256i s[4];
+};
+
+WUMPUS_TARGET_AVX2 inline __m256i load(const std::int32_t* values)
+{
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(values));
+}
+
+WUMPUS_TARGET_AVX2 inline __m256i load(const std::uint32_t* values)
+{
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(values));
+}
+
+WUMPUS_TARGET_AVX2 inline void store(std::int32_t* values, __m256i vector)
+{
+    _mm256_store_si256(reinterpret_cast<__m256i*>(values), vector);
+}
+
+WUMPUS_TARGET_AVX2 inline void store(std::uint32_t* values, __m256i vector)
+{
+    _mm256_store_si256(reinterpret_cast<__m256i*>(values), vector);
+}
+
+WUMPUS_TARGET_AVX2 inline __m256i rotl(__m256i x, int k)
+{
+    return _mm256_or_si256(
+        _mm256_slli_epi32(x, k), _mm256_srli_epi32(x, 32 - k));
+}
+
+// Selects b in the lanes set in the mask and a elsewhere.
+WUMPUS_TARGET_AVX2 inline __m256i select(__m256i mask, __m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(a, b, mask);
+}
+
+WUMPUS_TARGET_AVX2 inline __m256i and_not(__m256i a, __m256i b)
+{
+    return _mm256_andnot_si256(b, a);
+}
+
+WUMPUS_TARGET_AVX2 inline bool any(__m256i mask)
+{
+    return !_mm256_testz_si256(mask, mask);
+}
+
+WUMPUS_TARGET_AVX2 inline __m256i is_nonzero(__m256i x)
+{
+    return _mm256_xor_si256(
+        _mm256_cmpeq_epi32(x, _mm256_setzero_si256()),
+        _mm256_set1_epi32(-1));
+}
+
+WUMPUS_TARGET_AVX2 inline __m256i room_bits(__m256i rooms)
+{
+    // Shifts of 32 or more, which is what -1 becomes, give no room.
+    return _mm256_sllv_epi32(_mm256_set1_epi32(1), rooms);
+}
+
+// A table with an entry for each room, padded to a whole number of
+// registers.
+struct Lane_table
+{
+    alignas(32) std::int32_t values[24];
+};
+
+static_assert(num_rooms <= 24, "Every room must fit in a lane table");
+
+constexpr Lane_table make_adjacency_table()
+{
+    Lane_table table{};
+    for (int room = 0; room < num_rooms; ++room)
+        table.values[room] = static_cast<std::int32_t>(adjacency_masks[room]);
+    return table;
+}
+
+constexpr Lane_table make_connection_table(int i)
+{
+    Lane_table table{};
+    for (int room = 0; room < num_rooms; ++room)
+        table.values[room] = room_connections[room][i];
+    return table;
+}
+
+const Lane_table adjacency_table = make_adjacency_table();
+const Lane_table connection_tables[connections_per_room] = {
+    make_connection_table(0),
+    make_connection_table(1),
+    make_connection_table(2)};
+
+// Looks up the entry of each room. The table is held in three registers and
+// read with permutes, which are much cheaper than gathers.
+WUMPUS_TARGET_AVX2 inline __m256i lookup(
+    const Lane_table& table, __m256i rooms)
+{
+    const __m256i* values = reinterpret_cast<const __m256i*>(table.values);
+    const __m256i low =
+        _mm256_permutevar8x32_epi32(_mm256_load_si256(values), rooms);
+    const __m256i middle =
+        _mm256_permutevar8x32_epi32(_mm256_load_si256(values + 1), rooms);
+    const __m256i high =
+        _mm256_permutevar8x32_epi32(_mm256_load_si256(values + 2), rooms);
+    const __m256i result =
+        select(_mm256_cmpgt_epi32(rooms, _mm256_set1_epi32(7)), low, middle);
+    return select(
+        _mm256_cmpgt_epi32(rooms, _mm256_set1_epi32(15)), result, high);
+}
+
+WUMPUS_TARGET_AVX2 inline __m256i adjacency_of(__m256i rooms)
+{
+    return lookup(adjacency_table, rooms);
+}
+
+// Returns tunnel i of each room, as in room_connections.
+WUMPUS_TARGET_AVX2 inline __m256i connection(__m256i rooms, __m256i i)
+{
+    static_assert(connections_per_room == 3, "Rooms have three tunnels");
+    const __m256i first = lookup(connection_tables[0], rooms);
+    const __m256i second = lookup(connection_tables[1], rooms);
+    const __m256i third = lookup(connection_tables[2], rooms);
+    const __m256i result =
+        select(_mm256_cmpeq_epi32(i, _mm256_set1_epi32(1)), first, second);
+    return select(_mm256_cmpeq_epi32(i, _mm256_set1_epi32(2)), result, third);
+}
+
+WUMPUS_TARGET_AVX2 Avx2_rng load_rng(const Lane_rngs& rngs)
+{
+    Avx2_rng rng;
+    for (int i = 0; i < 4; ++i)
+        rng.s[i] = load(rngs.state[i]);
+    return rng;
+}
+
+WUMPUS_TARGET_AVX2 void store_rng(Lane_rngs& rngs, const Avx2_rng& rng)
+{
+    for (int i = 0; i < 4; ++i)
+        store(rngs.state[i], rng.s[i]);
+}
+
+// Advances the generators of the lanes in the mask, like Rng::operator()(),
+// and returns their outputs.
+WUMPUS_TARGET_AVX2 inline __m256i next(Avx2_rng& rng, __m256i mask)
+{
+    __m256i s0 = rng.s[0];
+    __m256i s1 = rng.s[1];
+    __m256i s2 = rng.s[2];
+    __m256i s3 = rng.s[3];
+    const __m256i result = _mm256_mullo_epi32(
+        rotl(_mm256_mullo_epi32(s1, _mm256_set1_epi32(5)), 7),
+        _mm256_set1_epi32(9));
+    const __m256i t = _mm256_slli_epi32(s1, 9);
+    s2 = _mm256_xor_si256(s2, s0);
+    s3 = _mm256_xor_si256(s3, s1);
+    s1 = _mm256_xor_si256(s1, s2);
+    s0 = _mm256_xor_si256(s0, s3);
+    s2 = _mm256_xor_si256(s2, t);
+    s3 = rotl(s3, 11);
+    rng.s[0] = select(mask, rng.s[0], s0);
+    rng.s[1] = select(mask, rng.s[1], s1);
+    rng.s[2] = select(mask, rng.s[2], s2);
+    rng.s[3] = select(mask, rng.s[3], s3);
+    return result;
+}
+
+// Multiplies a draw by the range of each lane. Returns the high half of the
+// product, the result of the draw, and sets the lanes of the mask whose low
+// half makes Rng::uniform() reject the draw.
+WUMPUS_TARGET_AVX2 inline __m256i scale_draw(
+    __m256i x, __m256i range, __m256i threshold, __m256i& rejected)
+{
+    // The 64-bit products of the even and the odd lanes.
+    const __m256i even = _mm256_mul_epu32(x, range);
+    const __m256i odd = _mm256_mul_epu32(
+        _mm256_srli_epi64(x, 32), _mm256_srli_epi64(range, 32));
+    const __m256i low =
+        _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xaa);
+    const __m256i accepted =
+        _mm256_cmpeq_epi32(_mm256_max_epu32(low, threshold), low);
+    rejected = and_not(rejected, accepted);
+    return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+}
+
+// Redraws the rejected lanes until every draw is accepted.
+WUMPUS_TARGET_AVX2 __m256i redraw(
+    Avx2_rng& rng,
+    __m256i rejected,
+    __m256i range,
+    __m256i threshold,
+    __m256i result)
+{
+    while (any(rejected))
+    {
+        const __m256i mask = rejected;
+        const __m256i x = next(rng, mask);
+        result =
+            select(mask, result, scale_draw(x, range, threshold, rejected));
+    }
+    return result;
+}
+
+// Draws from [0, range) in the lanes in the mask like Rng::uniform(), with
+// the rejection threshold of each lane's range given. Other lanes get some
+// value in the range.
+WUMPUS_TARGET_AVX2 inline __m256i uniform(
+    Avx2_rng& rng, __m256i mask, __m256i range, __m256i threshold)
+{
+    __m256i rejected = mask;
+    const __m256i result =
+        scale_draw(next(rng, mask), range, threshold, rejected);
+    // Rejection is very rare, so it is kept out of line.
+    if (any(rejected))
+        return redraw(rng, rejected, range, threshold, result);
+    return result;
+}
+
+WUMPUS_TARGET_AVX2 inline __m256i uniform(
+    Avx2_rng& rng, __m256i mask, int range)
+{
+    return uniform(
+        rng,
+        mask,
+        _mm256_set1_epi32(range),
+        _mm256_set1_epi32(static_cast<int>(rejection_threshold(range))));
+}
+
+WUMPUS_TARGET_AVX2 __m256i lanes_in(std::uint32_t bits)
+{
+    const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return is_nonzero(
+        _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), lane_bits));
+}
+
+WUMPUS_TARGET_AVX2 void avx2_init_hunts(Hunt_lanes& lanes, std::uint32_t bits)
+{
+    const __m256i mask = lanes_in(bits);
+    Avx2_rng rng = load_rng(lanes.rngs);
+
+    // sample_rooms(): Floyd's algorithm, then a shuffle of the rooms picked.
+    __m256i rooms[num_sampled_rooms];
+    for (int j = num_rooms - num_sampled_rooms; j < num_rooms; ++j)
+    {
+        const int size = j - (num_rooms - num_sampled_rooms);
+        __m256i room = uniform(rng, mask, j + 1);
+        __m256i is_taken = _mm256_setzero_si256();
+        for (int k = 0; k < size; ++k)
+            is_taken =
+                _mm256_or_si256(is_taken, _mm256_cmpeq_epi32(rooms[k], room));
+        rooms[size] = select(is_taken, room, _mm256_set1_epi32(j));
+    }
+    for (int i = num_sampled_rooms - 1; i > 0; --i)
+    {
+        const __m256i k = uniform(rng, mask, i + 1);
+        const __m256i room = rooms[i];
+        for (int j = 0; j < i; ++j)
+        {
+            const __m256i is_k = _mm256_cmpeq_epi32(k, _mm256_set1_epi32(j));
+            rooms[i] = select(is_k, rooms[i], rooms[j]);
+            rooms[j] = select(is_k, rooms[j], room);
+        }
+    }
+
+    __m256i bats = _mm256_setzero_si256();
+    for (int i = 2; i < 2 + num_bats; ++i)
+        bats = _mm256_or_si256(bats, room_bits(rooms[i]));
+    __m256i pits = _mm256_setzero_si256();
+    for (int i = 2 + num_bats; i < num_sampled_rooms; ++i)
+        pits = _mm256_or_si256(pits, room_bits(rooms[i]));
+
+    store(
+        lanes.state,
+        select(
+            mask,
+            load(lanes.state),
+            _mm256_set1_epi32(static_cast<int>(Game_state::none))));
+    store(
+        lanes.arrows,
+        select(mask, load(lanes.arrows), _mm256_set1_epi32(num_arrows)));
+    store(lanes.player_room, select(mask, load(lanes.player_room), rooms[0]));
+    store(lanes.wumpus_room, select(mask, load(lanes.wumpus_room), rooms[1]));
+    store(lanes.bats, select(mask, load(lanes.bats), bats));
+    store(lanes.pits, select(mask, load(lanes.pits), pits));
+    store_rng(lanes.rngs, rng);
+}
+
+WUMPUS_TARGET_AVX2 void avx2_get_percepts(
+    const Hunt_lanes& lanes, std::int32_t* percepts)
+{
+    const __m256i adjacent = adjacency_of(load(lanes.player_room));
+    const __m256i wumpus = _mm256_and_si256(
+        is_nonzero(
+            _mm256_and_si256(adjacent, room_bits(load(lanes.wumpus_room)))),
+        _mm256_set1_epi32(wumpus_percept));
+    const __m256i bat = _mm256_and_si256(
+        is_nonzero(_mm256_and_si256(adjacent, load(lanes.bats))),
+        _mm256_set1_epi32(bat_percept));
+    const __m256i pit = _mm256_and_si256(
+        is_nonzero(_mm256_and_si256(adjacent, load(lanes.pits))),
+        _mm256_set1_epi32(pit_percept));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(percepts),
+        _mm256_or_si256(wumpus, _mm256_or_si256(bat, pit)));
+}
+
+// The hunts of all lanes in registers, with the state of each lane set in the
+// masks of the lanes that end.
+struct Avx2_hunts
+{
+    __m256i player_room;
+    __m256i wumpus_room;
+    __m256i bats;
+    __m256i pits;
+    __m256i state;
+    __m256i arrows;
+    Avx2_rng rng;
+};
+
+WUMPUS_TARGET_AVX2 inline void end_hunts(
+    Avx2_hunts& hunts, __m256i mask, Game_state state)
+{
+    hunts.state = select(
+        mask, hunts.state, _mm256_set1_epi32(static_cast<int>(state)));
+}
+
+// Checks the rooms of the players in the mask, carrying them off as often as
+// they meet bats.
+WUMPUS_TARGET_AVX2 void check_room_hazards(Avx2_hunts& hunts, __m256i mask)
+{
+    while (any(mask))
+    {
+        const __m256i here = room_bits(hunts.player_room);
+        const __m256i eaten =
+            _mm256_and_si256(
+                mask, _mm256_cmpeq_epi32(hunts.player_room, hunts.wumpus_room));
+        end_hunts(hunts, eaten, Game_state::player_eaten);
+        mask = and_not(mask, eaten);
+        const __m256i fell = _mm256_and_si256(
+            mask, is_nonzero(_mm256_and_si256(hunts.pits, here)));
+        end_hunts(hunts, fell, Game_state::player_fell);
+        mask = and_not(mask, fell);
+        mask = _mm256_and_si256(
+            mask, is_nonzero(_mm256_and_si256(hunts.bats, here)));
+        hunts.player_room = select(
+            mask, hunts.player_room, uniform(hunts.rng, mask, num_rooms));
+    }
+}
+
+WUMPUS_TARGET_AVX2 void shoot(
+    Avx2_hunts& hunts, __m256i mask, const Lane_actions& actions)
+{
+    const __m256i one = _mm256_set1_epi32(1);
+    hunts.arrows = _mm256_sub_epi32(hunts.arrows, _mm256_and_si256(mask, one));
+
+    // The ranges of the draws when the arrow may turn back, at the start of
+    // its flight, and when it may not.
+    const __m256i all_range = _mm256_set1_epi32(connections_per_room);
+    const __m256i all_threshold = _mm256_set1_epi32(
+        static_cast<int>(rejection_threshold(connections_per_room)));
+    const __m256i forward_range = _mm256_set1_epi32(connections_per_room - 1);
+    const __m256i forward_threshold = _mm256_set1_epi32(
+        static_cast<int>(rejection_threshold(connections_per_room - 1)));
+    const __m256i last = _mm256_set1_epi32(connections_per_room - 1);
+
+    __m256i room = hunts.player_room;
+    __m256i previous_room = _mm256_set1_epi32(-1);
+    for (int i = 0; i < arrow_range; ++i)
+    {
+        const __m256i target = load(actions.path[i]);
+        const __m256i is_aimed = _mm256_and_si256(
+            mask,
+            and_not(
+                is_nonzero(
+                    _mm256_and_si256(adjacency_of(room), room_bits(target))),
+                _mm256_cmpeq_epi32(target, previous_room)));
+        const __m256i can_turn_back =
+            _mm256_cmpgt_epi32(_mm256_setzero_si256(), previous_room);
+        const __m256i index = uniform(
+            hunts.rng,
+            and_not(mask, is_aimed),
+            select(can_turn_back, forward_range, all_range),
+            select(can_turn_back, forward_threshold, all_threshold));
+        __m256i next_room = connection(room, index);
+        next_room = select(
+            and_not(
+                _mm256_cmpeq_epi32(next_room, previous_room), can_turn_back),
+            next_room,
+            connection(room, last));
+        next_room = select(is_aimed, next_room, target);
+
+        previous_room = select(mask, previous_room, room);
+        room = select(mask, room, next_room);
+        const __m256i killed =
+            _mm256_and_si256(mask, _mm256_cmpeq_epi32(room, hunts.wumpus_room));
+        end_hunts(hunts, killed, Game_state::wumpus_dead);
+        mask = and_not(mask, killed);
+        const __m256i shot =
+            _mm256_and_si256(mask, _mm256_cmpeq_epi32(room, hunts.player_room));
+        end_hunts(hunts, shot, Game_state::player_shot);
+        mask = and_not(mask, shot);
+    }
+
+    // The arrow missed, and the wumpus woke up and moved.
+    const __m256i index = uniform(hunts.rng, mask, connections_per_room);
+    hunts.wumpus_room =
+        select(mask, hunts.wumpus_room, connection(hunts.wumpus_room, index));
+    end_hunts(
+        hunts,
+        _mm256_and_si256(
+            mask, _mm256_cmpeq_epi32(hunts.player_room, hunts.wumpus_room)),
+        Game_state::player_eaten);
+}
+
+WUMPUS_TARGET_AVX2 inline __m256i lanes_with_action(
+    const Lane_actions& actions, Lane_action action)
+{
+    return _mm256_cmpeq_epi32(
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(actions.type)),
+        _mm256_set1_epi32(static_cast<int>(action)));
+}
+
+WUMPUS_TARGET_AVX2 void avx2_step(
+    Hunt_lanes& lanes, const Lane_actions& actions)
+{
+    Avx2_hunts hunts;
+    hunts.player_room = load(lanes.player_room);
+    hunts.wumpus_room = load(lanes.wumpus_room);
+    hunts.bats = load(lanes.bats);
+    hunts.pits = load(lanes.pits);
+    hunts.state = load(lanes.state);
+    hunts.arrows = load(lanes.arrows);
+    hunts.rng = load_rng(lanes.rngs);
+
+    const __m256i active = _mm256_cmpeq_epi32(
+        hunts.state, _mm256_set1_epi32(static_cast<int>(Game_state::none)));
+    const __m256i target = load(actions.path[0]);
+    const __m256i is_allowed = is_nonzero(
+        _mm256_and_si256(adjacency_of(hunts.player_room), room_bits(target)));
+
+    end_hunts(
+        hunts,
+        _mm256_and_si256(active, lanes_with_action(actions, Lane_action::quit)),
+        Game_state::player_quit);
+
+    const __m256i moves = _mm256_and_si256(
+        _mm256_and_si256(
+            active, lanes_with_action(actions, Lane_action::move)),
+        is_allowed);
+    hunts.player_room = select(moves, hunts.player_room, target);
+    check_room_hazards(hunts, moves);
+
+    const __m256i shots = _mm256_and_si256(
+        _mm256_and_si256(
+            active, lanes_with_action(actions, Lane_action::shoot)),
+        _mm256_and_si256(
+            is_allowed,
+            _mm256_cmpgt_epi32(hunts.arrows, _mm256_setzero_si256())));
+    if (any(shots))
+        shoot(hunts, shots, actions);
+
+    store(lanes.player_room, hunts.player_room);
+    store(lanes.wumpus_room, hunts.wumpus_room);
+    store(lanes.state, hunts.state);
+    store(lanes.arrows, hunts.arrows);
+    store_rng(lanes.rngs, hunts.rng);
+}
+
+WUMPUS_TARGET_AVX2 void avx2_random_adjacent_rooms(
+    Lane_rngs& rngs,
+    std::uint32_t bits,
+    const std::int32_t* rooms,
+    std::int32_t* adjacent_rooms)
+{
+    Avx2_rng rng = load_rng(rngs);
+    const __m256i mask = lanes_in(bits);
+    const __m256i index = uniform(rng, mask, connections_per_room);
+    const __m256i adjacent = connection(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rooms)), index);
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(adjacent_rooms),
+        select(
+            mask,
+            _mm256_loadu_si256(reinterpret_cast<__m256i*>(adjacent_rooms)),
+            adjacent));
+    store_rng(rngs, rng);
+}
+
+bool has_avx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool has_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+    if (!has_avx || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+}
+
+Lane_kernel best_lane_kernel()
+{
+#if WUMPUS_AVX2_KERNEL
+    static const bool avx2 = has_avx2();
+    if (avx2)
+        return Lane_kernel::avx2;
+#endif
+    return Lane_kernel::scalar;
+}
+
+const char* lane_kernel_name(Lane_kernel kernel)
+{
+    switch (kernel)
+    {
+    case Lane_kernel::scalar:
+        return "scalar";
+    case Lane_kernel::avx2:
+        return "avx2";
+    default:
+        throw std::logic_error("Invalid lane kernel");
+    }
+}
+
+void seed_lane(Lane_rngs& rngs, int lane, std::uint64_t seed)
+{
+    const Rng rng{seed};
+    for (int i = 0; i < 4; ++i)
+        rngs.state[i][lane] = rng.get_state()[i];
+}
+
+void init_hunts(Lane_kernel kernel, Hunt_lanes& lanes, std::uint32_t mask)
+{
+#if WUMPUS_AVX2_KERNEL
+    if (kernel == Lane_kernel::avx2)
+    {
+        avx2_init_hunts(lanes, mask);
+        return;
+    }
+#endif
+    if (kernel != Lane_kernel::scalar)
+        throw std::logic_error("Lane kernel not built");
+    for (int lane = 0; lane < num_lanes; ++lane)
+        if (mask & 1u << lane)
+            Scalar_lane{lanes, lane}.init_hunt();
+}
+
+void get_percepts(
+    Lane_kernel kernel, const Hunt_lanes& lanes, std::int32_t* percepts)
+{
+#if WUMPUS_AVX2_KERNEL
+    if (kernel == Lane_kernel::avx2)
+    {
+        avx2_get_percepts(lanes, percepts);
+        return;
+    }
+#endif
+    if (kernel != Lane_kernel::scalar)
+        throw std::logic_error("Lane kernel not built");
+    for (int lane = 0; lane < num_lanes; ++lane)
+    {
+        const Room_mask adjacent = adjacency_masks[lanes.player_room[lane]];
+        percepts[lane] =
+            (adjacent & room_bit(lanes.wumpus_room[lane]) ? wumpus_percept
+                                                          : 0) |
+            (adjacent & lanes.bats[lane] ? bat_percept : 0) |
+            (adjacent & lanes.pits[lane] ? pit_percept : 0);
+    }
+}
+
+void step(Lane_kernel kernel, Hunt_lanes& lanes, const Lane_actions& actions)
+{
+#if WUMPUS_AVX2_KERNEL
+    if (kernel == Lane_kernel::avx2)
+    {
+        avx2_step(lanes, actions);
+        return;
+    }
+#endif
+    if (kernel != Lane_kernel::scalar)
+        throw std::logic_error("Lane kernel not built");
+    for (int lane = 0; lane < num_lanes; ++lane)
+        if (lanes.state[lane] == static_cast<std::int32_t>(Game_state::none))
+            Scalar_lane{lanes, lane}.step(actions);
+}
+
+void random_adjacent_rooms(
+    Lane_kernel kernel,
+    Lane_rngs& rngs,
+    std::uint32_t mask,
+    const std::int32_t* rooms,
+    std::int32_t* adjacent_rooms)
+{
+#if WUMPUS_AVX2_KERNEL
+    if (kernel == Lane_kernel::avx2)
+    {
+        avx2_random_adjacent_rooms(rngs, mask, rooms, adjacent_rooms);
+        return;
+    }
+#endif
+    if (kernel != Lane_kernel::scalar)
+        throw std::logic_error("Lane kernel not built");
+    for (int lane = 0; lane < num_lanes; ++lane)
+    {
+        if (!(mask & 1u << lane))
+            continue;
+        Scalar_rng rng{rngs, lane};
+        adjacent_rooms[lane] = room_connections[rooms[lane]]
+                                               [rng.get().uniform(
+                                                   0, connections_per_room)];
+    }
+}
+}
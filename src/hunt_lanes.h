@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+
+#include "game.h"
+#include "random.h"
+
+namespace wumpus {
+
+const int num_lanes = 8;
+
+// The generators of eight lanes, each an Rng, stored word by word.
+struct Lane_rngs
+{
+    alignas(32) std::uint32_t state[4][num_lanes];
+};
+
+// Eight independent hunts in the original cave, stored lane by lane so that
+// one vector instruction advances all of them. Rooms are given by index, and
+// each lane owns its generator: a lane plays exactly the hunts that a
+// Static_cave_game<Dodecahedron_topology, Classic_rules, Sink> seeded alike
+// plays for the same actions.
+struct Hunt_lanes
+{
+    alignas(32) std::int32_t player_room[num_lanes];
+    alignas(32) std::int32_t wumpus_room[num_lanes];
+    alignas(32) Room_mask bats[num_lanes];
+    alignas(32) Room_mask pits[num_lanes];
+    // A Game_state; lanes other than Game_state::none are left alone.
+    alignas(32) std::int32_t state[num_lanes];
+    alignas(32) std::int32_t arrows[num_lanes];
+    Lane_rngs rngs;
+};
+
+enum class Lane_action : std::int32_t
+{
+    none,
+    move,
+    shoot,
+    quit
+};
+
+// One action for each lane. A move uses path[0]; paths hold room indices, or
+// -1 for none. Moves and shots that the game would not allow are skipped.
+struct Lane_actions
+{
+    alignas(32) Lane_action type[num_lanes];
+    alignas(32) std::int32_t path[arrow_range][num_lanes];
+};
+
+// The percepts of each lane, as bits.
+const std::int32_t wumpus_percept = 1;
+const std::int32_t bat_percept = 2;
+const std::int32_t pit_percept = 4;
+
+// The implementations of the lane operations. All produce the same results.
+enum class Lane_kernel
+{
+    scalar,
+    avx2
+};
+
+// Returns the fastest kernel this processor supports.
+Lane_kernel best_lane_kernel();
+
+// Returns the name of the given kernel, such as "avx2".
+const char* lane_kernel_name(Lane_kernel kernel);
+
+// Seeds the generator of one lane like Rng::seed().
+void seed_lane(Lane_rngs& rngs, int lane, std::uint64_t seed);
+
+// Starts a new hunt in every lane whose bit is set in the mask.
+void init_hunts(Lane_kernel kernel, Hunt_lanes& lanes, std::uint32_t mask);
+
+// Writes the percepts of every lane.
+void get_percepts(
+    Lane_kernel kernel, const Hunt_lanes& lanes, std::int32_t* percepts);
+
+// Applies one action in every lane whose hunt is not over.
+void step(Lane_kernel kernel, Hunt_lanes& lanes, const Lane_actions& actions);
+
+// For every lane in the mask, draws one of the rooms adjacent to the lane's
+// room, as room_connections[room][rng.uniform(0, connections_per_room)]
+// would, from the lane's generator. This lets policies choose their actions
+// in lanes too.
+void random_adjacent_rooms(
+    Lane_kernel kernel,
+    Lane_rngs& rngs,
+    std::uint32_t mask,
+    const std::int32_t* rooms,
+    std::int32_t* adjacent_rooms);
+}
@@ -0,0 +1,104 @@
+#include "latency.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace wumpus {
+
+namespace {
+
+int highest_bit(std::uint64_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(x);
+#endif
+}
+}
+
+void Latency_histogram::record(std::uint64_t nanoseconds)
+{
+    ++counts[bucket_of(nanoseconds)];
+    ++total;
+    total_nanoseconds += nanoseconds;
+}
+
+void Latency_histogram::merge(const Latency_histogram& other)
+{
+    for (int i = 0; i < num_buckets; ++i)
+        counts[i] += other.counts[i];
+    total += other.total;
+    total_nanoseconds += other.total_nanoseconds;
+}
+
+void Latency_histogram::clear()
+{
+    counts.fill(0);
+    total = 0;
+    total_nanoseconds = 0;
+}
+
+std::uint64_t Latency_histogram::count() const
+{
+    return total;
+}
+
+std::uint64_t Latency_histogram::sum() const
+{
+    return total_nanoseconds;
+}
+
+std::uint64_t Latency_histogram::count_at_most(std::uint64_t nanoseconds) const
+{
+    std::uint64_t result = 0;
+    for (int i = 0; i < num_buckets && upper_end(i) <= nanoseconds; ++i)
+        result += counts[i];
+    return result;
+}
+
+std::uint64_t Latency_histogram::quantile(double q) const
+{
+    if (total == 0)
+        return 0;
+    // The rank of the quantile, counting from 1.
+    std::uint64_t rank = static_cast<std::uint64_t>(q * total);
+    if (rank < 1)
+        rank = 1;
+    if (rank > total)
+        rank = total;
+    std::uint64_t seen = 0;
+    for (int i = 0; i < num_buckets; ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+            return upper_end(i);
+    }
+    return upper_end(num_buckets - 1);
+}
+
+// Durations below four nanoseconds have a bucket each. Above, the bucket is
+// picked by the highest bit and the two bits below it.
+int Latency_histogram::bucket_of(std::uint64_t nanoseconds)
+{
+    if (nanoseconds < sub_buckets)
+        return static_cast<int>(nanoseconds);
+    const int exponent = highest_bit(nanoseconds);
+    const int sub_bucket =
+        static_cast<int>(nanoseconds >> (exponent - 2)) & (sub_buckets - 1);
+    return sub_buckets * (exponent - 1) + sub_bucket;
+}
+
+std::uint64_t Latency_histogram::upper_end(int bucket)
+{
+    if (bucket < sub_buckets)
+        return static_cast<std::uint64_t>(bucket);
+    const int exponent = bucket / sub_buckets + 1;
+    const std::uint64_t sub_bucket = bucket % sub_buckets;
+    const std::uint64_t width = std::uint64_t{1} << (exponent - 2);
+    return (sub_buckets + sub_bucket) * width + width - 1;
+}
+}
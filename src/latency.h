@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace wumpus {
+
+// Counts durations in buckets that grow geometrically, four to each doubling,
+// so that any quantile is known to within a fifth of its value from a
+// nanosecond up to centuries, in a couple of kilobytes. Histograms recorded
+// on separate threads merge by adding their counts.
+class Latency_histogram
+{
+public:
+    void record(std::uint64_t nanoseconds);
+    void merge(const Latency_histogram& other);
+    void clear();
+
+    std::uint64_t count() const;
+    // The sum of every duration recorded, in nanoseconds.
+    std::uint64_t sum() const;
+    // Returns the number of durations in the buckets that end at or below the
+    // given one, which undercounts by at most the bucket holding it.
+    std::uint64_t count_at_most(std::uint64_t nanoseconds) const;
+    // Returns the upper end of the bucket holding the given quantile, such as
+    // 0.99, in nanoseconds, or 0 if nothing was recorded.
+    std::uint64_t quantile(double q) const;
+
+private:
+    static const int sub_buckets = 4;
+    static const int num_buckets = 64 * sub_buckets;
+
+    std::array<std::uint64_t, num_buckets> counts{};
+    std::uint64_t total{0};
+    std::uint64_t total_nanoseconds{0};
+
+    static int bucket_of(std::uint64_t nanoseconds);
+    static std::uint64_t upper_end(int bucket);
+};
+}
@@ -0,0 +1,377 @@
+// Drives a running wumpus_server with many concurrent sessions, each playing
+// hunts as a random walker that shoots when it smells the wumpus, and reports
+// the throughput and the round-trip latency of the requests.
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "latency.h"
+#include "random.h"
+
+using namespace wumpus;
+
+namespace {
+
+struct Options
+{
+    std::string socket_path;
+    int connections{16};
+    int sessions{10000};
+    double seconds{5};
+    std::uint64_t seed{random_seed()};
+};
+
+std::system_error system_failure(const std::string& what)
+{
+    return std::system_error{errno, std::generic_category(), what};
+}
+
+using Clock = std::chrono::steady_clock;
+
+struct Session
+{
+    long long id{-1};
+    Rng rng{0};
+    Clock::time_point sent;
+};
+
+// A request waiting for its reply. Replies come back in order on each
+// connection.
+struct Request
+{
+    int session;
+    bool is_close;
+};
+
+struct Connection
+{
+    int fd{-1};
+    std::string input;
+    std::string output;
+    std::deque<Request> requests;
+    bool is_waiting_to_write{false};
+};
+
+struct Totals
+{
+    long long requests{0};
+    long long hunts{0};
+    long long wins{0};
+    Latency_histogram latency;
+};
+
+class Load
+{
+public:
+    explicit Load(const Options& options)
+        : options{options}, sessions(options.sessions)
+    {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+            throw system_failure("epoll_create1");
+        for (int i = 0; i < options.sessions; ++i)
+            sessions[i].rng.seed(options.seed + 2 * i + 1);
+        connections.resize(options.connections);
+        for (int i = 0; i < options.connections; ++i)
+            connect_to(i);
+    }
+
+    ~Load()
+    {
+        for (Connection& connection : connections)
+            if (connection.fd >= 0)
+                close(connection.fd);
+        close(epoll_fd);
+    }
+
+    const Totals& run()
+    {
+        // Session i talks on connection i modulo the number of connections.
+        for (int i = 0; i < options.sessions; ++i)
+            start_hunt(i);
+        flush_all();
+
+        const Clock::time_point end = Clock::now() +
+            std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(options.seconds));
+        std::vector<epoll_event> events(256);
+        while (Clock::now() < end)
+        {
+            const int count = epoll_wait(
+                epoll_fd, events.data(), static_cast<int>(events.size()), 100);
+            if (count < 0 && errno != EINTR)
+                throw system_failure("epoll_wait");
+            for (int i = 0; i < count; ++i)
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    read_from(static_cast<int>(events[i].data.u32));
+            flush_all();
+        }
+        return totals;
+    }
+
+private:
+    const Options& options;
+    int epoll_fd{-1};
+    std::vector<Session> sessions;
+    std::vector<Connection> connections;
+    Totals totals;
+
+    void connect_to(int index)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options.socket_path.size() >= sizeof address.sun_path)
+            throw std::invalid_argument(
+                "Socket path too long: " + options.socket_path);
+        std::strcpy(address.sun_path, options.socket_path.c_str());
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            throw system_failure("socket");
+        connections[index].fd = fd;
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) <
+            0)
+            throw system_failure("Cannot connect to " + options.socket_path);
+        // Requests are written without blocking, so that replies keep being
+        // read while the server holds back.
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<std::uint32_t>(index);
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+            throw system_failure("epoll_ctl");
+    }
+
+    Connection& connection_of(int session)
+    {
+        return connections[session % options.connections];
+    }
+
+    void start_hunt(int session)
+    {
+        Connection& connection = connection_of(session);
+        connection.output += "new\n";
+        connection.requests.push_back({session, false});
+        sessions[session].sent = Clock::now();
+    }
+
+    void send(int session, char action, int target)
+    {
+        Connection& connection = connection_of(session);
+        connection.output += std::to_string(sessions[session].id);
+        connection.output += ' ';
+        connection.output += action;
+        connection.output += ' ';
+        connection.output += std::to_string(target);
+        connection.output += '\n';
+        connection.requests.push_back({session, false});
+        sessions[session].sent = Clock::now();
+    }
+
+    void end_hunt(int session)
+    {
+        Connection& connection = connection_of(session);
+        connection.output += std::to_string(sessions[session].id) + " close\n";
+        connection.requests.push_back({session, true});
+        start_hunt(session);
+    }
+
+    void read_from(int index)
+    {
+        Connection& connection = connections[index];
+        char buffer[65536];
+        const ssize_t size = read(connection.fd, buffer, sizeof buffer);
+        if (size < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        if (size <= 0)
+            throw std::runtime_error("The server closed the connection");
+        connection.input.append(buffer, static_cast<std::size_t>(size));
+        std::size_t start = 0;
+        while (true)
+        {
+            const std::size_t newline = connection.input.find('\n', start);
+            if (newline == std::string::npos)
+                break;
+            if (connection.requests.empty())
+                throw std::runtime_error("Unexpected reply from the server");
+            const Request request = connection.requests.front();
+            connection.requests.pop_front();
+            handle_reply(
+                request, connection.input.substr(start, newline - start));
+            start = newline + 1;
+        }
+        connection.input.erase(0, start);
+    }
+
+    void handle_reply(const Request& request, const std::string& reply)
+    {
+        if (request.is_close)
+            return;
+        Session& session = sessions[request.session];
+        ++totals.requests;
+        totals.latency.record(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - session.sent)
+                .count()));
+
+        // ID STATE ROOM TUNNEL TUNNEL TUNNEL ARROWS PERCEPTS EVENTS
+        char state[32];
+        long long id;
+        int room, arrows;
+        int tunnels[3];
+        char percepts[4];
+        if (std::sscanf(
+                reply.c_str(),
+                "%lld %31s %d %d %d %d %d %3s",
+                &id,
+                state,
+                &room,
+                &tunnels[0],
+                &tunnels[1],
+                &tunnels[2],
+                &arrows,
+                percepts) != 8)
+            throw std::runtime_error("Bad reply from the server: " + reply);
+        session.id = id;
+        if (std::strcmp(state, "none") != 0)
+        {
+            ++totals.hunts;
+            if (std::strcmp(state, "wumpus_dead") == 0)
+                ++totals.wins;
+            return end_hunt(request.session);
+        }
+        const int target = tunnels[session.rng.uniform(0, 3)];
+        send(request.session, percepts[0] == 'w' && arrows > 0 ? 's' : 'm',
+             target);
+    }
+
+    void flush_all()
+    {
+        for (std::size_t i = 0; i < connections.size(); ++i)
+        {
+            Connection& connection = connections[i];
+            std::size_t written = 0;
+            while (written < connection.output.size())
+            {
+                const ssize_t size = write(
+                    connection.fd,
+                    connection.output.data() + written,
+                    connection.output.size() - written);
+                if (size < 0 && errno == EINTR)
+                    continue;
+                if (size < 0 && errno == EAGAIN)
+                    break;
+                if (size < 0)
+                    throw system_failure("write");
+                written += static_cast<std::size_t>(size);
+            }
+            connection.output.erase(0, written);
+
+            const bool is_waiting = !connection.output.empty();
+            if (is_waiting == connection.is_waiting_to_write)
+                continue;
+            connection.is_waiting_to_write = is_waiting;
+            epoll_event event{};
+            event.events =
+                EPOLLIN | (is_waiting ? std::uint32_t{EPOLLOUT} : 0u);
+            event.data.u32 = static_cast<std::uint32_t>(i);
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+        }
+    }
+};
+
+void print_usage()
+{
+    std::cerr << "Usage: wumpus_load --socket PATH [--connections N] "
+                 "[--sessions N] [--seconds N]\n"
+                 "                   [--seed N]"
+              << std::endl;
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+            throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--socket")
+            options.socket_path = value;
+        else if (arg == "--connections")
+            options.connections = std::stoi(value);
+        else if (arg == "--sessions")
+            options.sessions = std::stoi(value);
+        else if (arg == "--seconds")
+            options.seconds = std::stod(value);
+        else if (arg == "--seed")
+            options.seed = std::stoull(value);
+        else
+            throw std::invalid_argument("Unknown option: " + arg);
+    }
+    if (options.socket_path.empty())
+        throw std::invalid_argument("Missing --socket");
+    if (options.connections < 1 || options.sessions < options.connections)
+        throw std::invalid_argument("Need a session for every connection");
+    return options;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        options = parse_options(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        Load load{options};
+        const auto start = Clock::now();
+        const Totals& totals = load.run();
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+        std::cout << "connections: " << options.connections << std::endl
+                  << "sessions: " << options.sessions << std::endl
+                  << "requests: " << totals.requests << std::endl
+                  << "hunts: " << totals.hunts << std::endl
+                  << "wins: " << totals.wins << std::endl
+                  << std::fixed << std::setprecision(0)
+                  << "requests/sec: " << totals.requests / elapsed.count()
+                  << std::endl
+                  << std::setprecision(1) << "p50_us: "
+                  << totals.latency.quantile(0.5) / 1e3 << std::endl
+                  << "p99_us: " << totals.latency.quantile(0.99) / 1e3
+                  << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -3,29 +3,49 @@
 #include "cinder/app/App.h"
 #include "cinder/app/RendererGl.h"
 #include "cinder/gl/gl.h"
+#include "cinder/gl/Query.h"
 #include "cinder/Text.h"
 
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
 #include <string>
 #include <sstream>
 #include <memory>
-#include <atomic>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
 
+#include "cave_layout.h"
 #include "game.h"
+#include "snapshot_buffer.h"
+#include "spsc_queue.h"
 
 using namespace ci;
 using namespace ci::app;
 
 using namespace wumpus;
 
+// One piece of input for the game thread. A room is selected by clicking it,
+// and what that does depends on the mode.
 struct Action
 {
     enum class Action_type
     {
         none,
-        move,
-        shoot,
-        draw,
+        select,
+        move_mode,
+        shoot_mode,
+        draw_mode,
         quit,
         help
     } type{Action_type::none};
@@ -42,218 +62,900 @@ struct Action
     }
 };
 
-class HuntTheWumpusApp : public App
+// Collects the messages of the game until the console is next updated. The
+// text keeps its capacity between turns, so collecting does not allocate.
+class ConsoleSink : public Event_sink
 {
 public:
-    static std::string titleScreenText();
+    std::string text;
 
-    void setup() override;
-    void keyUp(KeyEvent event) override;
-    void mouseUp(MouseEvent event) override;
-    void update() override;
-    void draw() override;
+    ConsoleSink()
+    {
+        text.reserve(1024);
+    }
+
+    void on_event(Event event) override
+    {
+        text += event_message(event);
+        text += '\n';
+    }
+};
+
+// Rasterizes each piece of text once and keeps its texture while it is being
+// drawn. Entries are keyed on the text, the font, its size and the colour,
+// and are dropped once they go unused for a while or the window is resized.
+class TextCache
+{
+public:
+    // Draws the text like gl::drawString().
+    void drawString(
+        const std::string& text,
+        vec2 position,
+        const ColorA& color,
+        const Font& font);
+
+    // Drops the entries that have not been drawn for a while. Call this after
+    // drawing each frame that uses the cache.
+    void endFrame();
+    void clear();
 
 private:
-    std::atomic<bool> isEventTriggered{false};
-    std::atomic<bool> isTitleScreen{true};
-    std::atomic<bool> isGameOver{false};
-    std::atomic<bool> isShootEnabled{false};
-    std::atomic<bool> isDrawEnabled{false};
-    std::atomic<Action> nextAction;
-    std::atomic<int> arrows;
-
-    std::unique_ptr<Game> game;
-    float consoleHeight;
+    static const std::uint64_t maxUnusedFrames = 120;
 
-    std::stringstream buffer;
-    std::string outputText;
+    struct Key
+    {
+        std::string text;
+        std::string fontName;
+        float fontSize;
+        ColorA color;
 
-    std::array<bool, num_rooms> markedRooms{false};
+        auto tied() const
+        {
+            return std::tie(
+                text, fontName, fontSize, color.r, color.g, color.b, color.a);
+        }
+    };
 
-    void initialize();
+    // Looks up a Key without copying the text, so drawing cached text does
+    // not allocate.
+    struct KeyRef
+    {
+        const std::string& text;
+        const std::string& fontName;
+        float fontSize;
+        const ColorA& color;
 
-    void updateAction();
-    void updateActionTaken();
-    void updateOutputText();
+        auto tied() const
+        {
+            return std::tie(
+                text, fontName, fontSize, color.r, color.g, color.b, color.a);
+        }
+    };
 
-    void drawTitleScreen();
-    void drawBackground();
-    void drawHUD();
-    void drawCave();
-    void drawCaveRooms();
-    void drawCaveConnections();
-    void drawConsole();
+    struct KeyLess
+    {
+        using is_transparent = void;
 
-    vec2 getCenter(int roomNumber, vec2 caveSize) const;
-    float getRadius(vec2 caveSize) const;
-    bool isOnCircle(vec2 position, vec2 center, float radius) const;
+        template <typename A, typename B>
+        bool operator()(const A& a, const B& b) const
+        {
+            return a.tied() < b.tied();
+        }
+    };
+
+    struct Entry
+    {
+        gl::Texture2dRef texture;
+        float baselineOffset{0.0f};
+        std::uint64_t lastUsedFrame{0};
+    };
+
+    std::map<Key, Entry, KeyLess> entries;
+    std::uint64_t frame{0};
 };
 
-std::string HuntTheWumpusApp::titleScreenText()
-{
-    std::stringstream ss;
-    ss << Game::game_info();
-    ss << "During each turn you must make a move. The possible moves are:"
-       << std::endl
-       << "    \"m #\": Move to an adjacent room." << std::endl
-       << "    \"s #\": Shoot an arrow through the room specified. The range"
-       << std::endl
-       << "        of an arrow is " << arrow_range
-       << " rooms, and a path will be chosen at random." << std::endl
-       << "        You have " << num_arrows
-       << " arrows at the start of the game." << std::endl
-       << "    \"d\": Enter draw mode to mark rooms as dangerous." << std::endl
-       << "    \"q\": Quit the game and flee the cave." << std::endl
-       << "    \"h\": Pause the game and return to the title screen."
-       << std::endl
-       << "Good luck!" << std::endl;
-    return ss.str();
+void TextCache::drawString(
+    const std::string& text,
+    vec2 position,
+    const ColorA& color,
+    const Font& font)
+{
+    if (text.empty())
+        return;
+
+    const std::string& fontName = font.getName();
+    auto it = entries.find(KeyRef{text, fontName, font.getSize(), color});
+    if (it == entries.end())
+    {
+        Entry entry;
+        entry.texture = gl::Texture2d::create(
+            renderString(text, font, color, &entry.baselineOffset));
+        it = entries.emplace(Key{text, fontName, font.getSize(), color}, entry)
+                 .first;
+    }
+    it->second.lastUsedFrame = frame;
+
+    gl::ScopedColor scopedColor(ColorA(1.0f, 1.0f, 1.0f, 1.0f));
+    gl::ScopedBlendPremult scopedBlend;
+    gl::draw(
+        it->second.texture,
+        position - vec2(0.0f, it->second.baselineOffset));
 }
 
-void HuntTheWumpusApp::setup()
+void TextCache::endFrame()
 {
-    game = std::make_unique<Game>(buffer);
-    consoleHeight = 120.0f;
-    initialize();
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (frame - it->second.lastUsedFrame > maxUnusedFrames)
+            it = entries.erase(it);
+        else
+            ++it;
+    }
+    ++frame;
 }
 
-void HuntTheWumpusApp::initialize()
+void TextCache::clear()
 {
-    game->init_hunt();
-    game->inform_player_of_hazards();
-    arrows = game->get_arrows();
-    updateOutputText();
-    isShootEnabled = false;
-    isDrawEnabled = false;
-    markedRooms = {false};
-    nextAction = Action(Action::Action_type::none);
+    entries.clear();
 }
 
-void HuntTheWumpusApp::keyUp(KeyEvent event)
+// Draws the rooms and tunnels of the cave from buffers kept on the GPU. Each
+// tunnel is one line in a single batch, and the rooms are instances of one
+// circle, each with its colour and whether it is marked, which the fragment
+// shader turns into an X. The buffers are refilled only when the layout or
+// the rooms change.
+class CaveRenderer
 {
-    isEventTriggered = true;
+public:
+    // Places the rooms and tunnels as in the given layout.
+    void setLayout(const Cave_layout& layout);
+    void setRoom(int room, const Color& color, bool isMarked);
+    void draw();
 
-    auto key = event.getChar();
-    switch (key)
+private:
+    struct RoomInstance
     {
-    case 'm':
-        isShootEnabled = false;
-        isDrawEnabled = false;
-        break;
-    case 's':
-        isShootEnabled = true;
-        isDrawEnabled = false;
-        break;
-    case 'd':
-        isDrawEnabled = !isDrawEnabled;
-        break;
-    case 'q':
-        nextAction = Action(Action::Action_type::quit);
-        break;
-    case 'h':
-        nextAction = Action(Action::Action_type::help);
-        break;
-    default:
-        // Do nothing.
-        break;
-    }
+        vec2 center;
+        vec3 color;
+        float isMarked;
+    };
+
+    static const char* roomVertexShader;
+    static const char* roomFragmentShader;
+
+    Point caveSize{-1.0f, -1.0f};
+    float radius{0.0f};
+
+    gl::VboMeshRef tunnelMesh;
+    gl::BatchRef tunnelBatch;
+
+    std::vector<RoomInstance> rooms =
+        std::vector<RoomInstance>(num_rooms);
+    bool areRoomsDirty{true};
+    gl::VboRef roomVbo;
+    gl::BatchRef roomBatch;
+
+    void createBatches();
+};
+
+const char* CaveRenderer::roomVertexShader = R"(
+#version 150
+uniform mat4 ciModelViewProjection;
+uniform float uRadius;
+in vec4 ciPosition;
+in vec2 iCenter;
+in vec3 iColor;
+in float iIsMarked;
+out vec2 vPosition;
+out vec3 vColor;
+out float vIsMarked;
+void main()
+{
+    vPosition = ciPosition.xy;
+    vColor = iColor;
+    vIsMarked = iIsMarked;
+    gl_Position =
+        ciModelViewProjection * vec4(iCenter + uRadius * ciPosition.xy, 0, 1);
 }
+)";
 
-void HuntTheWumpusApp::mouseUp(MouseEvent event)
+// Positions are in units of the radius; the X spans the inner square.
+const char* CaveRenderer::roomFragmentShader = R"(
+#version 150
+uniform float uLineWidth;
+in vec2 vPosition;
+in vec3 vColor;
+in float vIsMarked;
+out vec4 oColor;
+void main()
 {
-    isEventTriggered = true;
+    vec2 p = abs(vPosition);
+    bool isOnX = vIsMarked > 0.5 && max(p.x, p.y) < 0.707 &&
+        abs(p.x - p.y) * 0.707 < 0.5 * uLineWidth;
+    oColor = vec4(isOnX ? vec3(0.0) : vColor, 1.0);
+}
+)";
 
-    auto windowSize = gl::getViewport().second;
-    vec2 caveSize(windowSize.x, windowSize.y - consoleHeight);
+void CaveRenderer::createBatches()
+{
+    int numTunnels = 0;
+    for (int i = 0; i < num_rooms; ++i)
+        for (int room : room_connections[i])
+            numTunnels += i < room;
+    tunnelMesh = gl::VboMesh::create(
+        2 * numTunnels,
+        GL_LINES,
+        {gl::VboMesh::Layout().usage(GL_STATIC_DRAW).attrib(
+            geom::Attrib::POSITION, 2)});
+    tunnelBatch = gl::Batch::create(
+        tunnelMesh, gl::getStockShader(gl::ShaderDef().color()));
 
-    // Which room did the user click on?
+    geom::BufferLayout instanceLayout;
+    instanceLayout.append(
+        geom::Attrib::CUSTOM_0,
+        2,
+        sizeof(RoomInstance),
+        offsetof(RoomInstance, center),
+        1);
+    instanceLayout.append(
+        geom::Attrib::CUSTOM_1,
+        3,
+        sizeof(RoomInstance),
+        offsetof(RoomInstance, color),
+        1);
+    instanceLayout.append(
+        geom::Attrib::CUSTOM_2,
+        1,
+        sizeof(RoomInstance),
+        offsetof(RoomInstance, isMarked),
+        1);
+    roomVbo = gl::Vbo::create(GL_ARRAY_BUFFER, rooms, GL_DYNAMIC_DRAW);
+    auto roomMesh =
+        gl::VboMesh::create(geom::Circle().radius(1.0f).subdivisions(48));
+    roomMesh->appendVbo(instanceLayout, roomVbo);
+    roomBatch = gl::Batch::create(
+        roomMesh,
+        gl::GlslProg::create(roomVertexShader, roomFragmentShader),
+        {{geom::Attrib::CUSTOM_0, "iCenter"},
+         {geom::Attrib::CUSTOM_1, "iColor"},
+         {geom::Attrib::CUSTOM_2, "iIsMarked"}});
+}
+
+void CaveRenderer::setLayout(const Cave_layout& layout)
+{
+    if (!roomBatch)
+        createBatches();
+    if (layout.size().x == caveSize.x && layout.size().y == caveSize.y)
+        return;
+    caveSize = layout.size();
+    radius = layout.radius();
+
+    auto getCenter = [&layout](int room) {
+        Point center = layout.center(room);
+        return vec2(center.x, center.y);
+    };
+    std::vector<vec2> tunnels;
     for (int i = 0; i < num_rooms; ++i)
     {
-        auto center = getCenter(i, caveSize);
-        auto radius = getRadius(caveSize);
-
-        if (isOnCircle(event.getPos(), center, radius))
+        for (int room : room_connections[i])
         {
-            if (isDrawEnabled)
-                nextAction = Action(Action::Action_type::draw, i);
-            else if (isShootEnabled)
-                nextAction = Action(Action::Action_type::shoot, i);
-            else
-                nextAction = Action(Action::Action_type::move, i);
-
-            break;
+            if (i < room)
+            {
+                tunnels.push_back(getCenter(i));
+                tunnels.push_back(getCenter(room));
+            }
         }
     }
+    tunnelMesh->bufferAttrib(geom::Attrib::POSITION, tunnels);
+
+    for (int i = 0; i < num_rooms; ++i)
+        rooms[i].center = getCenter(i);
+    areRoomsDirty = true;
 }
 
-void HuntTheWumpusApp::update()
+void CaveRenderer::setRoom(int room, const Color& color, bool isMarked)
 {
-    if (isEventTriggered)
+    RoomInstance& instance = rooms[room];
+    vec3 rgb(color.r, color.g, color.b);
+    float marked = isMarked ? 1.0f : 0.0f;
+    if (instance.color != rgb || instance.isMarked != marked)
+    {
+        instance.color = rgb;
+        instance.isMarked = marked;
+        areRoomsDirty = true;
+    }
+}
+
+void CaveRenderer::draw()
+{
+    if (areRoomsDirty)
+    {
+        roomVbo->bufferSubData(
+            0, rooms.size() * sizeof(RoomInstance), rooms.data());
+        areRoomsDirty = false;
+    }
+
+    gl::color(Color(0.60f, 0.60f, 0.60f));
+    tunnelBatch->draw();
+
+    auto& shader = roomBatch->getGlslProg();
+    shader->uniform("uRadius", radius);
+    shader->uniform("uLineWidth", std::max(radius / 10.0f, 1.0f) / radius);
+    roomBatch->drawInstanced(num_rooms);
+}
+
+// Times every frame and the stages within it on the CPU, and the whole frame
+// on the GPU where timer queries exist. The last few seconds of frames feed an
+// overlay with percentiles and a graph, and every frame can be traced to a
+// CSV file. Stages that issue GL calls are timed as submitted, so the GPU
+// time tells whether the GPU is the one falling behind.
+class FrameProfiler
+{
+    using Clock = std::chrono::steady_clock;
+
+public:
+    enum class Stage
     {
-        isEventTriggered = false;
+        update,
+        background,
+        hud,
+        cave,
+        roomNumbers,
+        console,
+        // Played on the game thread, and counted in the frame that shows it.
+        action
+    };
+
+    static const int numStages = static_cast<int>(Stage::action) + 1;
 
-        if (isTitleScreen)
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(FrameProfiler& profiler, Stage stage)
+            : profiler(profiler), stage(stage), start(Clock::now())
         {
-            isTitleScreen = false;
-            nextAction = Action(Action::Action_type::none);
         }
-        else if (isGameOver)
+
+        ~ScopedTimer()
         {
-            isTitleScreen = true;
-            isGameOver = false;
-            initialize();
+            profiler.addStageTime(stage, millisecondsSince(start));
         }
-        else
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        FrameProfiler& profiler;
+        Stage stage;
+        Clock::time_point start;
+    };
+
+    FrameProfiler();
+
+    // Called at the start of update() and once the frame is drawn.
+    void beginFrame();
+    void endFrame();
+    // Bracket the GL work of the frame.
+    void beginGpu();
+    void endGpu();
+
+    void addStageTime(Stage stage, float milliseconds);
+    // Called when the frame draws the scene rather than showing it again.
+    void markRedrawn();
+
+    bool isTracing() const;
+    // Starts or stops writing every frame to the file.
+    void toggleTrace(const std::string& path);
+
+    void drawOverlay(const Font& font);
+
+private:
+    static const int historySize = 240;
+    // Frames slower than this show in red.
+    static constexpr float slowFrameMs = 1.5f * 1000.0f / 60.0f;
+
+    struct FrameRecord
+    {
+        // From the start of this frame to the start of the next.
+        float periodMs{0.0f};
+        // From the start of update() to the end of draw().
+        float cpuMs{0.0f};
+        float gpuMs{0.0f};
+        std::array<float, numStages> stageMs{};
+        bool isRedrawn{false};
+    };
+
+    static float millisecondsSince(Clock::time_point start);
+    static const char* stageName(Stage stage);
+
+    FrameRecord current;
+    Clock::time_point frameStart;
+    bool hasFrameStarted{false};
+    std::array<FrameRecord, historySize> history;
+    int nextRecord{0};
+    int numRecords{0};
+    std::uint64_t frameNumber{0};
+
+#if !defined(CINDER_GL_ES)
+    gl::QueryTimeSwappedRef gpuQuery;
+    // The swapped query answers for the frame before, once there is one.
+    int gpuFrames{0};
+#endif
+
+    std::ofstream trace;
+
+    // The overlay text changes twice a second, so that its own cache keeps
+    // only a few textures.
+    TextCache overlayTextCache;
+    std::string overlayText;
+    Clock::time_point nextOverlayText;
+    std::array<float, historySize> sortScratch;
+
+    void record();
+    void writeTrace(const FrameRecord& frame);
+    void updateOverlayText();
+    float percentile(
+        float FrameRecord::*field, float fraction, int count);
+};
+
+FrameProfiler::FrameProfiler()
+{
+    overlayText.reserve(1024);
+}
+
+float FrameProfiler::millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(Clock::now() - start)
+        .count();
+}
+
+const char* FrameProfiler::stageName(Stage stage)
+{
+    static const char* names[numStages] = {
+        "update", "background", "hud", "cave", "room_numbers", "console",
+        "action"};
+    return names[static_cast<int>(stage)];
+}
+
+void FrameProfiler::beginFrame()
+{
+    const Clock::time_point now = Clock::now();
+    if (hasFrameStarted)
+    {
+        current.periodMs =
+            std::chrono::duration<float, std::milli>(now - frameStart).count();
+        record();
+    }
+    hasFrameStarted = true;
+    frameStart = now;
+}
+
+void FrameProfiler::endFrame()
+{
+    current.cpuMs = millisecondsSince(frameStart);
+}
+
+void FrameProfiler::beginGpu()
+{
+#if !defined(CINDER_GL_ES)
+    if (!gpuQuery)
+        gpuQuery = gl::QueryTimeSwapped::create();
+    gpuQuery->begin();
+#endif
+}
+
+void FrameProfiler::endGpu()
+{
+#if !defined(CINDER_GL_ES)
+    gpuQuery->end();
+    if (++gpuFrames > 1)
+        current.gpuMs = static_cast<float>(gpuQuery->getElapsedMilliseconds());
+#endif
+}
+
+void FrameProfiler::addStageTime(Stage stage, float milliseconds)
+{
+    current.stageMs[static_cast<int>(stage)] += milliseconds;
+}
+
+void FrameProfiler::markRedrawn()
+{
+    current.isRedrawn = true;
+}
+
+bool FrameProfiler::isTracing() const
+{
+    return trace.is_open();
+}
+
+void FrameProfiler::toggleTrace(const std::string& path)
+{
+    if (trace.is_open())
+    {
+        trace.close();
+        return;
+    }
+    trace.open(path);
+    if (!trace)
+        return;
+    trace << "frame,redrawn,period_ms,cpu_ms,gpu_ms";
+    for (int i = 0; i < numStages; ++i)
+        trace << ',' << stageName(static_cast<Stage>(i)) << "_ms";
+    trace << '\n';
+}
+
+// Files the finished frame. Its period is only known once the next one
+// starts.
+void FrameProfiler::record()
+{
+    history[nextRecord] = current;
+    nextRecord = (nextRecord + 1) % historySize;
+    // Compared rather than passed to std::min, which would take historySize
+    // by reference and need a definition of it outside the class.
+    if (numRecords < historySize)
+        ++numRecords;
+    if (trace.is_open())
+        writeTrace(current);
+    ++frameNumber;
+    current = FrameRecord();
+}
+
+void FrameProfiler::writeTrace(const FrameRecord& frame)
+{
+    trace << frameNumber << ',' << frame.isRedrawn << ',' << frame.periodMs
+          << ',' << frame.cpuMs << ',' << frame.gpuMs;
+    for (float milliseconds : frame.stageMs)
+        trace << ',' << milliseconds;
+    trace << '\n';
+}
+
+float FrameProfiler::percentile(
+    float FrameRecord::*field, float fraction, int count)
+{
+    for (int i = 0; i < count; ++i)
+        sortScratch[i] = history[i].*field;
+    const int rank = std::min(count - 1, static_cast<int>(fraction * count));
+    std::nth_element(
+        sortScratch.begin(),
+        sortScratch.begin() + rank,
+        sortScratch.begin() + count);
+    return sortScratch[rank];
+}
+
+void FrameProfiler::updateOverlayText()
+{
+    overlayText.clear();
+    if (numRecords == 0)
+        return;
+    char line[128];
+    const float fractions[] = {0.5f, 0.95f, 0.99f};
+    const std::pair<const char*, float FrameRecord::*> totals[] = {
+        {"frame", &FrameRecord::periodMs},
+        {"cpu", &FrameRecord::cpuMs},
+        {"gpu", &FrameRecord::gpuMs}};
+    std::snprintf(line, sizeof line, "%-13s %6s %6s %6s\n", "ms", "p50",
+                  "p95", "p99");
+    overlayText += line;
+    for (const auto& total : totals)
+    {
+        std::snprintf(
+            line,
+            sizeof line,
+            "%-13s %6.2f %6.2f %6.2f\n",
+            total.first,
+            percentile(total.second, fractions[0], numRecords),
+            percentile(total.second, fractions[1], numRecords),
+            percentile(total.second, fractions[2], numRecords));
+        overlayText += line;
+    }
+    // Frames that only show the scene again run no stage but update, so
+    // the stages are measured over the frames that redrew.
+    int numRedrawn = 0;
+    for (int i = 0; i < numRecords; ++i)
+        numRedrawn += history[i].isRedrawn;
+    std::snprintf(
+        line,
+        sizeof line,
+        "%-13s %6s %6s  %d redrawn\n",
+        "",
+        "mean",
+        "max",
+        numRedrawn);
+    overlayText += line;
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        float sum = 0.0f;
+        float max = 0.0f;
+        for (int i = 0; i < numRecords; ++i)
         {
-            updateAction();
+            if (!history[i].isRedrawn)
+                continue;
+            sum += history[i].stageMs[stage];
+            max = std::max(max, history[i].stageMs[stage]);
         }
+        std::snprintf(
+            line,
+            sizeof line,
+            "%-13s %6.3f %6.3f\n",
+            stageName(static_cast<Stage>(stage)),
+            numRedrawn > 0 ? sum / numRedrawn : 0.0f,
+            max);
+        overlayText += line;
     }
+    overlayText += isTracing() ? "tracing (F4 to stop)" : "F4 to trace";
 }
 
-void HuntTheWumpusApp::updateAction()
+void FrameProfiler::drawOverlay(const Font& font)
 {
-    Action action = nextAction;
-    nextAction = Action(Action::Action_type::none);
-    switch (action.type)
+    const Clock::time_point now = Clock::now();
+    if (now >= nextOverlayText)
     {
-    case Action::Action_type::none:
+        updateOverlayText();
+        nextOverlayText = now + std::chrono::milliseconds(500);
+    }
+
+    const float width = 460.0f;
+    const float textHeight = 330.0f;
+    const float graphHeight = 80.0f;
+    const vec2 origin(gl::getViewport().second.x - width, 0.0f);
+    gl::ScopedColor scopedColor;
+    gl::ScopedBlendAlpha scopedBlend;
+    gl::color(ColorA(0.0f, 0.0f, 0.0f, 0.7f));
+    gl::drawSolidRect(Rectf(
+        origin.x, origin.y, origin.x + width,
+        origin.y + textHeight + graphHeight));
+    overlayTextCache.drawString(
+        overlayText,
+        origin + vec2(8.0f, font.getSize()),
+        Color(1.0f, 1.0f, 1.0f),
+        font);
+    overlayTextCache.endFrame();
+
+    // Frame periods, oldest first, scaled so that two frames at 60 Hz fill
+    // the graph.
+    const float bottom = origin.y + textHeight + graphHeight;
+    const float scale = graphHeight / (2.0f * 1000.0f / 60.0f);
+    const float barWidth = width / historySize;
+    for (int i = 0; i < numRecords; ++i)
     {
-        break;
+        const int index =
+            (nextRecord - numRecords + i + historySize) % historySize;
+        const float periodMs = history[index].periodMs;
+        const float height = std::min(periodMs * scale, graphHeight);
+        gl::color(
+            periodMs > slowFrameMs ? Color(1.0f, 0.3f, 0.3f)
+                                   : Color(0.3f, 1.0f, 0.3f));
+        const float x = origin.x + i * barWidth;
+        gl::drawSolidRect(Rectf(x, bottom - height, x + barWidth, bottom));
+    }
+    gl::color(Color(1.0f, 1.0f, 1.0f));
+    const float targetY = bottom - scale * 1000.0f / 60.0f;
+    gl::drawLine(vec2(origin.x, targetY), vec2(origin.x + width, targetY));
+}
+
+// What the window shows, as published by the game thread after each action.
+struct Scene
+{
+    bool isTitleScreen{true};
+    bool isGameOver{false};
+    bool isShootEnabled{false};
+    bool isDrawEnabled{false};
+    Game_state gameState{Game_state::none};
+    int arrows{0};
+    int playerRoom{0};
+    // The number of the room at each index.
+    std::array<std::int8_t, num_rooms> roomNumbers{};
+    std::array<bool, num_rooms> markedRooms{};
+    std::string outputText;
+    // How long the game took to play the action behind this scene.
+    float actionMs{0.0f};
+};
+
+// Plays the game on a thread of its own. Input arrives as actions through a
+// lock-free queue, and each resulting scene goes out through a snapshot
+// buffer, so the main thread never waits for the game and the game never
+// waits for drawing. The mutex is only there to put the thread to sleep while
+// there is nothing to do.
+class GameThread
+{
+public:
+    GameThread();
+    ~GameThread();
+
+    GameThread(const GameThread&) = delete;
+    GameThread& operator=(const GameThread&) = delete;
+
+    // Called from the main thread. Returns false if the queue is full.
+    bool post(Action action);
+
+    // Called from the main thread. Takes the latest scene if there is a new
+    // one, and returns whether there was.
+    bool updateScene();
+    const Scene& getScene() const;
+
+private:
+    static const std::size_t actionCapacity = 256;
+
+    Spsc_queue<Action, actionCapacity> actions;
+    Snapshot_buffer<Scene> scenes;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool isStopping{false};
+
+    // Used only on the game thread once it runs.
+    ConsoleSink consoleSink;
+    Game game{consoleSink};
+    Scene scene;
+
+    std::thread thread;
+
+    void run();
+    void apply(const Action& action);
+    void initialize();
+    void updateAction(const Action& action);
+    void updateActionTaken();
+    void updateOutputText();
+    void publish();
+};
+
+GameThread::GameThread()
+{
+    scene.outputText.reserve(consoleSink.text.capacity());
+    initialize();
+    publish();
+    thread = std::thread([this]() { run(); });
+}
+
+GameThread::~GameThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        isStopping = true;
     }
-    case Action::Action_type::move:
+    wake.notify_one();
+    thread.join();
+}
+
+bool GameThread::post(Action action)
+{
+    if (!actions.push(action))
+        return false;
+    // Taking the mutex orders the push before the game thread next checks
+    // the queue, so the wake-up cannot be missed.
     {
-        auto target = game->get_rooms()[action.target].number;
-        if (game->can_move(target))
-            game->move(target);
-        updateActionTaken();
-        break;
+        std::lock_guard<std::mutex> lock(wakeMutex);
     }
-    case Action::Action_type::shoot:
+    wake.notify_one();
+    return true;
+}
+
+bool GameThread::updateScene()
+{
+    return scenes.update();
+}
+
+const Scene& GameThread::getScene() const
+{
+    return scenes.front();
+}
+
+void GameThread::run()
+{
+    Action action;
+    while (true)
     {
-        auto target = std::array<int, connections_per_room>{
-            game->get_rooms()[action.target].number, -1, -1};
-        if (game->can_shoot(target))
+        if (actions.pop(action))
         {
-            game->shoot(target);
-            isShootEnabled = false; // Allow one shot before switching back.
+            apply(action);
+            continue;
         }
-        updateActionTaken();
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wake.wait(lock, [this]() { return isStopping || !actions.empty(); });
+        if (isStopping)
+            return;
+    }
+}
+
+void GameThread::apply(const Action& action)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // The modes change on any screen.
+    switch (action.type)
+    {
+    case Action::Action_type::move_mode:
+        scene.isShootEnabled = false;
+        scene.isDrawEnabled = false;
+        break;
+    case Action::Action_type::shoot_mode:
+        scene.isShootEnabled = true;
+        scene.isDrawEnabled = false;
+        break;
+    case Action::Action_type::draw_mode:
+        scene.isDrawEnabled = !scene.isDrawEnabled;
         break;
+    default:
+        break;
+    }
+
+    if (scene.isTitleScreen)
+    {
+        scene.isTitleScreen = false;
+    }
+    else if (scene.isGameOver)
+    {
+        scene.isTitleScreen = true;
+        scene.isGameOver = false;
+        initialize();
+    }
+    else
+    {
+        updateAction(action);
     }
-    case Action::Action_type::draw:
+    scene.actionMs = std::chrono::duration<float, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    publish();
+}
+
+void GameThread::initialize()
+{
+    game.init_hunt();
+    game.inform_player_of_hazards();
+    updateOutputText();
+    scene.isShootEnabled = false;
+    scene.isDrawEnabled = false;
+    scene.markedRooms = {false};
+}
+
+void GameThread::updateAction(const Action& action)
+{
+    switch (action.type)
+    {
+    case Action::Action_type::none:
+    case Action::Action_type::move_mode:
+    case Action::Action_type::shoot_mode:
+    case Action::Action_type::draw_mode:
     {
-        markedRooms[action.target] = !markedRooms[action.target];
+        break;
+    }
+    case Action::Action_type::select:
+    {
+        if (scene.isDrawEnabled)
+        {
+            bool& isMarked = scene.markedRooms[action.target];
+            isMarked = !isMarked;
+        }
+        else if (scene.isShootEnabled)
+        {
+            auto target = std::array<int, connections_per_room>{
+                game.get_room_number(action.target), -1, -1};
+            if (game.can_shoot(target))
+            {
+                game.shoot(target);
+                // Allow one shot before switching back.
+                scene.isShootEnabled = false;
+            }
+            updateActionTaken();
+        }
+        else
+        {
+            auto target = game.get_room_number(action.target);
+            if (game.can_move(target))
+                game.move(target);
+            updateActionTaken();
+        }
         break;
     }
     case Action::Action_type::quit:
     {
-        game->quit();
+        game.quit();
         updateActionTaken();
         break;
     }
     case Action::Action_type::help:
     {
-        isTitleScreen = true;
+        scene.isTitleScreen = true;
         break;
     }
     default:
@@ -263,31 +965,305 @@ void HuntTheWumpusApp::updateAction()
     }
 }
 
-void HuntTheWumpusApp::updateActionTaken()
+void GameThread::updateActionTaken()
 {
-    if (game->is_hunt_over())
+    if (game.is_hunt_over())
     {
-        game->end_hunt();
-        isGameOver = true;
+        game.end_hunt();
+        scene.isGameOver = true;
     }
     else
     {
-        game->inform_player_of_hazards();
+        game.inform_player_of_hazards();
     }
-    arrows = game->get_arrows();
     updateOutputText();
 }
 
-void HuntTheWumpusApp::updateOutputText()
+void GameThread::updateOutputText()
+{
+    scene.outputText.swap(consoleSink.text);
+    consoleSink.text.clear();
+}
+
+void GameThread::publish()
+{
+    const Hunt_state& hunt = game.get_state();
+    scene.gameState = hunt.state;
+    scene.arrows = hunt.arrows;
+    scene.playerRoom = hunt.player_room();
+    scene.roomNumbers = hunt.numbers;
+    // Copying into the slot reuses its capacity, so publishing does not
+    // allocate once the text has been as long before.
+    scenes.back() = scene;
+    scenes.publish();
+}
+
+class HuntTheWumpusApp : public App
+{
+public:
+    static const std::string& titleScreenText();
+    // The text of the HUD and of the room numbers, built once so that drawing
+    // a frame does not allocate.
+    static const std::string& hudText(
+        bool isShooting, bool isDrawing, int arrows);
+    static const std::string& roomNumberText(int number);
+
+    void setup() override;
+    void resize() override;
+    void keyUp(KeyEvent event) override;
+    void mouseUp(MouseEvent event) override;
+    void update() override;
+    void draw() override;
+
+private:
+    std::unique_ptr<GameThread> gameThread;
+    // Actions that found the queue full, in order, to be posted again.
+    std::deque<Action> pendingActions;
+    float consoleHeight;
+
+    Cave_layout caveLayout;
+    TextCache textCache;
+    CaveRenderer caveRenderer;
+    Font titleFont;
+    Font hudFont;
+    Font consoleFont;
+    // Sized to the rooms, so recreated when they change size.
+    Font roomFont;
+    float roomFontSize{0.0f};
+
+    // The scene is drawn into sceneFbo only when something on screen changed,
+    // and each frame just shows it. After a while with nothing to draw, the
+    // frame rate drops to the idle rate until the next change.
+    static constexpr float activeFrameRate = 60.0f;
+    static constexpr float idleFrameRate = 10.0f;
+    static const int framesBeforeIdle = 30;
+    gl::FboRef sceneFbo;
+    bool isSceneDirty{true};
+    bool isIdle{false};
+    int framesSinceChange{0};
+
+    // While profiling, the frame rate stays active, so that the frame times
+    // are not those of the idle rate.
+    FrameProfiler profiler;
+    bool isProfilerShown{false};
+
+    void postAction(Action action);
+    void markSceneDirty();
+    void keepActive();
+    bool isProfiling() const;
+
+    void drawScene();
+    void drawTitleScreen();
+    void drawBackground();
+    void drawHUD();
+    void drawCave();
+    void drawRoomNumbers();
+    void drawConsole();
+
+    // Returns the layout of the cave in the current viewport, recomputing it
+    // only when the viewport changes size.
+    const Cave_layout& getCaveLayout();
+};
+
+const std::string& HuntTheWumpusApp::titleScreenText()
+{
+    static const std::string text = []() {
+        std::stringstream ss;
+        ss << Game::game_info();
+        ss << "During each turn you must make a move. The possible moves are:"
+           << std::endl
+           << "    \"m #\": Move to an adjacent room." << std::endl
+           << "    \"s #\": Shoot an arrow through the room specified. The "
+              "range"
+           << std::endl
+           << "        of an arrow is " << arrow_range
+           << " rooms, and a path will be chosen at random." << std::endl
+           << "        You have " << num_arrows
+           << " arrows at the start of the game." << std::endl
+           << "    \"d\": Enter draw mode to mark rooms as dangerous."
+           << std::endl
+           << "    \"q\": Quit the game and flee the cave." << std::endl
+           << "    \"h\": Pause the game and return to the title screen."
+           << std::endl
+           << "Good luck!" << std::endl;
+        return ss.str();
+    }();
+    return text;
+}
+
+const std::string& HuntTheWumpusApp::hudText(
+    bool isShooting, bool isDrawing, int arrows)
+{
+    // By mode (move, shoot, draw) and arrows left.
+    static const auto texts = []() {
+        const char* modes[] = {"MOVE", "SHOOT", "DRAW"};
+        std::array<std::array<std::string, num_arrows + 1>, 3> texts;
+        for (int mode = 0; mode < 3; ++mode)
+            for (int i = 0; i <= num_arrows; ++i)
+                texts[mode][i] = std::string{modes[mode]} + "\nARROWS: " +
+                    std::to_string(i);
+        return texts;
+    }();
+    return texts[isDrawing ? 2 : isShooting ? 1 : 0][arrows];
+}
+
+const std::string& HuntTheWumpusApp::roomNumberText(int number)
+{
+    static const auto texts = []() {
+        std::array<std::string, num_rooms + 1> texts;
+        for (int i = 1; i <= num_rooms; ++i)
+            texts[i] = std::to_string(i);
+        return texts;
+    }();
+    return texts[number];
+}
+
+void HuntTheWumpusApp::setup()
+{
+    gameThread = std::make_unique<GameThread>();
+    consoleHeight = 120.0f;
+    setFrameRate(activeFrameRate);
+    titleFont = Font("Consolas", 20);
+    hudFont = Font("Consolas", 32);
+    consoleFont = Font("Consolas", 32);
+}
+
+void HuntTheWumpusApp::resize()
+{
+    textCache.clear();
+    sceneFbo.reset();
+    markSceneDirty();
+}
+
+void HuntTheWumpusApp::markSceneDirty()
+{
+    isSceneDirty = true;
+    keepActive();
+}
+
+void HuntTheWumpusApp::keepActive()
+{
+    framesSinceChange = 0;
+    if (isIdle)
+    {
+        isIdle = false;
+        setFrameRate(activeFrameRate);
+    }
+}
+
+bool HuntTheWumpusApp::isProfiling() const
+{
+    return isProfilerShown || profiler.isTracing();
+}
+
+void HuntTheWumpusApp::postAction(Action action)
+{
+    if (!pendingActions.empty() || !gameThread->post(action))
+        pendingActions.push_back(action);
+    // Show the outcome at the active frame rate.
+    keepActive();
+}
+
+void HuntTheWumpusApp::keyUp(KeyEvent event)
+{
+    // The profiler keys are left out of the game.
+    if (event.getCode() == KeyEvent::KEY_F3)
+    {
+        isProfilerShown = !isProfilerShown;
+        keepActive();
+        return;
+    }
+    if (event.getCode() == KeyEvent::KEY_F4)
+    {
+        profiler.toggleTrace((getAppPath() / "frame_trace.csv").string());
+        keepActive();
+        return;
+    }
+
+    // Every key counts, as any key leaves the title and game over screens.
+    auto key = event.getChar();
+    switch (key)
+    {
+    case 'm':
+        postAction(Action(Action::Action_type::move_mode));
+        break;
+    case 's':
+        postAction(Action(Action::Action_type::shoot_mode));
+        break;
+    case 'd':
+        postAction(Action(Action::Action_type::draw_mode));
+        break;
+    case 'q':
+        postAction(Action(Action::Action_type::quit));
+        break;
+    case 'h':
+        postAction(Action(Action::Action_type::help));
+        break;
+    default:
+        postAction(Action(Action::Action_type::none));
+        break;
+    }
+}
+
+void HuntTheWumpusApp::mouseUp(MouseEvent event)
 {
-    outputText = buffer.str();
-    buffer = std::stringstream{};
+    // Which room did the user click on?
+    vec2 position = event.getPos();
+    int room = getCaveLayout().room_at({position.x, position.y});
+    if (room < 0)
+        postAction(Action(Action::Action_type::none));
+    else
+        postAction(Action(Action::Action_type::select, room));
+}
+
+void HuntTheWumpusApp::update()
+{
+    profiler.beginFrame();
+    FrameProfiler::ScopedTimer timer(profiler, FrameProfiler::Stage::update);
+    while (!pendingActions.empty() && gameThread->post(pendingActions.front()))
+        pendingActions.pop_front();
+    if (gameThread->updateScene())
+    {
+        profiler.addStageTime(
+            FrameProfiler::Stage::action, gameThread->getScene().actionMs);
+        markSceneDirty();
+    }
 }
 
 void HuntTheWumpusApp::draw()
 {
+    if (!sceneFbo)
+        sceneFbo = gl::Fbo::create(getWindowWidth(), getWindowHeight());
+    profiler.beginGpu();
+    if (isSceneDirty)
+    {
+        gl::ScopedFramebuffer scopedFramebuffer(sceneFbo);
+        gl::ScopedViewport scopedViewport(ivec2(0), sceneFbo->getSize());
+        drawScene();
+        isSceneDirty = false;
+        profiler.markRedrawn();
+    }
+    else if (
+        !isIdle && !isProfiling() && ++framesSinceChange >= framesBeforeIdle)
+    {
+        isIdle = true;
+        setFrameRate(idleFrameRate);
+    }
+
     gl::clear();
-    if (isTitleScreen)
+    gl::draw(sceneFbo->getColorTexture());
+    profiler.endGpu();
+    profiler.endFrame();
+
+    // Drawn over the scene each frame, and left out of the frame's times.
+    if (isProfilerShown)
+        profiler.drawOverlay(titleFont);
+}
+
+void HuntTheWumpusApp::drawScene()
+{
+    gl::clear();
+    if (gameThread->getScene().isTitleScreen)
     {
         drawTitleScreen();
     }
@@ -296,24 +1272,29 @@ void HuntTheWumpusApp::draw()
         drawBackground();
         drawHUD();
         drawCave();
+        drawRoomNumbers();
         drawConsole();
     }
+    textCache.endFrame();
 }
 
 void HuntTheWumpusApp::drawTitleScreen()
 {
-    gl::drawString(
+    textCache.drawString(
         titleScreenText(),
         vec2(0.0f, 0.0f),
         Color(0.0f, 1.0f, 0.0f),
-        Font("Consolas", 20));
+        titleFont);
 }
 
 void HuntTheWumpusApp::drawBackground()
 {
-    if (isGameOver)
+    FrameProfiler::ScopedTimer timer(
+        profiler, FrameProfiler::Stage::background);
+    const Scene& scene = gameThread->getScene();
+    if (scene.isGameOver)
     {
-        if (game->get_game_state() == Game_state::wumpus_dead)
+        if (scene.gameState == Game_state::wumpus_dead)
         {
             gl::clear(Color(0.0f, 0.25f, 0.0f));
         }
@@ -322,11 +1303,11 @@ void HuntTheWumpusApp::drawBackground()
             gl::clear(Color(0.25f, 0.0f, 0.0f));
         }
     }
-    else if (isDrawEnabled)
+    else if (scene.isDrawEnabled)
     {
         gl::clear(Color(0.2f, 0.2f, 0.2f));
     }
-    else if (isShootEnabled)
+    else if (scene.isShootEnabled)
     {
         gl::clear(Color(0.0f, 0.0f, 0.25f));
     }
@@ -334,121 +1315,76 @@ void HuntTheWumpusApp::drawBackground()
 
 void HuntTheWumpusApp::drawHUD()
 {
-    std::string value = isShootEnabled ? "SHOOT" : "MOVE";
-    value = isDrawEnabled ? "DRAW" : value;
-
-    value += "\n";
-    value += "ARROWS: " + std::to_string(arrows);
-    gl::drawString(
-        value, vec2(0.0f, 0.0f), Color(0.0f, 1.0f, 0.0f), Font("Consolas", 32));
+    FrameProfiler::ScopedTimer timer(
+        profiler, FrameProfiler::Stage::hud);
+    const Scene& scene = gameThread->getScene();
+    textCache.drawString(
+        hudText(scene.isShootEnabled, scene.isDrawEnabled, scene.arrows),
+        vec2(0.0f, 0.0f),
+        Color(0.0f, 1.0f, 0.0f),
+        hudFont);
 }
 
 void HuntTheWumpusApp::drawCave()
 {
-    drawCaveConnections();
-    drawCaveRooms();
-}
-
-void HuntTheWumpusApp::drawCaveRooms()
-{
-    auto windowSize = gl::getViewport().second;
-    vec2 caveSize(windowSize.x, windowSize.y - consoleHeight);
-
-    auto playerRoom = game->get_player_room();
-    auto rooms = game->get_rooms();
+    FrameProfiler::ScopedTimer timer(
+        profiler, FrameProfiler::Stage::cave);
+    const Scene& scene = gameThread->getScene();
+    caveRenderer.setLayout(getCaveLayout());
     for (int i = 0; i < num_rooms; ++i)
     {
-        auto center = getCenter(i, caveSize);
-        auto radius = getRadius(caveSize);
-
-        if (rooms[i].number == playerRoom->number)
-            gl::color(Color(0.80f, 1.0f, 0.80f));
-        else
-            gl::color(Color(0.60f, 0.60f, 0.60f));
-
-        gl::drawSolidCircle(center, radius);
-
-        gl::drawString(
-            std::to_string(rooms[i].number),
-            center,
-            Color(0.0f, 0.0f, 0.0f),
-            Font("Consolas", radius));
-
-        if (markedRooms[i])
-        {
-            // Draw an X over the room.
-            gl::color(Color(0.0f, 0.0f, 0.0f));
-            gl::lineWidth(std::max(radius / 10.0f, 1.0f));
-
-            vec2 v1(radius * 0.707f, radius * 0.707f);
-            gl::drawLine(center - v1, center + v1);
-            vec2 v2(radius * 0.707f, -radius * 0.707f);
-            gl::drawLine(center - v2, center + v2);
-
-            gl::lineWidth(1.0f);
-        }
+        caveRenderer.setRoom(
+            i,
+            i == scene.playerRoom ? Color(0.80f, 1.0f, 0.80f)
+                                  : Color(0.60f, 0.60f, 0.60f),
+            scene.markedRooms[i]);
     }
+    caveRenderer.draw();
 }
 
-void HuntTheWumpusApp::drawCaveConnections()
+void HuntTheWumpusApp::drawRoomNumbers()
 {
-    auto windowSize = gl::getViewport().second;
-    vec2 caveSize(windowSize.x, windowSize.y - consoleHeight);
+    FrameProfiler::ScopedTimer timer(
+        profiler, FrameProfiler::Stage::roomNumbers);
+    const Cave_layout& layout = getCaveLayout();
+    auto radius = layout.radius();
+    if (roomFontSize != radius)
+    {
+        roomFont = Font("Consolas", radius);
+        roomFontSize = radius;
+    }
 
-    auto playerRoom = game->get_player_room();
-    auto rooms = game->get_rooms();
     for (int i = 0; i < num_rooms; ++i)
     {
-        auto center = getCenter(i, caveSize);
-
-        for (int j = 0; j < connections_per_room; ++j)
-        {
-            gl::color(Color(0.60f, 0.60f, 0.60f));
-            gl::drawLine(center, getCenter(room_connections[i][j], caveSize));
-        }
+        Point center = layout.center(i);
+        textCache.drawString(
+            roomNumberText(gameThread->getScene().roomNumbers[i]),
+            vec2(center.x, center.y),
+            Color(0.0f, 0.0f, 0.0f),
+            roomFont);
     }
 }
 
 void HuntTheWumpusApp::drawConsole()
 {
+    FrameProfiler::ScopedTimer timer(
+        profiler, FrameProfiler::Stage::console);
     vec2 offset(0.0f, gl::getViewport().second.y - consoleHeight);
-    gl::drawString(
-        outputText, offset, Color(0.0f, 1.0f, 0.0f), Font("Consolas", 32));
-}
-
-vec2 HuntTheWumpusApp::getCenter(int roomNumber, vec2 caveSize) const
-{
-    auto roomRadius = 3.0f * getRadius(caveSize);
-    if (roomNumber < 5)
-    {
-        roomNumber *= 2;
-    }
-    else if (roomNumber < 15)
-    {
-        roomNumber -= 5;
-        roomRadius *= 2.0f;
-    }
-    else
-    {
-        roomNumber -= 15;
-        roomNumber *= 2;
-        roomNumber += 1;
-        roomRadius *= 3.0f;
-    }
-    auto x = roomRadius * std::sinf(2.0f * (float) M_PI * roomNumber / 10.0f);
-    auto y = roomRadius * std::cosf(2.0f * (float) M_PI * roomNumber / 10.0f);
-    return vec2(x, y) + caveSize / 2.0f;
-}
-
-float HuntTheWumpusApp::getRadius(vec2 caveSize) const
-{
-    return std::min(caveSize.x, caveSize.y) / 22.5f;
+    textCache.drawString(
+        gameThread->getScene().outputText,
+        offset,
+        Color(0.0f, 1.0f, 0.0f),
+        consoleFont);
 }
 
-bool HuntTheWumpusApp::isOnCircle(vec2 position, vec2 center, float radius) const
+const Cave_layout& HuntTheWumpusApp::getCaveLayout()
 {
-    auto delta = position - center;
-    return delta.x * delta.x + delta.y * delta.y <= radius * radius;
+    auto windowSize = gl::getViewport().second;
+    Point caveSize{static_cast<float>(windowSize.x),
+                   windowSize.y - consoleHeight};
+    if (caveSize.x != caveLayout.size().x || caveSize.y != caveLayout.size().y)
+        caveLayout = Cave_layout(caveSize);
+    return caveLayout;
 }
 
 CINDER_APP(HuntTheWumpusApp, RendererGl)
@@ -1,38 +1,111 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <random>
-#include <algorithm>
 
 namespace wumpus {
 
-// Returns a random integer in the range [lower, upper).
-int random(int lower, int upper)
+// Returns a seed drawn from the system's source of randomness.
+inline std::uint64_t random_seed()
 {
-    static std::default_random_engine rng_engine{std::random_device()()};
-    std::uniform_int_distribution<int> rng_dist(lower, upper - 1);
-    return rng_dist(rng_engine);
+    std::random_device device;
+    return (static_cast<std::uint64_t>(device()) << 32) ^ device();
 }
 
-// Returns a random integer in the range [lower, upper) that satisfies the given
-// predicate. UnaryPredicate must be a predicate acting on an integer.
-template <typename UnaryPredicate>
-int random_if(int lower, int upper, UnaryPredicate pred)
+// A small, fast pseudo-random number generator (xoshiro128**) with unbiased
+// bounded sampling. Each game owns its own generator, so games are
+// reproducible from their seed and can run on separate threads.
+class Rng
 {
-    int result = random(lower, upper);
-    while (!pred(result))
-        result = random(lower, upper);
-    return result;
-}
+public:
+    using result_type = std::uint32_t;
 
-// Returns a random integer in the range [lower, upper) that is not in the
-// excludes. Container must be a container of integers.
-template <typename Container>
-int random(int lower, int upper, const Container& excludes)
-{
-    auto begin = std::begin(excludes);
-    auto end = std::end(excludes);
-    return random_if(lower, upper, [begin, end](int x) {
-        return std::find(begin, end, x) == end;
-    });
-}
+    explicit Rng(std::uint64_t seed = random_seed())
+    {
+        this->seed(seed);
+    }
+
+    // Resets the generator to the sequence identified by the given seed.
+    void seed(std::uint64_t seed)
+    {
+        // Expand the seed with splitmix64, which never yields an all-zero
+        // state for xoshiro.
+        for (int i = 0; i < 4; i += 2)
+        {
+            seed += 0x9e3779b97f4a7c15ULL;
+            std::uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= z >> 31;
+            state[i] = static_cast<std::uint32_t>(z);
+            state[i + 1] = static_cast<std::uint32_t>(z >> 32);
+        }
+    }
+
+    // The raw state of the generator, for code that steps many generators
+    // side by side.
+    using State = std::array<std::uint32_t, 4>;
+
+    const State& get_state() const
+    {
+        return state;
+    }
+
+    void set_state(const State& state)
+    {
+        this->state = state;
+    }
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        const std::uint32_t result = rotl(state[1] * 5, 7) * 9;
+        const std::uint32_t t = state[1] << 9;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 11);
+        return result;
+    }
+
+    // Returns a random integer in the range [lower, upper), using Lemire's
+    // multiply-and-reject method.
+    int uniform(int lower, int upper)
+    {
+        const std::uint32_t range = static_cast<std::uint32_t>(upper - lower);
+        std::uint64_t product = static_cast<std::uint64_t>((*this)()) * range;
+        std::uint32_t low = static_cast<std::uint32_t>(product);
+        if (low < range)
+        {
+            const std::uint32_t threshold = (0u - range) % range;
+            while (low < threshold)
+            {
+                product = static_cast<std::uint64_t>((*this)()) * range;
+                low = static_cast<std::uint32_t>(product);
+            }
+        }
+        return lower + static_cast<int>(product >> 32);
+    }
+
+private:
+    State state;
+
+    static std::uint32_t rotl(std::uint32_t x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+};
 }
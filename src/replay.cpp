@@ -0,0 +1,344 @@
+#include "replay.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace wumpus {
+
+namespace {
+
+const char magic[8] = {'W', 'U', 'M', 'P', 'U', 'S', 'R', '1'};
+
+// The top two bits of the first byte of an action give its type.
+const std::uint8_t move_code = 0x00;
+const std::uint8_t shoot_code = 0x40;
+const std::uint8_t quit_code = 0x80;
+const std::uint8_t code_mask = 0xc0;
+
+const int target_base = num_rooms + 1;
+static_assert(
+    target_base * target_base * target_base <= 0x4000,
+    "The targets of a shot must fit in fourteen bits");
+
+// The fixed part of a record after its length: the seed, the player, the
+// wumpus, the bats, the pits and the outcome.
+const std::size_t header_size = 8 + 2 + num_bats + num_pits + 1;
+
+const std::size_t buffer_size = 1 << 20;
+
+int encode_target(int target)
+{
+    return target >= 1 && target <= num_rooms ? target : 0;
+}
+
+int decode_target(int code)
+{
+    return code == 0 ? -1 : code;
+}
+
+void put_rooms(std::vector<std::uint8_t>& out, Room_mask rooms)
+{
+    for (; rooms; rooms &= rooms - 1)
+        out.push_back(static_cast<std::uint8_t>(room_index(rooms)));
+}
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+[[noreturn]] void malformed(const char* what)
+{
+    throw std::runtime_error(std::string{"Malformed replay log: "} + what);
+}
+
+Room_mask get_room(const std::uint8_t*& in)
+{
+    if (*in >= num_rooms)
+        malformed("invalid room");
+    return room_bit(*in++);
+}
+}
+
+bool Replay_record::next_action(
+    std::size_t& offset, Replay_action& action) const
+{
+    if (offset >= actions_size)
+        return false;
+    const std::uint8_t first = actions[offset++];
+    action.targets = {{-1, -1, -1}};
+    switch (first & code_mask)
+    {
+    case move_code:
+        action.type = Replay_action::Type::move;
+        action.targets[0] = decode_target(first & ~code_mask);
+        break;
+    case shoot_code:
+    {
+        if (offset >= actions_size)
+            malformed("truncated shot");
+        int code = (first & ~code_mask) << 8 | actions[offset++];
+        action.type = Replay_action::Type::shoot;
+        for (int i = arrow_range - 1; i >= 0; --i, code /= target_base)
+            action.targets[i] = decode_target(code % target_base);
+        break;
+    }
+    case quit_code:
+        action.type = Replay_action::Type::quit;
+        break;
+    default:
+        malformed("invalid action");
+    }
+    return true;
+}
+
+void Replay_recorder::begin(std::uint64_t seed, const Hunt_state& state)
+{
+    hunt.clear();
+    for (int i = 0; i < 8; ++i)
+        hunt.push_back(static_cast<std::uint8_t>(seed >> (8 * i)));
+    put_rooms(hunt, state.hazards.player);
+    put_rooms(hunt, state.hazards.wumpus);
+    put_rooms(hunt, state.hazards.bats);
+    put_rooms(hunt, state.hazards.pits);
+    hunt.push_back(static_cast<std::uint8_t>(Game_state::none));
+}
+
+void Replay_recorder::move(int target)
+{
+    hunt.push_back(
+        static_cast<std::uint8_t>(move_code | encode_target(target)));
+}
+
+void Replay_recorder::shoot(const std::array<int, arrow_range>& targets)
+{
+    int code = 0;
+    for (int target : targets)
+        code = code * target_base + encode_target(target);
+    hunt.push_back(static_cast<std::uint8_t>(shoot_code | code >> 8));
+    hunt.push_back(static_cast<std::uint8_t>(code));
+}
+
+void Replay_recorder::quit()
+{
+    hunt.push_back(quit_code);
+}
+
+void Replay_recorder::end(Game_state outcome)
+{
+    hunt[header_size - 1] = static_cast<std::uint8_t>(outcome);
+    put_varint(records, hunt.size());
+    records.insert(records.end(), hunt.begin(), hunt.end());
+}
+
+const std::vector<std::uint8_t>& Replay_recorder::data() const
+{
+    return records;
+}
+
+void Replay_recorder::clear()
+{
+    records.clear();
+}
+
+Replay_writer::Replay_writer(const std::string& path)
+    : file{std::fopen(path.c_str(), "ab")}, buffer(buffer_size)
+{
+    if (!file)
+        throw std::runtime_error("Cannot open replay log " + path);
+    std::setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+    std::fseek(file, 0, SEEK_END);
+    if (std::ftell(file) == 0)
+        std::fwrite(magic, 1, sizeof(magic), file);
+}
+
+Replay_writer::~Replay_writer()
+{
+    std::fclose(file);
+}
+
+void Replay_writer::write(const std::vector<std::uint8_t>& records)
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    std::fwrite(records.data(), 1, records.size(), file);
+}
+
+void Replay_writer::flush()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    if (std::fflush(file) != 0 || std::ferror(file))
+        throw std::runtime_error("Cannot write the replay log");
+}
+
+Replay_reader::Replay_reader(const std::string& path)
+{
+    const std::string error = "Cannot map replay log " + path;
+#if defined(_WIN32)
+    file = CreateFileA(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error(error);
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    data_size = static_cast<std::size_t>(file_size.QuadPart);
+    if (data_size > 0)
+    {
+        mapping =
+            CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+            data = static_cast<const std::uint8_t*>(
+                MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!data)
+        {
+            if (mapping)
+                CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error(error);
+        }
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(error);
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        throw std::runtime_error(error);
+    }
+    data_size = static_cast<std::size_t>(status.st_size);
+    if (data_size > 0)
+    {
+        void* address =
+            mmap(nullptr, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error(error);
+        }
+        madvise(address, data_size, MADV_SEQUENTIAL);
+        data = static_cast<const std::uint8_t*>(address);
+    }
+    close(fd);
+#endif
+    if (data_size < sizeof(magic) ||
+        std::memcmp(data, magic, sizeof(magic)) != 0)
+    {
+        unmap();
+        throw std::runtime_error(path + " is not a replay log");
+    }
+}
+
+Replay_reader::~Replay_reader()
+{
+    unmap();
+}
+
+bool Replay_reader::next(std::size_t& offset, Replay_record& record) const
+{
+    if (offset >= data_size)
+        return false;
+
+    const std::uint64_t length = record_length(offset);
+
+    const std::uint8_t* in = data + offset;
+    record.seed = 0;
+    for (int i = 0; i < 8; ++i)
+        record.seed |= static_cast<std::uint64_t>(*in++) << (8 * i);
+    record.hazards = Hazard_masks{};
+    record.hazards.player = get_room(in);
+    record.hazards.wumpus = get_room(in);
+    for (int i = 0; i < num_bats; ++i)
+        record.hazards.bats |= get_room(in);
+    for (int i = 0; i < num_pits; ++i)
+        record.hazards.pits |= get_room(in);
+    if (*in > static_cast<std::uint8_t>(Game_state::player_quit))
+        malformed("invalid outcome");
+    record.outcome = static_cast<Game_state>(*in++);
+    record.actions = in;
+    record.actions_size = length - header_size;
+    offset += length;
+    return true;
+}
+
+std::size_t Replay_reader::begin() const
+{
+    return sizeof(magic);
+}
+
+std::size_t Replay_reader::size() const
+{
+    return data_size;
+}
+
+std::vector<std::size_t> Replay_reader::split(int parts) const
+{
+    std::vector<std::size_t> bounds{begin()};
+    std::size_t offset = begin();
+    for (int i = 1; i < parts; ++i)
+    {
+        const std::size_t target =
+            begin() + (data_size - begin()) / parts * i;
+        while (offset < target)
+        {
+            const std::uint64_t length = record_length(offset);
+            offset += static_cast<std::size_t>(length);
+        }
+        bounds.push_back(offset);
+    }
+    bounds.push_back(data_size);
+    return bounds;
+}
+
+// Reads the length of the record at the given offset and advances the offset
+// to its contents.
+std::uint64_t Replay_reader::record_length(std::size_t& offset) const
+{
+    std::uint64_t length = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        if (offset >= data_size || shift > 63)
+            malformed("truncated length");
+        std::uint8_t byte = data[offset++];
+        length |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            break;
+    }
+    if (length < header_size || length > data_size - offset)
+        malformed("truncated record");
+    return length;
+}
+
+void Replay_reader::unmap()
+{
+#if defined(_WIN32)
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    if (data)
+        munmap(const_cast<std::uint8_t*>(data), data_size);
+#endif
+    data = nullptr;
+}
+}
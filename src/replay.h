@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+namespace wumpus {
+
+// Compact binary logs of hunts, for archiving and re-verifying them.
+//
+// A log starts with an eight byte magic string and holds one record per hunt:
+// its length as a base-128 varint, then the seed the game was given before
+// init_hunt(), the starting room of the player and of the wumpus, the rooms of
+// the bats and of the pits, the outcome of the hunt and the actions taken, in
+// that order. Integers are little endian and rooms are one byte indices. A
+// move takes one byte, holding its target room number, a shot two bytes,
+// holding its three target numbers in base num_rooms + 1 with 0 for none, and
+// a quit one byte. A typical hunt takes a few dozen bytes.
+
+struct Replay_action
+{
+    enum class Type : std::uint8_t
+    {
+        move,
+        shoot,
+        quit
+    } type{Type::quit};
+    // Room numbers, as passed to the game, or -1 for none. A move uses the
+    // first.
+    std::array<int, arrow_range> targets{{-1, -1, -1}};
+};
+
+// A hunt read from a log. The actions point into the log.
+struct Replay_record
+{
+    std::uint64_t seed{0};
+    Hazard_masks hazards;
+    Game_state outcome{Game_state::none};
+    const std::uint8_t* actions{nullptr};
+    std::size_t actions_size{0};
+
+    // Decodes the action at the given offset into the actions and advances
+    // the offset past it. Returns false at the end of the actions.
+    bool next_action(std::size_t& offset, Replay_action& action) const;
+};
+
+// Encodes hunts into records. Call begin() after init_hunt(), then the action
+// functions for every action the game accepted, then end() once the hunt is
+// over. The records accumulate until cleared.
+class Replay_recorder
+{
+public:
+    void begin(std::uint64_t seed, const Hunt_state& state);
+    void move(int target);
+    void shoot(const std::array<int, arrow_range>& targets);
+    void quit();
+    void end(Game_state outcome);
+
+    const std::vector<std::uint8_t>& data() const;
+    void clear();
+
+private:
+    std::vector<std::uint8_t> hunt;
+    std::vector<std::uint8_t> records;
+};
+
+// Appends records to a log through a large buffer, writing the magic string
+// first if the log is new. Several threads may write to the same writer.
+class Replay_writer
+{
+public:
+    // Throws std::runtime_error if the file cannot be opened.
+    explicit Replay_writer(const std::string& path);
+    ~Replay_writer();
+
+    Replay_writer(const Replay_writer&) = delete;
+    Replay_writer& operator=(const Replay_writer&) = delete;
+
+    // Appends whole records, as produced by a Replay_recorder.
+    void write(const std::vector<std::uint8_t>& records);
+    // Throws std::runtime_error if the buffered records cannot be written.
+    void flush();
+
+private:
+    std::mutex mutex;
+    std::FILE* file;
+    std::vector<char> buffer;
+};
+
+// Reads the records of a log by mapping it into memory, so that reading a
+// record is a few loads with no copies.
+class Replay_reader
+{
+public:
+    // Throws std::runtime_error if the file cannot be mapped or is not a log.
+    explicit Replay_reader(const std::string& path);
+    ~Replay_reader();
+
+    Replay_reader(const Replay_reader&) = delete;
+    Replay_reader& operator=(const Replay_reader&) = delete;
+
+    // Reads the record at the given offset into the log and advances the
+    // offset past it. Returns false at the end of the log and throws
+    // std::runtime_error if the record is truncated or malformed.
+    bool next(std::size_t& offset, Replay_record& record) const;
+
+    // Returns the offset of the first record.
+    std::size_t begin() const;
+    std::size_t size() const;
+
+    // Splits the log into the given number of runs of whole records of about
+    // the same size, for reading in parallel. Returns the offsets that bound
+    // the runs, from begin() to size(). Only the record lengths are read.
+    std::vector<std::size_t> split(int parts) const;
+
+private:
+    const std::uint8_t* data{nullptr};
+    std::size_t data_size{0};
+#if defined(_WIN32)
+    void* file{nullptr};
+    void* mapping{nullptr};
+#endif
+
+    std::uint64_t record_length(std::size_t& offset) const;
+    void unmap();
+};
+
+// Plays the recorded hunt through the game and returns whether it unfolds as
+// recorded: the same starting layout, every action allowed and the same
+// outcome.
+template <typename Sink>
+bool replay(const Replay_record& record, Basic_game<Sink>& game)
+{
+    game.seed(record.seed);
+    game.init_hunt();
+    const Hazard_masks& hazards = game.get_hazard_masks();
+    if (hazards.player != record.hazards.player ||
+        hazards.wumpus != record.hazards.wumpus ||
+        hazards.bats != record.hazards.bats ||
+        hazards.pits != record.hazards.pits)
+    {
+        return false;
+    }
+
+    std::size_t offset = 0;
+    Replay_action action;
+    while (record.next_action(offset, action))
+    {
+        if (game.is_hunt_over())
+            return false;
+        switch (action.type)
+        {
+        case Replay_action::Type::move:
+            if (!game.can_move(action.targets[0]))
+                return false;
+            game.move(action.targets[0]);
+            break;
+        case Replay_action::Type::shoot:
+            if (!game.can_shoot(action.targets))
+                return false;
+            game.shoot(action.targets);
+            break;
+        case Replay_action::Type::quit:
+            game.quit();
+            break;
+        }
+    }
+    return game.get_game_state() == record.outcome;
+}
+}
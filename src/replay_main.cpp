@@ -0,0 +1,237 @@
+// Replays every hunt in replay logs through the game on all cores, checks
+// that each one unfolds as recorded and reports aggregates over the hunts.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game.h"
+#include "replay.h"
+#include "static_cave_game.h"
+
+using namespace wumpus;
+
+namespace {
+
+struct Options
+{
+    int threads{0};
+    std::vector<std::string> paths;
+};
+
+struct Results
+{
+    long long games{0};
+    long long actions{0};
+    long long mismatches{0};
+    // The offset of the first record that did not replay as recorded.
+    std::size_t first_mismatch{std::numeric_limits<std::size_t>::max()};
+    std::array<long long, num_game_states> outcomes{};
+    // Hunts and wins by the starting distance from the player to the wumpus.
+    std::array<long long, num_rooms> games_by_distance{};
+    std::array<long long, num_rooms> wins_by_distance{};
+
+    void add(const Results& other)
+    {
+        games += other.games;
+        actions += other.actions;
+        mismatches += other.mismatches;
+        first_mismatch = std::min(first_mismatch, other.first_mismatch);
+        for (int i = 0; i < num_game_states; ++i)
+            outcomes[i] += other.outcomes[i];
+        for (int i = 0; i < num_rooms; ++i)
+        {
+            games_by_distance[i] += other.games_by_distance[i];
+            wins_by_distance[i] += other.wins_by_distance[i];
+        }
+    }
+};
+
+// Replays the records in [first, last) of the log.
+Results verify(
+    const Replay_reader& reader,
+    std::size_t first,
+    std::size_t last)
+{
+    Null_event_sink sink;
+    Silent_game game{sink};
+    Replay_record record;
+    Replay_action action;
+
+    Results results;
+    std::size_t offset = first;
+    while (offset < last)
+    {
+        const std::size_t record_offset = offset;
+        reader.next(offset, record);
+        ++results.games;
+        for (std::size_t i = 0; record.next_action(i, action);)
+            ++results.actions;
+        if (!replay(record, game))
+        {
+            if (results.mismatches++ == 0)
+                results.first_mismatch = record_offset;
+        }
+        ++results.outcomes[static_cast<int>(record.outcome)];
+
+        const int distance =
+            Static_topology<Dodecahedron_topology>::tables
+                .distances[room_index(record.hazards.player)]
+                          [room_index(record.hazards.wumpus)];
+        ++results.games_by_distance[distance];
+        if (record.outcome == Game_state::wumpus_dead)
+            ++results.wins_by_distance[distance];
+    }
+    return results;
+}
+
+// Verifies a log on the given number of threads, each replaying a run of
+// records straight from the mapped file.
+Results verify(const std::string& path, int threads)
+{
+    Replay_reader reader{path};
+    const std::vector<std::size_t> bounds = reader.split(threads);
+
+    std::vector<Results> results(threads);
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&, i]() {
+            try
+            {
+                results[i] = verify(reader, bounds[i], bounds[i + 1]);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+    for (const std::exception_ptr& error : errors)
+        if (error)
+            std::rethrow_exception(error);
+
+    Results total;
+    for (const Results& result : results)
+        total.add(result);
+    if (total.mismatches > 0)
+    {
+        std::size_t offset = total.first_mismatch;
+        Replay_record record;
+        reader.next(offset, record);
+        std::cerr << path << ": first mismatch at offset "
+                  << total.first_mismatch << ", seed " << record.seed
+                  << std::endl;
+    }
+    return total;
+}
+
+double percent(long long part, long long whole)
+{
+    return 100.0 * part / std::max(whole, 1LL);
+}
+
+void print_usage()
+{
+    std::cerr << "Usage: wumpus_replay [--threads N] FILE..." << std::endl;
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--threads")
+        {
+            if (i + 1 >= argc)
+                throw std::invalid_argument("Missing value for " + arg);
+            options.threads = std::stoi(argv[++i]);
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+            throw std::invalid_argument("Unknown option: " + arg);
+        else
+            options.paths.push_back(arg);
+    }
+    if (options.paths.empty())
+        throw std::invalid_argument("No replay logs given");
+    if (options.threads <= 0)
+        options.threads =
+            std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    return options;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        options = parse_options(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    Results total;
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        for (const std::string& path : options.paths)
+            total.add(verify(path, options.threads));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << "threads: " << options.threads << std::endl
+              << "games: " << total.games << std::endl
+              << "mismatches: " << total.mismatches << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (int i = 1; i < num_game_states; ++i)
+    {
+        std::cout << game_state_name(static_cast<Game_state>(i)) << ": "
+                  << total.outcomes[i] << " ("
+                  << percent(total.outcomes[i], total.games) << "%)"
+                  << std::endl;
+    }
+    std::cout << "actions/game: "
+              << static_cast<double>(total.actions) /
+            std::max(total.games, 1LL)
+              << std::endl;
+    std::cout << "win rate by starting distance to the wumpus:" << std::endl;
+    for (int i = 0; i < num_rooms; ++i)
+    {
+        if (total.games_by_distance[i] == 0)
+            continue;
+        std::cout << "    " << i << ": "
+                  << percent(
+                         total.wins_by_distance[i], total.games_by_distance[i])
+                  << "% of " << total.games_by_distance[i] << std::endl;
+    }
+    std::cout << "elapsed: " << std::setprecision(3) << elapsed.count() << " s"
+              << std::endl
+              << "games/sec: " << std::setprecision(0)
+              << total.games / elapsed.count() << std::endl;
+    return total.mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1066 @@
+// Hosts many hunts at once for players and bots on a Unix domain socket, or
+// on stdin and stdout, with a line protocol. Each request is one line:
+//
+//   new [SEED]            starts a session with a new hunt
+//   ID m ROOM             moves to an adjacent room
+//   ID s ROOM [ROOM ROOM] shoots an arrow along up to three rooms
+//   ID q                  quits the hunt
+//   ID look               reports without acting
+//   ID close              ends the session
+//
+// and gets one reply line, in order for each connection:
+//
+//   ID STATE ROOM TUNNEL TUNNEL TUNNEL ARROWS PERCEPTS EVENTS
+//
+// STATE is a game state name such as none or wumpus_dead. PERCEPTS has a w,
+// b and p, or a -, for the wumpus, a bat and a pit next door. EVENTS lists the
+// bat_carried and wumpus_moved events the request caused, separated by
+// commas, or is -. A closed session replies "ID closed" and a failed request
+// "ID error MESSAGE", or "error MESSAGE" without a session.
+//
+// One thread runs the event loop over every connection, and a fixed pool of
+// workers plays the hunts. Each connection belongs to one worker, which owns
+// its sessions in a pool of preallocated games, so hunts need no locks and
+// replies keep their order. The loop hands each worker the lines read in one
+// pass as a batch and writes the replies back in as few writes as it can.
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "command.h"
+#include "events.h"
+#include "game.h"
+#include "game_pool.h"
+#include "latency.h"
+#include "random.h"
+#include "spsc_queue.h"
+#include "telemetry.h"
+
+using namespace wumpus;
+
+namespace {
+
+struct Options
+{
+    std::string socket_path;
+    bool stdio{false};
+    int threads{0};
+    int sessions{16384};
+    std::uint64_t seed{random_seed()};
+    // The file to write telemetry to every second, if any.
+    std::string metrics;
+};
+
+// The longest request line accepted. A connection sending a longer one is
+// dropped.
+const std::size_t max_line = 256;
+// A connection stops being read while this many of its requests are waiting
+// for replies.
+const int max_pending = 4096;
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void request_stop(int)
+{
+    stop_requested = 1;
+}
+
+std::system_error system_failure(const std::string& what)
+{
+    return std::system_error{errno, std::generic_category(), what};
+}
+
+// Records the events worth a reply. Percepts and outcomes are read from the
+// hunt itself.
+class Session_sink : public Event_sink
+{
+public:
+    bool bat_carried{false};
+    bool wumpus_moved{false};
+
+    void on_event(Event event) override
+    {
+        if (event == Event::bat_carried)
+            bat_carried = true;
+        else if (event == Event::wumpus_moved)
+            wumpus_moved = true;
+    }
+};
+
+// A line of a batch, as an offset into the batch's text.
+struct Line
+{
+    int connection;
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+// The requests read for one worker in one pass of the event loop, and then
+// its replies. Batches travel between the loop and the workers and keep their
+// storage, so steady traffic does not allocate.
+struct Batch
+{
+    std::chrono::steady_clock::time_point received;
+    std::string requests;
+    std::vector<Line> request_lines;
+    std::string replies;
+    std::vector<Line> reply_lines;
+    // Connections that went away after the requests above, whose sessions are
+    // to be ended.
+    std::vector<int> closed_connections;
+
+    bool empty() const
+    {
+        return request_lines.empty() && closed_connections.empty();
+    }
+
+    void clear()
+    {
+        requests.clear();
+        request_lines.clear();
+        replies.clear();
+        reply_lines.clear();
+        closed_connections.clear();
+    }
+};
+
+using Batch_queue = Spsc_queue<Batch*, 64>;
+
+void append_number(std::string& out, long long value)
+{
+    char digits[24];
+    char* end = digits + sizeof digits;
+    char* p = end;
+    const bool negative = value < 0;
+    unsigned long long rest =
+        negative ? 0ULL - static_cast<unsigned long long>(value) : value;
+    do
+    {
+        *--p = static_cast<char>('0' + rest % 10);
+        rest /= 10;
+    } while (rest);
+    if (negative)
+        *--p = '-';
+    out.append(p, end);
+}
+
+bool is_word(const char* word, int size, const char* expected)
+{
+    return std::strlen(expected) == static_cast<std::size_t>(size) &&
+        std::memcmp(word, expected, size) == 0;
+}
+
+// Plays the sessions of the connections assigned to it. Session ids spread
+// over the workers, so that the worker of a session is its id modulo the
+// number of workers.
+class Worker
+{
+public:
+    Batch_queue requests;
+    Batch_queue replies;
+
+    Worker(
+        int index,
+        int num_workers,
+        int capacity,
+        std::uint64_t seed,
+        int wake_fd)
+        : index{index},
+          num_workers{num_workers},
+          pool{capacity},
+          owners(capacity, -1),
+          next_slots(capacity, -1),
+          previous_slots(capacity, -1),
+          seed{seed},
+          wake_fd{wake_fd}
+    {
+    }
+
+    // Called by the event loop after pushing a batch.
+    void wake()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            has_work = true;
+        }
+        condition.notify_one();
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            is_stopping = true;
+        }
+        condition.notify_one();
+    }
+
+    int num_sessions() const
+    {
+        return sessions.load(std::memory_order_relaxed);
+    }
+
+    // The most sessions this worker has had open at once, counting those
+    // that opened and closed within one batch.
+    int peak_sessions() const
+    {
+        return session_peak.load(std::memory_order_relaxed);
+    }
+
+    void run()
+    {
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                condition.wait(
+                    lock, [this]() { return has_work || is_stopping; });
+                if (is_stopping)
+                    return;
+                has_work = false;
+            }
+            Batch* batch;
+            while (requests.pop(batch))
+            {
+                handle(*batch);
+                publish_telemetry();
+                // The loop keeps a batch per worker in flight at most, so
+                // the replies always fit.
+                replies.push(batch);
+                // This only fails if the count would overflow, in which case
+                // the loop is due to wake anyway.
+                const std::uint64_t one = 1;
+                const ssize_t result = write(wake_fd, &one, sizeof one);
+                static_cast<void>(result);
+            }
+        }
+    }
+
+private:
+    const int index;
+    const int num_workers;
+    Game_pool<Game, Session_sink> pool;
+    // The connection owning each slot, or -1.
+    std::vector<int> owners;
+    // The sessions of each connection, as a list threaded through the slots,
+    // so that a connection going away ends its sessions without a scan. The
+    // first slot of each connection, or -1, and the slots on either side of
+    // each slot in the list of its connection, or -1.
+    std::vector<int> first_slots;
+    std::vector<int> next_slots;
+    std::vector<int> previous_slots;
+    std::uint64_t seed;
+    std::uint64_t sessions_started{0};
+    std::atomic<int> sessions{0};
+    std::atomic<int> session_peak{0};
+    const int wake_fd;
+
+    std::chrono::steady_clock::time_point next_publish;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool has_work{false};
+    bool is_stopping{false};
+
+    // Lets the event loop see this worker's telemetry a few times a second.
+    void publish_telemetry()
+    {
+        if (!telemetry_enabled)
+            return;
+        const auto now = std::chrono::steady_clock::now();
+        if (now < next_publish)
+            return;
+        flush_telemetry();
+        next_publish = now + std::chrono::milliseconds{100};
+    }
+
+    void handle(Batch& batch)
+    {
+        for (const Line& line : batch.request_lines)
+        {
+            const std::size_t offset = batch.replies.size();
+            const char* text = batch.requests.data() + line.offset;
+            handle_request(
+                line.connection, text, text + line.length, batch.replies);
+            batch.replies += '\n';
+            batch.reply_lines.push_back(
+                {line.connection,
+                 static_cast<std::uint32_t>(offset),
+                 static_cast<std::uint32_t>(batch.replies.size() - offset)});
+        }
+        for (int connection : batch.closed_connections)
+            while (connection < static_cast<int>(first_slots.size()) &&
+                   first_slots[connection] >= 0)
+                end_session(first_slots[connection]);
+    }
+
+    void handle_request(
+        int connection, const char* begin, const char* end, std::string& out)
+    {
+        const char* word;
+        int size;
+        if (!next_word(begin, end, word, size))
+            return error(out, -1, "empty request");
+
+        std::uint64_t value;
+        if (is_word(word, size, "new"))
+        {
+            std::uint64_t session_seed =
+                seed + 2 * (sessions_started * num_workers + index);
+            if (next_word(begin, end, word, size) &&
+                !parse_number(word, size, session_seed))
+                return error(out, -1, "bad seed");
+            const int slot = pool.acquire(session_seed);
+            if (slot < 0)
+                return error(out, -1, "too many sessions");
+            ++sessions_started;
+            start_session(slot, connection);
+            pool.sink(slot) = Session_sink{};
+            return report(out, slot);
+        }
+        if (!parse_number(word, size, value))
+            return error(out, -1, "unknown request");
+        const long long id = static_cast<long long>(value);
+        const int slot = session_slot(value);
+        if (slot < 0 || owners[slot] != connection)
+            return error(out, id, "unknown session");
+
+        if (!next_word(begin, end, word, size))
+            return error(out, id, "missing action");
+        if (is_word(word, size, "close"))
+        {
+            end_session(slot);
+            append_number(out, id);
+            out += " closed";
+            return;
+        }
+        if (is_word(word, size, "look"))
+            return report(out, slot);
+
+        Command command;
+        if (!parse_command(word, end, command))
+            return error(out, id, "unknown command");
+        Game& game = pool.game(slot);
+        if (game.is_hunt_over())
+            return error(out, id, "hunt over");
+        pool.sink(slot) = Session_sink{};
+        if (!apply_command(game, command))
+            return error(out, id, "not allowed");
+        report(out, slot);
+    }
+
+    int session_slot(std::uint64_t id) const
+    {
+        if (id % num_workers != static_cast<std::uint64_t>(index))
+            return -1;
+        const std::uint64_t slot = id / num_workers;
+        return slot < static_cast<std::uint64_t>(pool.capacity()) &&
+                pool.in_use(static_cast<int>(slot))
+            ? static_cast<int>(slot)
+            : -1;
+    }
+
+    void start_session(int slot, int connection)
+    {
+        owners[slot] = connection;
+        // Connection ids are reused, so this grows only with the most
+        // connections open at once.
+        if (connection >= static_cast<int>(first_slots.size()))
+            first_slots.resize(connection + 1, -1);
+        const int next = first_slots[connection];
+        next_slots[slot] = next;
+        previous_slots[slot] = -1;
+        if (next >= 0)
+            previous_slots[next] = slot;
+        first_slots[connection] = slot;
+        // Only this thread writes either count.
+        const int open = sessions.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (open > session_peak.load(std::memory_order_relaxed))
+            session_peak.store(open, std::memory_order_relaxed);
+    }
+
+    void end_session(int slot)
+    {
+        const int next = next_slots[slot];
+        const int previous = previous_slots[slot];
+        if (previous >= 0)
+            next_slots[previous] = next;
+        else
+            first_slots[owners[slot]] = next;
+        if (next >= 0)
+            previous_slots[next] = previous;
+        owners[slot] = -1;
+        pool.release(slot);
+        sessions.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void report(std::string& out, int slot)
+    {
+        const Game& game = pool.game(slot);
+        const Hunt_state& hunt = game.get_state();
+        const int room = hunt.player_room();
+        append_number(out, static_cast<long long>(slot) * num_workers + index);
+        out += ' ';
+        out += game_state_name(hunt.state);
+        out += ' ';
+        append_number(out, hunt.numbers[room]);
+        for (int adjacent : room_connections[room])
+        {
+            out += ' ';
+            append_number(out, hunt.numbers[adjacent]);
+        }
+        out += ' ';
+        append_number(out, hunt.arrows);
+        const Percepts percepts = hunt.hazards.percepts();
+        out += ' ';
+        out += percepts.wumpus ? 'w' : '-';
+        out += percepts.bat ? 'b' : '-';
+        out += percepts.pit ? 'p' : '-';
+        const Session_sink& sink = pool.sink(slot);
+        if (sink.bat_carried && sink.wumpus_moved)
+            out += " bat_carried,wumpus_moved";
+        else if (sink.bat_carried)
+            out += " bat_carried";
+        else if (sink.wumpus_moved)
+            out += " wumpus_moved";
+        else
+            out += " -";
+    }
+
+    static void error(std::string& out, long long id, const char* message)
+    {
+        if (id >= 0)
+        {
+            append_number(out, id);
+            out += ' ';
+        }
+        out += "error ";
+        out += message;
+    }
+};
+
+struct Connection
+{
+    int in_fd{-1};
+    int out_fd{-1};
+    int worker{0};
+    std::string input;
+    std::string output;
+    std::size_t written{0};
+    // Requests sent to the worker and not yet replied to.
+    int pending{0};
+    bool is_reading{true};
+    bool is_closing{false};
+    bool is_waiting_to_write{false};
+    // Whether the worker has ended the sessions of a closing connection.
+    bool is_released{false};
+    // Regular files cannot be watched, and are read whenever the loop runs.
+    bool is_always_readable{false};
+};
+
+// The event loop. It reads and writes every connection without blocking,
+// except stdout, and is the only thread touching connections.
+class Server
+{
+public:
+    explicit Server(const Options& options) : options{options}
+    {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0)
+            throw system_failure("epoll_create1");
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd < 0)
+            throw system_failure("eventfd");
+        watch(wake_fd, wake_key, EPOLLIN);
+
+        const int num_workers = options.threads;
+        const int capacity = (options.sessions + num_workers - 1) / num_workers;
+        for (int i = 0; i < num_workers; ++i)
+        {
+            workers.push_back(std::make_unique<Worker>(
+                i, num_workers, capacity, options.seed, wake_fd));
+            free_batches.push_back(std::make_unique<Batch>());
+        }
+        in_flight.assign(num_workers, 0);
+        building.assign(num_workers, nullptr);
+    }
+
+    ~Server()
+    {
+        for (std::unique_ptr<Worker>& worker : workers)
+            worker->stop();
+        for (std::thread& thread : threads)
+            thread.join();
+        for (std::unique_ptr<Connection>& connection : connections)
+            if (connection)
+                close_fds(*connection);
+        if (listen_fd >= 0)
+        {
+            close(listen_fd);
+            unlink(options.socket_path.c_str());
+        }
+        close(wake_fd);
+        close(epoll_fd);
+    }
+
+    void run()
+    {
+        for (std::unique_ptr<Worker>& worker : workers)
+            threads.emplace_back([&worker]() { worker->run(); });
+        if (options.stdio)
+            open_stdio();
+        else
+            listen_on(options.socket_path);
+
+        std::vector<epoll_event> events(1024);
+        while (!stop_requested)
+        {
+            if (options.stdio && open_connections == 0)
+                break;
+            const int timeout = has_always_readable() ? 0 : 250;
+            const int count = epoll_wait(
+                epoll_fd,
+                events.data(),
+                static_cast<int>(events.size()),
+                timeout);
+            if (count < 0 && errno != EINTR)
+                throw system_failure("epoll_wait");
+            for (int i = 0; i < count; ++i)
+                handle_event(events[i]);
+            for (std::size_t id = 0; id < connections.size(); ++id)
+                if (connections[id] && connections[id]->is_always_readable)
+                    read_from(static_cast<int>(id));
+            dispatch();
+            collect();
+            if (!options.metrics.empty() &&
+                std::chrono::steady_clock::now() >= next_metrics)
+            {
+                write_prometheus(options.metrics, telemetry_snapshot());
+                next_metrics =
+                    std::chrono::steady_clock::now() + std::chrono::seconds{1};
+            }
+        }
+    }
+
+    void print_stats(std::ostream& out) const
+    {
+        // Sessions can open and close between two samples, so the peak of a
+        // single worker may be higher.
+        int peak = peak_sessions;
+        for (const std::unique_ptr<Worker>& worker : workers)
+            peak = std::max(peak, worker->peak_sessions());
+        out << "connections: " << connections_accepted << std::endl
+            << "peak_sessions: " << peak << std::endl
+            << "requests: " << latency.count() << std::endl
+            << std::fixed << std::setprecision(1)
+            << "p50_us: " << latency.quantile(0.5) / 1e3 << std::endl
+            << "p99_us: " << latency.quantile(0.99) / 1e3 << std::endl;
+    }
+
+private:
+    static const std::uint64_t listen_key = ~std::uint64_t{0};
+    static const std::uint64_t wake_key = ~std::uint64_t{0} - 1;
+
+    const Options& options;
+    int epoll_fd{-1};
+    int listen_fd{-1};
+    int wake_fd{-1};
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::vector<int> free_ids;
+    int next_worker{0};
+    int open_connections{0};
+
+    std::vector<std::unique_ptr<Batch>> free_batches;
+    // The batch filling up for each worker, and whether one is with it.
+    std::vector<Batch*> building;
+    std::vector<int> in_flight;
+
+    Latency_histogram latency;
+    std::chrono::steady_clock::time_point next_metrics;
+    long long connections_accepted{0};
+    // The most sessions open at once over all workers when sampled.
+    int peak_sessions{0};
+    // Whether accepting is paused until a connection frees its descriptor.
+    bool is_accept_paused{false};
+
+    void watch(int fd, std::uint64_t key, std::uint32_t events)
+    {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = key;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+            throw system_failure("epoll_ctl");
+    }
+
+    void rewatch(int id)
+    {
+        Connection& connection = *connections[id];
+        epoll_event event{};
+        event.events =
+            (connection.is_reading ? std::uint32_t{EPOLLIN} : 0u) |
+            (connection.is_waiting_to_write ? std::uint32_t{EPOLLOUT} : 0u);
+        event.data.u64 = static_cast<std::uint64_t>(id);
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.in_fd, &event);
+    }
+
+    bool has_always_readable() const
+    {
+        for (const std::unique_ptr<Connection>& connection : connections)
+            if (connection && connection->is_always_readable &&
+                connection->is_reading)
+                return true;
+        return false;
+    }
+
+    void listen_on(const std::string& path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof address.sun_path)
+            throw std::invalid_argument("Socket path too long: " + path);
+        std::strcpy(address.sun_path, path.c_str());
+        listen_fd =
+            socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0)
+            throw system_failure("socket");
+        unlink(path.c_str());
+        const sockaddr* name = reinterpret_cast<sockaddr*>(&address);
+        if (bind(listen_fd, name, sizeof address) < 0 ||
+            listen(listen_fd, SOMAXCONN) < 0)
+            throw system_failure("Cannot listen on " + path);
+        watch(listen_fd, listen_key, EPOLLIN);
+    }
+
+    void open_stdio()
+    {
+        const int id = add_connection(STDIN_FILENO, STDOUT_FILENO);
+        Connection& connection = *connections[id];
+        fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = static_cast<std::uint64_t>(id);
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &event) < 0)
+        {
+            if (errno != EPERM)
+                throw system_failure("epoll_ctl");
+            connection.is_always_readable = true;
+        }
+    }
+
+    int add_connection(int in_fd, int out_fd)
+    {
+        int id;
+        if (free_ids.empty())
+        {
+            id = static_cast<int>(connections.size());
+            connections.emplace_back();
+        }
+        else
+        {
+            id = free_ids.back();
+            free_ids.pop_back();
+        }
+        connections[id] = std::make_unique<Connection>();
+        Connection& connection = *connections[id];
+        connection.in_fd = in_fd;
+        connection.out_fd = out_fd;
+        connection.worker = next_worker;
+        next_worker = (next_worker + 1) % static_cast<int>(workers.size());
+        ++connections_accepted;
+        ++open_connections;
+        return id;
+    }
+
+    void accept_all()
+    {
+        while (true)
+        {
+            const int fd = accept4(
+                listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                // The listening socket stays readable, so it is not watched
+                // until a connection closes and frees a descriptor.
+                if (errno == EMFILE || errno == ENFILE)
+                    pause_accepting();
+                return;
+            }
+            const int id = add_connection(fd, fd);
+            watch(fd, static_cast<std::uint64_t>(id), EPOLLIN);
+        }
+    }
+
+    void pause_accepting()
+    {
+        std::cerr << "Out of file descriptors" << std::endl;
+        epoll_event event{};
+        event.data.u64 = listen_key;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, listen_fd, &event);
+        is_accept_paused = true;
+    }
+
+    void resume_accepting()
+    {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = listen_key;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, listen_fd, &event);
+        is_accept_paused = false;
+    }
+
+    void handle_event(const epoll_event& event)
+    {
+        if (event.data.u64 == listen_key)
+            return accept_all();
+        if (event.data.u64 == wake_key)
+        {
+            std::uint64_t count;
+            while (read(wake_fd, &count, sizeof count) > 0)
+            {
+            }
+            return;
+        }
+        const int id = static_cast<int>(event.data.u64);
+        if (!connections[id])
+            return;
+        if (event.events & EPOLLOUT)
+            flush(id);
+        if (connections[id] && (event.events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+            read_from(id);
+    }
+
+    Batch& batch_for(int worker)
+    {
+        if (!building[worker])
+        {
+            if (free_batches.empty())
+                free_batches.push_back(std::make_unique<Batch>());
+            building[worker] = free_batches.back().release();
+            free_batches.pop_back();
+            building[worker]->received = std::chrono::steady_clock::now();
+        }
+        return *building[worker];
+    }
+
+    // Reads what the connection has sent and queues its whole lines for its
+    // worker.
+    void read_from(int id)
+    {
+        Connection& connection = *connections[id];
+        if (!connection.is_reading)
+            return;
+        char buffer[65536];
+        bool is_ended = false;
+        while (connection.pending < max_pending)
+        {
+            const ssize_t size = read(connection.in_fd, buffer, sizeof buffer);
+            if (size < 0 && errno == EINTR)
+                continue;
+            if (size < 0 && errno == EAGAIN)
+                break;
+            if (size <= 0)
+            {
+                is_ended = true;
+                break;
+            }
+            connection.input.append(buffer, static_cast<std::size_t>(size));
+            if (!split_lines(id) || size < static_cast<ssize_t>(sizeof buffer))
+                break;
+        }
+        if (is_ended || connection.input.size() > max_line)
+        {
+            // A last line without a newline still counts.
+            if (!connection.input.empty() &&
+                connection.input.size() <= max_line)
+            {
+                connection.input += '\n';
+                split_lines(id);
+            }
+            return end_input(id);
+        }
+        if (connection.pending >= max_pending)
+        {
+            connection.is_reading = false;
+            if (!connection.is_always_readable)
+                rewatch(id);
+        }
+    }
+
+    // Returns false if a line was too long.
+    bool split_lines(int id)
+    {
+        Connection& connection = *connections[id];
+        Batch& batch = batch_for(connection.worker);
+        std::size_t start = 0;
+        while (true)
+        {
+            const std::size_t newline = connection.input.find('\n', start);
+            if (newline == std::string::npos)
+                break;
+            const std::size_t length = newline - start;
+            if (length > max_line)
+                return false;
+            batch.request_lines.push_back(
+                {id,
+                 static_cast<std::uint32_t>(batch.requests.size()),
+                 static_cast<std::uint32_t>(length)});
+            batch.requests.append(connection.input, start, length);
+            ++connection.pending;
+            start = newline + 1;
+        }
+        connection.input.erase(0, start);
+        return true;
+    }
+
+    // Stops reading the connection and asks its worker to end its sessions
+    // after its last requests. The connection goes once they are answered.
+    void end_input(int id)
+    {
+        Connection& connection = *connections[id];
+        connection.input.clear();
+        connection.is_reading = false;
+        connection.is_closing = true;
+        connection.is_always_readable = false;
+        if (connection.in_fd != STDIN_FILENO)
+            shutdown(connection.in_fd, SHUT_RD);
+        rewatch(id);
+        batch_for(connection.worker).closed_connections.push_back(id);
+        finish(id);
+    }
+
+    // Closes the connection once nothing more is coming for it.
+    void finish(int id)
+    {
+        Connection& connection = *connections[id];
+        if (!connection.is_closing || !connection.is_released ||
+            connection.pending > 0 ||
+            connection.written < connection.output.size())
+            return;
+        close_fds(connection);
+        connections[id].reset();
+        free_ids.push_back(id);
+        --open_connections;
+        if (is_accept_paused)
+            resume_accepting();
+    }
+
+    void close_fds(Connection& connection)
+    {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection.in_fd, nullptr);
+        if (connection.in_fd != STDIN_FILENO)
+            close(connection.in_fd);
+    }
+
+    void dispatch()
+    {
+        for (std::size_t worker = 0; worker < workers.size(); ++worker)
+        {
+            Batch* batch = building[worker];
+            if (!batch || batch->empty() || in_flight[worker])
+                continue;
+            workers[worker]->requests.push(batch);
+            workers[worker]->wake();
+            building[worker] = nullptr;
+            in_flight[worker] = 1;
+        }
+    }
+
+    // Hands the replies of finished batches to their connections and writes
+    // them out.
+    void collect()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        for (std::size_t worker = 0; worker < workers.size(); ++worker)
+        {
+            Batch* batch;
+            if (!workers[worker]->replies.pop(batch))
+                continue;
+            in_flight[worker] = 0;
+            const std::uint64_t nanoseconds =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    now - batch->received)
+                    .count();
+            for (const Line& line : batch->reply_lines)
+            {
+                latency.record(nanoseconds);
+                Connection* connection = connections[line.connection].get();
+                if (!connection)
+                    continue;
+                connection->output.append(
+                    batch->replies, line.offset, line.length);
+                --connection->pending;
+            }
+            for (const Line& line : batch->reply_lines)
+                if (connections[line.connection])
+                    flush(line.connection);
+            for (int id : batch->closed_connections)
+            {
+                connections[id]->is_released = true;
+                finish(id);
+            }
+            batch->clear();
+            free_batches.emplace_back(batch);
+        }
+
+        int sessions = 0;
+        for (const std::unique_ptr<Worker>& worker : workers)
+            sessions += worker->num_sessions();
+        peak_sessions = std::max(peak_sessions, sessions);
+        dispatch();
+    }
+
+    void flush(int id)
+    {
+        Connection& connection = *connections[id];
+        while (connection.written < connection.output.size())
+        {
+            const ssize_t size = write(
+                connection.out_fd,
+                connection.output.data() + connection.written,
+                connection.output.size() - connection.written);
+            if (size < 0 && errno == EINTR)
+                continue;
+            if (size < 0 && errno == EAGAIN)
+                break;
+            if (size < 0)
+            {
+                // The peer is gone, so its replies are dropped.
+                connection.written = connection.output.size();
+                if (!connection.is_closing)
+                    end_input(id);
+                break;
+            }
+            connection.written += static_cast<std::size_t>(size);
+        }
+        if (!connections[id])
+            return;
+        if (connection.written == connection.output.size())
+        {
+            connection.output.clear();
+            connection.written = 0;
+        }
+        // Reading resumes once half the requests held back are answered.
+        const bool is_waiting = !connection.output.empty();
+        const bool can_read = connection.is_reading ||
+            (!connection.is_closing && connection.pending < max_pending / 2);
+        if (is_waiting != connection.is_waiting_to_write ||
+            can_read != connection.is_reading)
+        {
+            connection.is_waiting_to_write = is_waiting;
+            connection.is_reading = can_read;
+            if (!connection.is_always_readable)
+                rewatch(id);
+        }
+        finish(id);
+    }
+};
+
+void print_usage()
+{
+    std::cerr << "Usage: wumpus_server (--socket PATH | --stdio) [--threads N] "
+                 "[--sessions N]\n"
+                 "                     [--seed N] [--metrics FILE]"
+              << std::endl;
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--stdio")
+        {
+            options.stdio = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--socket")
+            options.socket_path = value;
+        else if (arg == "--threads")
+            options.threads = std::stoi(value);
+        else if (arg == "--sessions")
+            options.sessions = std::stoi(value);
+        else if (arg == "--seed")
+            options.seed = std::stoull(value);
+        else if (arg == "--metrics")
+            options.metrics = value;
+        else
+            throw std::invalid_argument("Unknown option: " + arg);
+    }
+    if (!options.metrics.empty() && !telemetry_enabled)
+        throw std::invalid_argument("Built without WUMPUS_TELEMETRY");
+    if (options.stdio == !options.socket_path.empty())
+        throw std::invalid_argument("Choose one of --socket and --stdio");
+    if (options.threads <= 0)
+        options.threads =
+            std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (options.sessions < 1)
+        throw std::invalid_argument("No room for sessions");
+    return options;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        options = parse_options(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+    try
+    {
+        {
+            Server server{options};
+            server.run();
+            server.print_stats(std::cerr);
+        }
+        // The workers have exited and handed over their counts by now.
+        if (!options.metrics.empty())
+            write_prometheus(options.metrics, telemetry_snapshot());
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
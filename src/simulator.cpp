@@ -0,0 +1,633 @@
+// Headless batch simulator: plays many hunts with a scripted policy across all
+// cores and reports the outcome counts and the throughput.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cave.h"
+#include "cave_engine.h"
+#include "cave_game.h"
+#include "game.h"
+#include "hunt_lanes.h"
+#include "random.h"
+#include "replay.h"
+#include "telemetry.h"
+
+using namespace wumpus;
+
+namespace {
+
+struct Sim_action
+{
+    enum class Type
+    {
+        move,
+        shoot,
+        quit
+    } type;
+    std::array<int, arrow_range> targets;
+};
+
+// What a policy sees of a hunt in some other cave than the original.
+struct Cave_view
+{
+    const Cave& cave;
+    int player_room;
+    int arrows;
+};
+
+class Policy
+{
+public:
+    virtual ~Policy() = default;
+
+    // Chooses the next action. The targets are room numbers, as displayed to
+    // the player.
+    virtual Sim_action next_action(
+        const Hunt_state& hunt, const Percepts& percepts, Rng& rng) = 0;
+    // Chooses the next action in a hunt through some other cave. The targets
+    // are room indices.
+    virtual Sim_action next_cave_action(
+        const Cave_view& view, const Percepts& percepts, Rng& rng) = 0;
+    // Chooses the next action of every lane in the mask, drawing from the
+    // lane generators exactly as next_cave_action() would from an Rng. Only
+    // path[0] is written; the rest of each path is left at -1.
+    virtual void next_lane_actions(
+        Lane_kernel kernel,
+        const Hunt_lanes& lanes,
+        std::uint32_t mask,
+        const std::int32_t* percepts,
+        Lane_rngs& rngs,
+        Lane_actions& actions) = 0;
+};
+
+int random_adjacent_room(const Hunt_state& hunt, Rng& rng)
+{
+    const auto& adjacent_rooms = room_connections[hunt.player_room()];
+    return hunt.numbers[adjacent_rooms[rng.uniform(0, connections_per_room)]];
+}
+
+int random_adjacent_room(const Cave_view& view, Rng& rng)
+{
+    const Cave::Adjacent_rooms adjacent_rooms =
+        view.cave.adjacent_rooms(view.player_room);
+    return adjacent_rooms[rng.uniform(0, adjacent_rooms.size())];
+}
+
+// Quits on the first turn. Measures the cost of setting up a hunt.
+class Quitter : public Policy
+{
+public:
+    Sim_action next_action(const Hunt_state&, const Percepts&, Rng&) override
+    {
+        return {Sim_action::Type::quit, {{-1, -1, -1}}};
+    }
+
+    Sim_action next_cave_action(
+        const Cave_view&, const Percepts&, Rng&) override
+    {
+        return {Sim_action::Type::quit, {{-1, -1, -1}}};
+    }
+
+    void next_lane_actions(
+        Lane_kernel,
+        const Hunt_lanes&,
+        std::uint32_t mask,
+        const std::int32_t*,
+        Lane_rngs&,
+        Lane_actions& actions) override
+    {
+        for (int lane = 0; lane < num_lanes; ++lane)
+            if (mask & 1u << lane)
+                actions.type[lane] = Lane_action::quit;
+    }
+};
+
+// Wanders the cave at random and never shoots.
+class Walker : public Policy
+{
+public:
+    Sim_action next_action(
+        const Hunt_state& hunt, const Percepts&, Rng& rng) override
+    {
+        int target = random_adjacent_room(hunt, rng);
+        return {Sim_action::Type::move, {{target, -1, -1}}};
+    }
+
+    Sim_action next_cave_action(
+        const Cave_view& view, const Percepts&, Rng& rng) override
+    {
+        int target = random_adjacent_room(view, rng);
+        return {Sim_action::Type::move, {{target, -1, -1}}};
+    }
+
+    void next_lane_actions(
+        Lane_kernel kernel,
+        const Hunt_lanes& lanes,
+        std::uint32_t mask,
+        const std::int32_t*,
+        Lane_rngs& rngs,
+        Lane_actions& actions) override
+    {
+        random_adjacent_rooms(
+            kernel, rngs, mask, lanes.player_room, actions.path[0]);
+        for (int lane = 0; lane < num_lanes; ++lane)
+            if (mask & 1u << lane)
+                actions.type[lane] = Lane_action::move;
+    }
+};
+
+// Wanders the cave at random and shoots into a random adjacent room whenever
+// it smells the wumpus.
+class Hunter : public Policy
+{
+public:
+    Sim_action next_action(
+        const Hunt_state& hunt, const Percepts& percepts, Rng& rng) override
+    {
+        int target = random_adjacent_room(hunt, rng);
+        if (percepts.wumpus && hunt.arrows > 0)
+            return {Sim_action::Type::shoot, {{target, -1, -1}}};
+        return {Sim_action::Type::move, {{target, -1, -1}}};
+    }
+
+    Sim_action next_cave_action(
+        const Cave_view& view, const Percepts& percepts, Rng& rng) override
+    {
+        int target = random_adjacent_room(view, rng);
+        if (percepts.wumpus && view.arrows > 0)
+            return {Sim_action::Type::shoot, {{target, -1, -1}}};
+        return {Sim_action::Type::move, {{target, -1, -1}}};
+    }
+
+    void next_lane_actions(
+        Lane_kernel kernel,
+        const Hunt_lanes& lanes,
+        std::uint32_t mask,
+        const std::int32_t* percepts,
+        Lane_rngs& rngs,
+        Lane_actions& actions) override
+    {
+        random_adjacent_rooms(
+            kernel, rngs, mask, lanes.player_room, actions.path[0]);
+        for (int lane = 0; lane < num_lanes; ++lane)
+        {
+            if (!(mask & 1u << lane))
+                continue;
+            const bool shoot =
+                (percepts[lane] & wumpus_percept) && lanes.arrows[lane] > 0;
+            actions.type[lane] = shoot ? Lane_action::shoot : Lane_action::move;
+        }
+    }
+};
+
+std::unique_ptr<Policy> make_policy(const std::string& name)
+{
+    if (name == "quitter")
+        return std::make_unique<Quitter>();
+    if (name == "walker")
+        return std::make_unique<Walker>();
+    if (name == "hunter")
+        return std::make_unique<Hunter>();
+    throw std::invalid_argument("Unknown policy: " + name);
+}
+
+// Builds the cave named by a specification: dodecahedron, random:N (three
+// tunnels per room), grid:WxH, torus:WxH or file:PATH.
+Cave make_cave(const std::string& spec, std::uint64_t seed)
+{
+    const std::size_t colon = spec.find(':');
+    const std::string kind = spec.substr(0, colon);
+    const std::string value =
+        colon == std::string::npos ? "" : spec.substr(colon + 1);
+    auto dimensions = [&spec, &value]() {
+        const std::size_t x = value.find('x');
+        if (x == std::string::npos)
+            throw std::invalid_argument("Expected WxH in " + spec);
+        return std::make_pair(
+            std::stoi(value.substr(0, x)), std::stoi(value.substr(x + 1)));
+    };
+
+    if (spec == "dodecahedron")
+        return Cave::dodecahedron();
+    if (kind == "random" && !value.empty())
+    {
+        Rng rng{seed};
+        return Cave::random_regular(std::stoi(value), 3, rng);
+    }
+    if (kind == "grid")
+        return Cave::grid(dimensions().first, dimensions().second);
+    if (kind == "torus")
+        return Cave::torus(dimensions().first, dimensions().second);
+    if (kind == "file" && !value.empty())
+    {
+        std::ifstream in{value};
+        if (!in)
+            throw std::runtime_error("Cannot open " + value);
+        return Cave::read_edges(in);
+    }
+    throw std::invalid_argument("Unknown cave: " + spec);
+}
+
+struct Options
+{
+    long long games{1000000};
+    int threads{0};
+    int max_turns{1000};
+    std::uint64_t seed{random_seed()};
+    std::string policy{"hunter"};
+    // The cave to hunt in, if not the original one.
+    std::string cave;
+    // auto picks a specialized engine for the cave if there is one, generic
+    // never does, and lanes plays eight hunts of the original cave at once.
+    std::string engine{"auto"};
+    // The replay log to append every hunt to, if any.
+    std::string record;
+    // The file to write telemetry to, if any.
+    std::string metrics;
+};
+
+struct Results
+{
+    std::array<long long, num_game_states> outcomes{};
+    long long turns{0};
+};
+
+// Plays the hunts numbered [first, last), quitting any hunt that runs past the
+// turn limit. Every hunt is seeded from its number, so the results do not
+// depend on how the hunts are split between threads. If a writer is given,
+// the hunts are recorded to it in large batches.
+Results play(
+    const Options& options,
+    long long first,
+    long long last,
+    Replay_writer* writer)
+{
+    const std::size_t batch_size = 1 << 16;
+
+    Null_event_sink sink;
+    Silent_game game{sink};
+    Rng policy_rng;
+    auto policy = make_policy(options.policy);
+    Replay_recorder recorder;
+
+    Results results;
+    for (long long i = first; i < last; ++i)
+    {
+        const std::uint64_t seed = options.seed + 2 * i;
+        game.seed(seed);
+        policy_rng.seed(seed + 1);
+        game.init_hunt();
+        if (writer)
+            recorder.begin(seed, game.get_state());
+        for (int turn = 0; !game.is_hunt_over(); ++turn)
+        {
+            Sim_action action = turn < options.max_turns
+                ? policy->next_action(
+                      game.get_state(), game.get_percepts(), policy_rng)
+                : Sim_action{Sim_action::Type::quit, {{-1, -1, -1}}};
+            switch (action.type)
+            {
+            case Sim_action::Type::move:
+                if (!game.can_move(action.targets[0]))
+                    break;
+                game.move(action.targets[0]);
+                if (writer)
+                    recorder.move(action.targets[0]);
+                break;
+            case Sim_action::Type::shoot:
+                if (!game.can_shoot(action.targets))
+                    break;
+                game.shoot(action.targets);
+                if (writer)
+                    recorder.shoot(action.targets);
+                break;
+            case Sim_action::Type::quit:
+                game.quit();
+                if (writer)
+                    recorder.quit();
+                break;
+            }
+            ++results.turns;
+        }
+        ++results.outcomes[static_cast<int>(game.get_game_state())];
+        if (writer)
+        {
+            recorder.end(game.get_game_state());
+            if (recorder.data().size() >= batch_size)
+            {
+                writer->write(recorder.data());
+                recorder.clear();
+            }
+        }
+    }
+    if (writer)
+        writer->write(recorder.data());
+    return results;
+}
+
+// Plays the hunts numbered [first, last) like play(), through the given cave
+// with the given engine.
+Results play_cave(
+    const Options& options,
+    const Cave& cave,
+    Cave_engine engine,
+    long long first,
+    long long last)
+{
+    Null_event_sink sink;
+    Rng policy_rng;
+    auto policy = make_policy(options.policy);
+
+    Results results;
+    with_cave_game(engine, cave, Cave_rules{}, sink, 0, [&](auto& game) {
+        for (long long i = first; i < last; ++i)
+        {
+            const std::uint64_t seed = options.seed + 2 * i;
+            game.seed(seed);
+            policy_rng.seed(seed + 1);
+            game.init_hunt();
+            for (int turn = 0; !game.is_hunt_over(); ++turn)
+            {
+                const Cave_view view{
+                    cave, game.get_player_room(), game.get_arrows()};
+                Sim_action action = turn < options.max_turns
+                    ? policy->next_cave_action(
+                          view, game.get_percepts(), policy_rng)
+                    : Sim_action{Sim_action::Type::quit, {{-1, -1, -1}}};
+                switch (action.type)
+                {
+                case Sim_action::Type::move:
+                    if (game.can_move(action.targets[0]))
+                        game.move(action.targets[0]);
+                    break;
+                case Sim_action::Type::shoot:
+                    if (game.can_shoot(action.targets))
+                        game.shoot(action.targets);
+                    break;
+                case Sim_action::Type::quit:
+                    game.quit();
+                    break;
+                }
+                ++results.turns;
+            }
+            ++results.outcomes[static_cast<int>(game.get_game_state())];
+        }
+    });
+    return results;
+}
+
+// Plays the hunts numbered [first, last) like play_cave() through the original
+// cave, eight at a time in the lanes of a Hunt_lanes. A lane whose hunt ends
+// starts the next one, and the policy chooses each lane's action as before.
+Results play_lanes(const Options& options, long long first, long long last)
+{
+    const Lane_kernel kernel = best_lane_kernel();
+    auto policy = make_policy(options.policy);
+    Hunt_lanes lanes{};
+    Lane_actions actions{};
+    Lane_rngs policy_rngs{};
+    std::array<int, num_lanes> turns{};
+    std::int32_t percepts[num_lanes];
+    for (std::int32_t& state : lanes.state)
+        state = static_cast<std::int32_t>(Game_state::player_quit);
+    for (auto& path : actions.path)
+        std::fill(std::begin(path), std::end(path), -1);
+
+    Results results;
+    long long next_hunt = first;
+    std::uint32_t running = 0;
+    while (true)
+    {
+        std::uint32_t starting = 0;
+        for (int lane = 0; lane < num_lanes && next_hunt < last; ++lane)
+        {
+            if (running & 1u << lane)
+                continue;
+            const std::uint64_t seed = options.seed + 2 * next_hunt++;
+            seed_lane(lanes.rngs, lane, seed);
+            seed_lane(policy_rngs, lane, seed + 1);
+            turns[lane] = 0;
+            starting |= 1u << lane;
+        }
+        init_hunts(kernel, lanes, starting);
+        running |= starting;
+        if (!running)
+            break;
+
+        // Lanes out of turns quit; the policy chooses for the others.
+        std::uint32_t choosing = 0;
+        for (int lane = 0; lane < num_lanes; ++lane)
+        {
+            actions.type[lane] = Lane_action::none;
+            if (!(running & 1u << lane))
+                continue;
+            if (turns[lane]++ < options.max_turns)
+                choosing |= 1u << lane;
+            else
+                actions.type[lane] = Lane_action::quit;
+            ++results.turns;
+        }
+        get_percepts(kernel, lanes, percepts);
+        policy->next_lane_actions(
+            kernel, lanes, choosing, percepts, policy_rngs, actions);
+        step(kernel, lanes, actions);
+
+        for (int lane = 0; lane < num_lanes; ++lane)
+        {
+            const int state = lanes.state[lane];
+            if ((running & 1u << lane) &&
+                state != static_cast<int>(Game_state::none))
+            {
+                ++results.outcomes[state];
+                running &= ~(1u << lane);
+            }
+        }
+    }
+    return results;
+}
+
+void print_usage()
+{
+    std::cerr << "Usage: wumpus_simulator [--games N] [--threads N] "
+                 "[--max-turns N] [--seed N]\n"
+                 "                        [--policy quitter|walker|hunter] "
+                 "[--record FILE]\n"
+                 "                        [--metrics FILE]\n"
+                 "                        [--cave dodecahedron|random:N|"
+                 "grid:WxH|torus:WxH|file:PATH]\n"
+                 "                        [--engine auto|generic|lanes]"
+              << std::endl;
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+            throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--games")
+            options.games = std::stoll(value);
+        else if (arg == "--threads")
+            options.threads = std::stoi(value);
+        else if (arg == "--max-turns")
+            options.max_turns = std::stoi(value);
+        else if (arg == "--seed")
+            options.seed = std::stoull(value);
+        else if (arg == "--policy")
+            options.policy = value;
+        else if (arg == "--record")
+            options.record = value;
+        else if (arg == "--cave")
+            options.cave = value;
+        else if (arg == "--engine")
+            options.engine = value;
+        else if (arg == "--metrics")
+            options.metrics = value;
+        else
+            throw std::invalid_argument("Unknown option: " + arg);
+    }
+    if (options.threads <= 0)
+        options.threads =
+            std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (options.engine != "auto" && options.engine != "generic" &&
+        options.engine != "lanes")
+    {
+        throw std::invalid_argument("Unknown engine: " + options.engine);
+    }
+    if (options.engine == "lanes" && options.cave.empty())
+        options.cave = "dodecahedron";
+    if (!options.cave.empty() && !options.record.empty())
+        throw std::invalid_argument("Only the original cave can be recorded");
+    if (!options.metrics.empty() && !telemetry_enabled)
+        throw std::invalid_argument("Built without WUMPUS_TELEMETRY");
+    if (!options.metrics.empty() && options.engine == "lanes")
+        throw std::invalid_argument("The lanes engine counts no telemetry");
+    make_policy(options.policy); // Validate the name before starting.
+    return options;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    std::unique_ptr<Replay_writer> writer;
+    std::unique_ptr<Cave> cave;
+    Cave_engine engine = Cave_engine::generic;
+    try
+    {
+        options = parse_options(argc, argv);
+        if (!options.record.empty())
+            writer = std::make_unique<Replay_writer>(options.record);
+        if (!options.cave.empty())
+        {
+            cave = std::make_unique<Cave>(
+                make_cave(options.cave, options.seed));
+            if (options.engine != "generic")
+                engine = select_cave_engine(*cave, Cave_rules{});
+            if (options.engine == "lanes" &&
+                engine != Cave_engine::dodecahedron)
+            {
+                throw std::invalid_argument(
+                    "The lanes engine plays only the original cave");
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Results> results(options.threads);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.threads; ++i)
+    {
+        long long first = options.games * i / options.threads;
+        long long last = options.games * (i + 1) / options.threads;
+        threads.emplace_back(
+            [&options, &results, &writer, &cave, engine, i, first, last]() {
+                if (options.engine == "lanes")
+                    results[i] = play_lanes(options, first, last);
+                else if (cave)
+                    results[i] = play_cave(options, *cave, engine, first, last);
+                else
+                    results[i] = play(options, first, last, writer.get());
+            });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    if (writer || !options.metrics.empty())
+    {
+        try
+        {
+            if (writer)
+                writer->flush();
+            if (!options.metrics.empty())
+                write_prometheus(options.metrics, telemetry_snapshot());
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    Results total;
+    for (const Results& result : results)
+    {
+        for (int i = 0; i < num_game_states; ++i)
+            total.outcomes[i] += result.outcomes[i];
+        total.turns += result.turns;
+    }
+
+    std::cout << "policy: " << options.policy << std::endl;
+    if (cave)
+        std::cout << "cave: " << options.cave << " (" << cave->num_rooms()
+                  << " rooms, " << cave->num_edges() << " tunnels)"
+                  << std::endl
+                  << "engine: "
+                  << (options.engine == "lanes"
+                          ? std::string{"lanes ("} +
+                              lane_kernel_name(best_lane_kernel()) + ")"
+                          : cave_engine_name(engine))
+                  << std::endl;
+    std::cout << "threads: " << options.threads << std::endl
+              << "seed: " << options.seed << std::endl
+              << "games: " << options.games << std::endl;
+    for (int i = 1; i < num_game_states; ++i)
+    {
+        std::cout << game_state_name(static_cast<Game_state>(i)) << ": "
+                  << total.outcomes[i] << " (" << std::fixed
+                  << std::setprecision(2)
+                  << 100.0 * total.outcomes[i] / std::max(options.games, 1LL)
+                  << "%)" << std::endl;
+    }
+    std::cout << "turns/game: " << std::setprecision(2)
+              << static_cast<double>(total.turns) /
+            std::max(options.games, 1LL)
+              << std::endl
+              << "elapsed: " << std::setprecision(3) << elapsed.count() << " s"
+              << std::endl
+              << "games/sec: " << std::setprecision(0)
+              << options.games / elapsed.count() << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace wumpus {
+
+// Hands snapshots from one writer thread to one reader thread without locks
+// or waiting. There are three slots: the writer fills one, the reader holds
+// one, and the last one published waits in the middle. Publishing and taking
+// the latest snapshot each swap a slot with the middle one, so neither thread
+// ever touches the slot the other is using. The reader may skip snapshots
+// but always sees whole ones.
+template <typename T>
+class Snapshot_buffer
+{
+public:
+    // Called by the writer. Returns the slot to fill, which holds an older
+    // snapshot, so every field must be written before publishing.
+    T& back()
+    {
+        return slots[back_index];
+    }
+
+    // Called by the writer. Makes the filled slot the latest snapshot.
+    void publish()
+    {
+        back_index =
+            middle.exchange(back_index | fresh, std::memory_order_acq_rel) &
+            index_mask;
+    }
+
+    // Called by the reader. Takes the latest snapshot if one was published
+    // since the last call, and returns whether it did.
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & fresh))
+            return false;
+        front_index =
+            middle.exchange(front_index, std::memory_order_acq_rel) &
+            index_mask;
+        return true;
+    }
+
+    // Called by the reader. Returns the snapshot taken by the last update(),
+    // which stays put until the next one.
+    const T& front() const
+    {
+        return slots[front_index];
+    }
+
+private:
+    // The middle index carries a flag for a snapshot the reader has not
+    // taken yet.
+    static const int fresh = 4;
+    static const int index_mask = 3;
+
+    std::array<T, 3> slots{};
+    int back_index{0};
+    std::atomic<int> middle{1};
+    int front_index{2};
+};
+}
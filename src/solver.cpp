@@ -0,0 +1,388 @@
+#include "solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace wumpus {
+
+namespace {
+
+const int num_percept_sets = 8;
+
+Percepts percept_set(int index)
+{
+    Percepts percepts;
+    percepts.wumpus = (index & 1) != 0;
+    percepts.bat = (index & 2) != 0;
+    percepts.pit = (index & 4) != 0;
+    return percepts;
+}
+
+std::uint64_t mix(std::uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Runs the tasks on the given number of threads. Each thread owns a deque of
+// tasks and works from its back; a thread that runs out steals from the front
+// of the others, which balances subtrees of very different sizes.
+void run_work_stealing(std::vector<std::function<void()>>& tasks, int threads)
+{
+    struct Worker_queue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+    std::vector<Worker_queue> queues(threads);
+    for (std::size_t i = 0; i < tasks.size(); ++i)
+        queues[i % threads].tasks.push_back(i);
+
+    auto take = [&queues, threads](int self, std::size_t& task) {
+        {
+            std::lock_guard<std::mutex> lock{queues[self].mutex};
+            if (!queues[self].tasks.empty())
+            {
+                task = queues[self].tasks.back();
+                queues[self].tasks.pop_back();
+                return true;
+            }
+        }
+        for (int i = 1; i < threads; ++i)
+        {
+            Worker_queue& victim = queues[(self + i) % threads];
+            std::lock_guard<std::mutex> lock{victim.mutex};
+            if (!victim.tasks.empty())
+            {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<std::thread> workers;
+    for (int self = 0; self < threads; ++self)
+    {
+        workers.emplace_back([&tasks, &take, self]() {
+            std::size_t task;
+            while (take(self, task))
+                tasks[task]();
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+}
+}
+
+// Maps positions to their values. The table is split into shards, each with
+// its own lock, so that the workers rarely contend.
+class Solver::Transposition_table
+{
+public:
+    explicit Transposition_table(std::size_t capacity)
+        : shard_capacity{capacity ? std::max<std::size_t>(
+                                        1, capacity / num_shards)
+                                  : 0}
+    {
+    }
+
+    bool find(std::uint64_t key, double& value)
+    {
+        ++lookups;
+        Shard& shard = shards[key % num_shards];
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        auto it = shard.values.find(key);
+        if (it == shard.values.end())
+            return false;
+        ++hits;
+        value = it->second;
+        return true;
+    }
+
+    void insert(std::uint64_t key, double value)
+    {
+        Shard& shard = shards[key % num_shards];
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        if (!shard.values.emplace(key, value).second)
+            return;
+        if (shard_capacity == 0)
+            return;
+        shard.order.push_back(key);
+        if (shard.order.size() > shard_capacity)
+        {
+            shard.values.erase(shard.order.front());
+            shard.order.pop_front();
+            ++evictions;
+        }
+    }
+
+    std::size_t size()
+    {
+        std::size_t result = 0;
+        for (Shard& shard : shards)
+        {
+            std::lock_guard<std::mutex> lock{shard.mutex};
+            result += shard.values.size();
+        }
+        return result;
+    }
+
+    std::atomic<std::uint64_t> lookups{0};
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> evictions{0};
+
+private:
+    static const int num_shards = 64;
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<std::uint64_t, double> values;
+        // Insertion order, kept only when the capacity is bounded.
+        std::deque<std::uint64_t> order;
+    };
+
+    const std::size_t shard_capacity;
+    std::array<Shard, num_shards> shards;
+};
+
+std::vector<Decision> candidate_decisions(int player_room, int arrows)
+{
+    std::vector<Decision> decisions;
+    for (int room : room_connections[player_room])
+    {
+        Decision decision;
+        decision.path[0] = room;
+        decisions.push_back(decision);
+    }
+    if (arrows == 0)
+        return decisions;
+
+    static_assert(arrow_range == 3, "Shots are enumerated as three rooms");
+    for (int first : room_connections[player_room])
+        for (int second : room_connections[first])
+            for (int third : room_connections[second])
+                if (second != player_room && third != first)
+                {
+                    Decision decision;
+                    decision.type = Decision::Type::shoot;
+                    decision.path = {{first, second, third}};
+                    decisions.push_back(decision);
+                }
+    return decisions;
+}
+
+Solver::Solver(const Solver_options& options)
+    : options(options),
+      table{std::make_unique<Transposition_table>(options.table_capacity)}
+{
+    if (this->options.threads <= 0)
+        this->options.threads =
+            std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+Solver::~Solver() = default;
+
+std::vector<Policy_entry> Solver::solve_opening()
+{
+    const int player_room = 0;
+    Belief start{player_room};
+
+    std::vector<Policy_entry> entries;
+    std::vector<Belief> beliefs;
+    for (int i = 0; i < num_percept_sets; ++i)
+    {
+        Belief belief = start;
+        Policy_entry entry;
+        entry.percepts = percept_set(i);
+        entry.probability = belief.observe_room(player_room, entry.percepts);
+        if (entry.probability == 0)
+            continue;
+        entries.push_back(entry);
+        beliefs.push_back(belief);
+    }
+
+    const std::vector<Decision> decisions =
+        candidate_decisions(player_room, num_arrows);
+    std::vector<double> values =
+        evaluate_decisions(beliefs, player_room, num_arrows, decisions);
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        auto first = values.begin() + i * decisions.size();
+        auto best = std::max_element(first, first + decisions.size());
+        entries[i].decision = decisions[best - first];
+        entries[i].win_probability = *best;
+    }
+    return entries;
+}
+
+Decision Solver::solve(
+    const Belief& belief, int player_room, int arrows, double& win_probability)
+{
+    const std::vector<Decision> decisions =
+        candidate_decisions(player_room, arrows);
+    std::vector<double> values =
+        evaluate_decisions({belief}, player_room, arrows, decisions);
+    auto best = std::max_element(values.begin(), values.end());
+    win_probability = *best;
+    return decisions[best - values.begin()];
+}
+
+Solver_stats Solver::stats() const
+{
+    Solver_stats result;
+    result.nodes = nodes;
+    result.table_lookups = table->lookups;
+    result.table_hits = table->hits;
+    result.table_evictions = table->evictions;
+    result.table_size = table->size();
+    result.seconds = seconds;
+    return result;
+}
+
+// Evaluates every decision for every belief as a separate task. The values
+// are laid out belief by belief.
+std::vector<double> Solver::evaluate_decisions(
+    const std::vector<Belief>& beliefs,
+    int player_room,
+    int arrows,
+    const std::vector<Decision>& decisions)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Hazard_probabilities> probabilities;
+    for (const Belief& belief : beliefs)
+        probabilities.push_back(belief.probabilities());
+
+    std::vector<double> values(beliefs.size() * decisions.size());
+    std::vector<std::function<void()>> tasks;
+    for (std::size_t i = 0; i < beliefs.size(); ++i)
+    {
+        for (std::size_t j = 0; j < decisions.size(); ++j)
+        {
+            tasks.push_back([&, i, j]() {
+                values[i * decisions.size() + j] = decision_value(
+                    beliefs[i],
+                    probabilities[i],
+                    player_room,
+                    arrows,
+                    options.depth,
+                    decisions[j]);
+            });
+        }
+    }
+    nodes += beliefs.size();
+    run_work_stealing(tasks, options.threads);
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    seconds += elapsed.count();
+    return values;
+}
+
+// Returns the probability of winning within the given number of decisions
+// when playing the best decisions from here.
+double Solver::value(
+    const Belief& belief, int player_room, int arrows, int depth)
+{
+    // Without arrows or decisions left the wumpus cannot be slain.
+    if (arrows == 0 || depth == 0)
+        return 0;
+
+    // Positions that are images of each other under a symmetry of the cave
+    // share a value, so the key is taken over the relabellings that move the
+    // player to room 0 and the least one is kept.
+    std::uint64_t fingerprint = ~0ULL;
+    for (int index : automorphisms_to_origin(player_room))
+        fingerprint = std::min(
+            fingerprint, belief.fingerprint(cave_automorphisms()[index]));
+    const std::uint64_t key = mix(
+        fingerprint ^
+        mix((static_cast<std::uint64_t>(arrows) << 8) |
+            static_cast<std::uint64_t>(depth)));
+    double result;
+    if (table->find(key, result))
+        return result;
+
+    ++nodes;
+    const Hazard_probabilities probabilities = belief.probabilities();
+    result = 0;
+    for (const Decision& decision : candidate_decisions(player_room, arrows))
+        result = std::max(
+            result,
+            decision_value(
+                belief, probabilities, player_room, arrows, depth, decision));
+    table->insert(key, result);
+    return result;
+}
+
+double Solver::decision_value(
+    const Belief& belief,
+    const Hazard_probabilities& probabilities,
+    int player_room,
+    int arrows,
+    int depth,
+    const Decision& decision)
+{
+    if (decision.type == Decision::Type::shoot)
+    {
+        const Arrow_odds odds = arrow_odds(player_room, decision.path);
+        double result = 0;
+        for (int room = 0; room < num_rooms; ++room)
+            result += probabilities.wumpus[room] * odds.kill[room];
+        if (depth == 1 || arrows == 1)
+            return result;
+
+        Belief missed = belief;
+        double miss = missed.observe_missed_arrow(player_room, decision.path);
+        if (miss == 0)
+            return result;
+        missed.observe_wumpus_moved();
+        return result +
+            miss * percepts_value(missed, player_room, arrows - 1, depth - 1);
+    }
+
+    // A move cannot slay the wumpus by itself.
+    if (depth == 1)
+        return 0;
+    const int room = decision.path[0];
+    double result = percepts_value(belief, room, arrows, depth - 1);
+
+    Belief carried = belief;
+    double bat = carried.observe_bat(room);
+    if (bat == 0)
+        return result;
+    double drop = carried.observe_dropped();
+    for (int landing_room = 0; landing_room < num_rooms; ++landing_room)
+        result += bat * drop *
+            percepts_value(carried, landing_room, arrows, depth - 1);
+    return result;
+}
+
+// Returns the value of being alive in the given room, averaged over the
+// percepts the player may have there.
+double Solver::percepts_value(
+    const Belief& belief, int player_room, int arrows, int depth)
+{
+    double result = 0;
+    for (int i = 0; i < num_percept_sets; ++i)
+    {
+        Belief child = belief;
+        double probability = child.observe_room(player_room, percept_set(i));
+        if (probability > 0)
+            result += probability * value(child, player_room, arrows, depth);
+    }
+    return result;
+}
+}
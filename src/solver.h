@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "belief.h"
+
+namespace wumpus {
+
+// A choice of the player. Rooms are given by index; a move uses path[0].
+struct Decision
+{
+    enum class Type : std::uint8_t
+    {
+        move,
+        shoot
+    } type{Type::move};
+    std::array<int, arrow_range> path{{-1, -1, -1}};
+};
+
+struct Solver_options
+{
+    // The number of decisions to look ahead.
+    int depth{2};
+    // The number of worker threads, or 0 for one per core.
+    int threads{0};
+    // The most entries kept in the transposition table, or 0 for no limit.
+    // When full, the oldest entries are evicted first.
+    std::size_t table_capacity{0};
+};
+
+struct Solver_stats
+{
+    std::uint64_t nodes{0};
+    std::uint64_t table_lookups{0};
+    std::uint64_t table_hits{0};
+    std::uint64_t table_evictions{0};
+    std::size_t table_size{0};
+    double seconds{0};
+};
+
+// The best decision in some situation and the probability of winning with it.
+struct Policy_entry
+{
+    Percepts percepts;
+    // The probability of being in this situation.
+    double probability{0};
+    Decision decision;
+    double win_probability{0};
+};
+
+// Computes the best play by expectimax over belief states: the player's
+// decisions are maximized and the percepts, bat drops, arrow deflections and
+// wumpus moves are averaged under the exact Belief. The search looks a fixed
+// number of decisions ahead, so it gives the optimal probability of winning
+// within that many decisions; this approaches the true optimum as the depth
+// grows. Positions are memoized in a transposition table keyed on the belief
+// and the player's room up to the symmetries of the cave, the arrows left and
+// the depth, and the root decisions are spread over a work-stealing thread
+// pool.
+class Solver
+{
+public:
+    explicit Solver(const Solver_options& options);
+    ~Solver();
+
+    // Solves the start of a hunt, with the player in room 0 (every room of
+    // the cave is alike) and all arrows, once for each possible set of
+    // percepts. The entries are the policy table of the opening.
+    std::vector<Policy_entry> solve_opening();
+
+    // Returns the best decision for the given situation and fills in its win
+    // probability.
+    Decision solve(
+        const Belief& belief,
+        int player_room,
+        int arrows,
+        double& win_probability);
+
+    Solver_stats stats() const;
+
+private:
+    class Transposition_table;
+
+    Solver_options options;
+    std::unique_ptr<Transposition_table> table;
+    std::atomic<std::uint64_t> nodes{0};
+    double seconds{0};
+
+    // Returns the value of each candidate decision in the given situation.
+    std::vector<double> evaluate_decisions(
+        const std::vector<Belief>& beliefs,
+        int player_room,
+        int arrows,
+        const std::vector<Decision>& decisions);
+
+    double value(const Belief& belief, int player_room, int arrows, int depth);
+    double decision_value(
+        const Belief& belief,
+        const Hazard_probabilities& probabilities,
+        int player_room,
+        int arrows,
+        int depth,
+        const Decision& decision);
+    double percepts_value(
+        const Belief& belief, int player_room, int arrows, int depth);
+};
+
+// Returns the decisions available in the given room: every move, and every
+// shot along a path that does not turn back on itself.
+std::vector<Decision> candidate_decisions(int player_room, int arrows);
+}
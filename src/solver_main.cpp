@@ -0,0 +1,118 @@
+// Solves the opening of a hunt by expectimax over belief states and prints
+// the policy table with the search statistics.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "solver.h"
+
+using namespace wumpus;
+
+namespace {
+
+std::string percepts_name(const Percepts& percepts)
+{
+    std::string name;
+    name += percepts.wumpus ? 'W' : '-';
+    name += percepts.bat ? 'B' : '-';
+    name += percepts.pit ? 'P' : '-';
+    return name;
+}
+
+std::string decision_name(const Decision& decision)
+{
+    if (decision.type == Decision::Type::move)
+        return "move " + std::to_string(decision.path[0]);
+    std::string name = "shoot";
+    for (int room : decision.path)
+        name += " " + std::to_string(room);
+    return name;
+}
+
+void print_usage()
+{
+    std::cerr << "Usage: wumpus_solver [--depth N] [--threads N] "
+                 "[--table-capacity N]"
+              << std::endl;
+}
+
+Solver_options parse_options(int argc, char* argv[])
+{
+    Solver_options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+            throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--depth")
+            options.depth = std::stoi(value);
+        else if (arg == "--threads")
+            options.threads = std::stoi(value);
+        else if (arg == "--table-capacity")
+            options.table_capacity = std::stoull(value);
+        else
+            throw std::invalid_argument("Unknown option: " + arg);
+    }
+    if (options.depth < 1)
+        throw std::invalid_argument("The depth must be at least 1");
+    return options;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Solver_options options;
+    try
+    {
+        options = parse_options(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    Solver solver{options};
+    std::vector<Policy_entry> policy = solver.solve_opening();
+
+    double win_probability = 0;
+    std::cout << "Opening policy, player in room 0, looking " << options.depth
+              << " decisions ahead." << std::endl
+              << "Rooms are indices into room_connections; percepts are "
+                 "Wumpus, Bat, Pit."
+              << std::endl
+              << std::endl
+              << "percepts  probability  decision          win probability"
+              << std::endl;
+    for (const Policy_entry& entry : policy)
+    {
+        std::cout << std::left << std::setw(10)
+                  << percepts_name(entry.percepts) << std::setw(13)
+                  << std::fixed << std::setprecision(6) << entry.probability
+                  << std::setw(18) << decision_name(entry.decision)
+                  << entry.win_probability << std::endl;
+        win_probability += entry.probability * entry.win_probability;
+    }
+
+    Solver_stats stats = solver.stats();
+    std::cout << std::endl
+              << "win probability: " << win_probability << std::endl
+              << "nodes: " << stats.nodes << std::endl
+              << "elapsed: " << std::setprecision(3) << stats.seconds << " s"
+              << std::endl
+              << "nodes/sec: " << std::setprecision(0)
+              << stats.nodes / std::max(stats.seconds, 1e-9) << std::endl
+              << "table entries: " << stats.table_size << std::endl
+              << "table hit rate: " << std::setprecision(2)
+              << 100.0 * stats.table_hits /
+            std::max<std::uint64_t>(stats.table_lookups, 1)
+              << "% of " << stats.table_lookups << " lookups" << std::endl
+              << "table evictions: " << stats.table_evictions << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace wumpus {
+
+// A bounded queue for one producer thread and one consumer thread, without
+// locks. The producer and the consumer each own one index and only read the
+// other's, so a push or a pop is a couple of loads and one release store. The
+// indices run freely and wrap, and the capacity must be a power of two.
+template <typename T, std::size_t Capacity>
+class Spsc_queue
+{
+    static_assert(
+        Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+        "The capacity must be a power of two");
+    static_assert(
+        std::is_trivially_copyable<T>::value,
+        "Elements are copied in and out as plain values");
+
+public:
+    // Called by the producer. Returns false, and drops nothing, if the queue
+    // is full.
+    bool push(const T& value)
+    {
+        const std::size_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        slots[tail & (Capacity - 1)] = value;
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Called by the consumer. Returns false if the queue is empty.
+    bool pop(T& value)
+    {
+        const std::size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == tail.load(std::memory_order_acquire))
+            return false;
+        value = slots[head & (Capacity - 1)];
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Either thread may call this, but the answer may be stale by the time it
+    // returns.
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) ==
+            tail.load(std::memory_order_acquire);
+    }
+
+private:
+    // The indices sit on separate cache lines, so that the two threads do not
+    // invalidate each other's line on every operation.
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+    alignas(64) std::array<T, Capacity> slots;
+};
+}
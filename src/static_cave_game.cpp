@@ -0,0 +1,61 @@
+#include "static_cave_game.h"
+
+namespace wumpus {
+
+template <typename Topology, typename Rules, typename Sink>
+Static_cave_game<Topology, Rules, Sink>::Static_cave_game(
+    Sink& sink, std::uint64_t seed)
+    : Cave_hunt<Static_cave_policy<Topology, Rules>, Sink>{sink, seed}
+{
+}
+
+template <typename Topology, typename Rules, typename Sink>
+auto Static_cave_game<Topology, Rules, Sink>::get_bat_mask() const -> Mask
+{
+    return this->cave.get_bat_mask();
+}
+
+template <typename Topology, typename Rules, typename Sink>
+auto Static_cave_game<Topology, Rules, Sink>::get_pit_mask() const -> Mask
+{
+    return this->cave.get_pit_mask();
+}
+
+template class Cave_hunt<
+    Static_cave_policy<Dodecahedron_topology, Classic_rules>,
+    Event_sink>;
+template class Cave_hunt<
+    Static_cave_policy<Dodecahedron_topology, Classic_rules>,
+    Null_event_sink>;
+template class Cave_hunt<
+    Static_cave_policy<Torus_4x4_topology, Classic_rules>,
+    Event_sink>;
+template class Cave_hunt<
+    Static_cave_policy<Torus_4x4_topology, Classic_rules>,
+    Null_event_sink>;
+template class Cave_hunt<
+    Static_cave_policy<Torus_8x8_topology, Classic_rules>,
+    Event_sink>;
+template class Cave_hunt<
+    Static_cave_policy<Torus_8x8_topology, Classic_rules>,
+    Null_event_sink>;
+
+template class Static_cave_game<
+    Dodecahedron_topology,
+    Classic_rules,
+    Event_sink>;
+template class Static_cave_game<
+    Dodecahedron_topology,
+    Classic_rules,
+    Null_event_sink>;
+template class Static_cave_game<Torus_4x4_topology, Classic_rules, Event_sink>;
+template class Static_cave_game<
+    Torus_4x4_topology,
+    Classic_rules,
+    Null_event_sink>;
+template class Static_cave_game<Torus_8x8_topology, Classic_rules, Event_sink>;
+template class Static_cave_game<
+    Torus_8x8_topology,
+    Classic_rules,
+    Null_event_sink>;
+}
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "cave_hunt.h"
+#include "events.h"
+#include "game.h"
+#include "random.h"
+
+namespace wumpus {
+
+// A topology is a type describing a cave at compile time: its num_rooms, the
+// degree of every room and a constexpr adjacent_room(room, i) giving the
+// tunnels of each room in order.
+
+// The cave of the original game, with the tunnels of room_connections.
+struct Dodecahedron_topology
+{
+    static constexpr int num_rooms = wumpus::num_rooms;
+    static constexpr int degree = connections_per_room;
+
+    static constexpr int adjacent_room(int room, int i)
+    {
+        return room_connections[room][i];
+    }
+};
+
+// A Width by Height grid whose edges wrap around, with the tunnels of each
+// room running left, right, up and down, as in Cave::torus().
+template <int Width, int Height>
+struct Torus_topology
+{
+    static_assert(Width >= 3 && Height >= 3, "Narrower tori have loops");
+
+    static constexpr int num_rooms = Width * Height;
+    static constexpr int degree = 4;
+
+    static constexpr int adjacent_room(int room, int i)
+    {
+        return i == 0 ? room / Width * Width + (room + Width - 1) % Width
+            : i == 1  ? room / Width * Width + (room + 1) % Width
+            : i == 2  ? (room + num_rooms - Width) % num_rooms
+                      : (room + Width) % num_rooms;
+    }
+};
+
+// The numbers of things in a hunt, fixed at compile time.
+template <int Bats, int Pits, int Arrow_range, int Arrows>
+struct Static_rules
+{
+    static constexpr int num_bats = Bats;
+    static constexpr int num_pits = Pits;
+    static constexpr int arrow_range = Arrow_range;
+    static constexpr int num_arrows = Arrows;
+};
+
+using Classic_rules =
+    Static_rules<num_bats, num_pits, arrow_range, num_arrows>;
+
+// The narrowest unsigned integer with a bit for each of the given number of
+// rooms.
+template <int Rooms>
+using Static_room_mask = std::conditional_t<
+    Rooms <= 8,
+    std::uint8_t,
+    std::conditional_t<
+        Rooms <= 16,
+        std::uint16_t,
+        std::conditional_t<Rooms <= 32, std::uint32_t, std::uint64_t>>>;
+
+// Returns the index of the lowest room in a non-empty mask of any width.
+inline int lowest_room(std::uint64_t rooms)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, rooms);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(rooms);
+#endif
+}
+
+// The tables of a topology, all computed by the compiler: the rooms adjacent
+// to each room as a mask, and the number of tunnels between every pair of
+// rooms, or no_path between rooms that are not joined.
+template <typename Topology>
+struct Topology_tables
+{
+    static_assert(Topology::num_rooms <= 64, "Every room must fit in a mask");
+
+    using Mask = Static_room_mask<Topology::num_rooms>;
+    static constexpr std::uint8_t no_path = 0xff;
+
+    Mask adjacency[Topology::num_rooms];
+    std::uint8_t distances[Topology::num_rooms][Topology::num_rooms];
+};
+
+template <typename Topology>
+constexpr Topology_tables<Topology> make_topology_tables()
+{
+    using Mask = typename Topology_tables<Topology>::Mask;
+    const int rooms = Topology::num_rooms;
+    Topology_tables<Topology> tables{};
+    for (int room = 0; room < rooms; ++room)
+        for (int i = 0; i < Topology::degree; ++i)
+            tables.adjacency[room] |=
+                Mask(Mask{1} << Topology::adjacent_room(room, i));
+
+    // Breadth-first search from every room, a whole frontier at a time.
+    for (int from = 0; from < rooms; ++from)
+    {
+        for (int to = 0; to < rooms; ++to)
+            tables.distances[from][to] = Topology_tables<Topology>::no_path;
+        tables.distances[from][from] = 0;
+        Mask reached = Mask(Mask{1} << from);
+        Mask frontier = reached;
+        for (int distance = 1; frontier; ++distance)
+        {
+            Mask next = 0;
+            for (int room = 0; room < rooms; ++room)
+                if (frontier >> room & 1)
+                    next |= tables.adjacency[room];
+            frontier = next & Mask(~reached);
+            reached |= frontier;
+            for (int room = 0; room < rooms; ++room)
+                if (frontier >> room & 1)
+                    tables.distances[from][room] =
+                        static_cast<std::uint8_t>(distance);
+        }
+    }
+    return tables;
+}
+
+// The tables of each topology, built once at compile time.
+template <typename Topology>
+struct Static_topology
+{
+    static constexpr Topology_tables<Topology> tables =
+        make_topology_tables<Topology>();
+};
+
+template <typename Topology>
+constexpr Topology_tables<Topology> Static_topology<Topology>::tables;
+
+// The Cave_hunt policy for a topology and rules known at compile time. The
+// hazards are kept as masks of the narrowest width, the percepts are three
+// ands against a constant table, and the loops over tunnels have a constant
+// count that the compiler unrolls.
+template <typename Topology, typename Rules>
+class Static_cave_policy
+{
+public:
+    using Mask = typename Topology_tables<Topology>::Mask;
+    using Room = std::uint8_t;
+    static constexpr int arrow_range = Rules::arrow_range;
+
+    static_assert(
+        Topology::num_rooms >= 2 + Rules::num_bats + Rules::num_pits,
+        "The cave is too small for the hazards");
+
+    static constexpr int num_rooms()
+    {
+        return Topology::num_rooms;
+    }
+
+    static constexpr int degree(int)
+    {
+        return Topology::degree;
+    }
+
+    static constexpr int adjacent_room(int room, int i)
+    {
+        return Topology::adjacent_room(room, i);
+    }
+
+    static bool are_adjacent(int room, int other_room)
+    {
+        return other_room >= 0 && other_room < Topology::num_rooms &&
+            (tables().adjacency[room] & bit(other_room));
+    }
+
+    static constexpr int num_bats()
+    {
+        return Rules::num_bats;
+    }
+
+    static constexpr int num_pits()
+    {
+        return Rules::num_pits;
+    }
+
+    static constexpr int num_arrows()
+    {
+        return Rules::num_arrows;
+    }
+
+    std::int32_t* sampled_rooms()
+    {
+        return sampled.data();
+    }
+
+    void place_hazards(
+        const std::int32_t* bat_rooms, const std::int32_t* pit_rooms)
+    {
+        bats = 0;
+        for (int i = 0; i < Rules::num_bats; ++i)
+            bats |= bit(bat_rooms[i]);
+        pits = 0;
+        for (int i = 0; i < Rules::num_pits; ++i)
+            pits |= bit(pit_rooms[i]);
+    }
+
+    bool has_bat(int room) const
+    {
+        return (bats & bit(room)) != 0;
+    }
+
+    bool has_pit(int room) const
+    {
+        return (pits & bit(room)) != 0;
+    }
+
+    Percepts percepts(int player_room, int wumpus_room) const
+    {
+        const Mask adjacent = tables().adjacency[player_room];
+        Percepts percepts;
+        percepts.wumpus = (adjacent & bit(wumpus_room)) != 0;
+        percepts.bat = (adjacent & bats) != 0;
+        percepts.pit = (adjacent & pits) != 0;
+        return percepts;
+    }
+
+    Mask get_bat_mask() const
+    {
+        return bats;
+    }
+
+    Mask get_pit_mask() const
+    {
+        return pits;
+    }
+
+    static const Topology_tables<Topology>& tables()
+    {
+        return Static_topology<Topology>::tables;
+    }
+
+private:
+    Mask bats{0};
+    Mask pits{0};
+    std::array<std::int32_t, 2 + Rules::num_bats + Rules::num_pits> sampled;
+
+    static Mask bit(int room)
+    {
+        return Mask(Mask{1} << room);
+    }
+};
+
+// The game of Basic_cave_game specialized for a topology and rules known at
+// compile time, through the same rules. From the same seed it plays exactly
+// the same hunts as Basic_cave_game in the matching Cave.
+template <typename Topology, typename Rules, typename Sink>
+class Static_cave_game
+    : public Cave_hunt<Static_cave_policy<Topology, Rules>, Sink>
+{
+public:
+    using Mask = typename Static_cave_policy<Topology, Rules>::Mask;
+
+    explicit Static_cave_game(Sink& sink, std::uint64_t seed = random_seed());
+
+    Mask get_bat_mask() const;
+    Mask get_pit_mask() const;
+
+    // Returns the number of tunnels between two rooms.
+    static int distance(int room, int other_room)
+    {
+        return Static_cave_policy<Topology, Rules>::tables()
+            .distances[room][other_room];
+    }
+};
+
+// The specializations built into the core. Caves and rules matching one of
+// these are played by it; see with_cave_game().
+using Torus_4x4_topology = Torus_topology<4, 4>;
+using Torus_8x8_topology = Torus_topology<8, 8>;
+
+extern template class Cave_hunt<
+    Static_cave_policy<Dodecahedron_topology, Classic_rules>,
+    Event_sink>;
+extern template class Cave_hunt<
+    Static_cave_policy<Dodecahedron_topology, Classic_rules>,
+    Null_event_sink>;
+extern template class Cave_hunt<
+    Static_cave_policy<Torus_4x4_topology, Classic_rules>,
+    Event_sink>;
+extern template class Cave_hunt<
+    Static_cave_policy<Torus_4x4_topology, Classic_rules>,
+    Null_event_sink>;
+extern template class Cave_hunt<
+    Static_cave_policy<Torus_8x8_topology, Classic_rules>,
+    Event_sink>;
+extern template class Cave_hunt<
+    Static_cave_policy<Torus_8x8_topology, Classic_rules>,
+    Null_event_sink>;
+extern template class Static_cave_game<
+    Dodecahedron_topology,
+    Classic_rules,
+    Event_sink>;
+extern template class Static_cave_game<
+    Dodecahedron_topology,
+    Classic_rules,
+    Null_event_sink>;
+extern template class Static_cave_game<
+    Torus_4x4_topology,
+    Classic_rules,
+    Event_sink>;
+extern template class Static_cave_game<
+    Torus_4x4_topology,
+    Classic_rules,
+    Null_event_sink>;
+extern template class Static_cave_game<
+    Torus_8x8_topology,
+    Classic_rules,
+    Event_sink>;
+extern template class Static_cave_game<
+    Torus_8x8_topology,
+    Classic_rules,
+    Null_event_sink>;
+}
@@ -0,0 +1,164 @@
+#include "symmetry.h"
+
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace wumpus {
+
+namespace {
+
+// Extends a partial automorphism that maps order[0..k) and records every
+// complete one.
+void extend(
+    const std::array<int, num_rooms>& order,
+    int k,
+    Permutation& rooms,
+    Room_mask used,
+    std::vector<Automorphism>& results)
+{
+    if (k == num_rooms)
+    {
+        Automorphism automorphism{};
+        automorphism.rooms = rooms;
+        for (std::size_t i = 0; i < automorphism.nibbles.size(); ++i)
+            for (int bits = 0; bits < 16; ++bits)
+                for (int j = 0; j < 4; ++j)
+                {
+                    int room = static_cast<int>(4 * i) + j;
+                    if ((bits & (1 << j)) && room < num_rooms)
+                        automorphism.nibbles[i][bits] |= room_bit(rooms[room]);
+                }
+        results.push_back(automorphism);
+        return;
+    }
+
+    const int room = order[k];
+    for (int image = 0; image < num_rooms; ++image)
+    {
+        if (used & room_bit(image))
+            continue;
+        bool preserves_tunnels = true;
+        for (int i = 0; i < k && preserves_tunnels; ++i)
+        {
+            bool adjacent = (adjacency_masks[room] & room_bit(order[i])) != 0;
+            bool image_adjacent =
+                (adjacency_masks[image] & room_bit(rooms[order[i]])) != 0;
+            preserves_tunnels = adjacent == image_adjacent;
+        }
+        if (!preserves_tunnels)
+            continue;
+        rooms[room] = static_cast<std::int8_t>(image);
+        extend(order, k + 1, rooms, used | room_bit(image), results);
+    }
+}
+
+std::vector<Automorphism> find_automorphisms()
+{
+    // Visit the rooms breadth first, so that each room after the first has a
+    // mapped neighbour and only a few images to try.
+    std::array<int, num_rooms> order;
+    Room_mask seen = room_bit(0);
+    int size = 0;
+    order[size++] = 0;
+    for (int i = 0; i < size; ++i)
+        for (int room : room_connections[order[i]])
+            if (!(seen & room_bit(room)))
+            {
+                seen |= room_bit(room);
+                order[size++] = room;
+            }
+    if (size != num_rooms)
+        throw std::logic_error("The cave is not connected");
+
+    Permutation rooms{};
+    std::vector<Automorphism> results;
+    extend(order, 0, rooms, 0, results);
+    for (Automorphism& automorphism : results)
+    {
+        bool is_identity = true;
+        for (int room = 0; room < num_rooms; ++room)
+            is_identity = is_identity && automorphism(room) == room;
+        if (is_identity)
+            std::swap(automorphism, results.front());
+    }
+    return results;
+}
+
+std::array<std::vector<int>, num_rooms> find_automorphisms_to_origin()
+{
+    std::array<std::vector<int>, num_rooms> results;
+    const std::vector<Automorphism>& automorphisms = cave_automorphisms();
+    for (std::size_t i = 0; i < automorphisms.size(); ++i)
+        for (int room = 0; room < num_rooms; ++room)
+            if (automorphisms[i](room) == 0)
+                results[room].push_back(static_cast<int>(i));
+    for (const std::vector<int>& result : results)
+        if (result.empty())
+            throw std::logic_error("The cave is not vertex-transitive");
+    return results;
+}
+
+std::tuple<Room_mask, Room_mask, Room_mask, Room_mask, Room_mask> as_tuple(
+    const Cave_position& p)
+{
+    return std::make_tuple(p.player, p.wumpus, p.bats, p.pits, p.visited);
+}
+}
+
+const std::vector<Automorphism>& cave_automorphisms()
+{
+    static const std::vector<Automorphism> automorphisms =
+        find_automorphisms();
+    return automorphisms;
+}
+
+const std::vector<int>& automorphisms_to_origin(int room)
+{
+    static const std::array<std::vector<int>, num_rooms> automorphisms =
+        find_automorphisms_to_origin();
+    return automorphisms[room];
+}
+
+bool operator==(const Cave_position& lhs, const Cave_position& rhs)
+{
+    return as_tuple(lhs) == as_tuple(rhs);
+}
+
+bool operator<(const Cave_position& lhs, const Cave_position& rhs)
+{
+    return as_tuple(lhs) < as_tuple(rhs);
+}
+
+Cave_position apply(const Automorphism& automorphism, const Cave_position& p)
+{
+    Cave_position result;
+    result.player = automorphism(p.player);
+    result.wumpus = automorphism(p.wumpus);
+    result.bats = automorphism(p.bats);
+    result.pits = automorphism(p.pits);
+    result.visited = automorphism(p.visited);
+    return result;
+}
+
+Cave_position canonicalize(const Cave_position& position, int* automorphism)
+{
+    const std::vector<Automorphism>& automorphisms = cave_automorphisms();
+    const std::vector<int>& candidates =
+        automorphisms_to_origin(room_index(position.player));
+    int best_index = candidates[0];
+    Cave_position best = apply(automorphisms[best_index], position);
+    for (std::size_t i = 1; i < candidates.size(); ++i)
+    {
+        Cave_position image = apply(automorphisms[candidates[i]], position);
+        if (image < best)
+        {
+            best = image;
+            best_index = candidates[i];
+        }
+    }
+    if (automorphism)
+        *automorphism = best_index;
+    return best;
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "game.h"
+
+namespace wumpus {
+
+// A relabelling of the rooms: room i becomes room permutation[i].
+using Permutation = std::array<std::int8_t, num_rooms>;
+
+// A symmetry of the cave: a permutation of the rooms that maps tunnels to
+// tunnels. The masks are permuted a nibble at a time through lookup tables.
+struct Automorphism
+{
+    Permutation rooms;
+    std::array<std::array<Room_mask, 16>, (num_rooms + 3) / 4> nibbles;
+
+    int operator()(int room) const
+    {
+        return rooms[room];
+    }
+
+    Room_mask operator()(Room_mask mask) const
+    {
+        Room_mask result = 0;
+        for (std::size_t i = 0; i < nibbles.size(); ++i)
+            result |= nibbles[i][(mask >> (4 * i)) & 0xf];
+        return result;
+    }
+};
+
+// Returns every automorphism of the cave in room_connections, the identity
+// first. For the dodecahedron there are 120, reflections included.
+const std::vector<Automorphism>& cave_automorphisms();
+
+// Returns the indices of the automorphisms that map the given room to room 0.
+// The cave is vertex-transitive, so there is at least one for every room.
+const std::vector<int>& automorphisms_to_origin(int room);
+
+// What a searcher knows about a position, as room masks.
+struct Cave_position
+{
+    Room_mask player{0};
+    Room_mask wumpus{0};
+    Room_mask bats{0};
+    Room_mask pits{0};
+    Room_mask visited{0};
+};
+
+bool operator==(const Cave_position& lhs, const Cave_position& rhs);
+bool operator<(const Cave_position& lhs, const Cave_position& rhs);
+
+Cave_position apply(const Automorphism& automorphism, const Cave_position& p);
+
+// Returns the canonical representative of the position: the least image under
+// the automorphisms that put the player in room 0. Positions related by a
+// symmetry of the cave have the same representative. If automorphism is not
+// null, it receives the index of the automorphism that was applied.
+Cave_position canonicalize(
+    const Cave_position& position, int* automorphism = nullptr);
+}
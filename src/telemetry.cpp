@@ -0,0 +1,204 @@
+#include "telemetry.h"
+
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace wumpus {
+
+namespace {
+
+// The upper bounds of the histogram buckets exported, in nanoseconds.
+const std::array<std::uint64_t, 10> bucket_bounds{
+    {25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 100000}};
+
+std::mutex& shared_mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+// The counts of the threads that have exited or flushed.
+Telemetry& shared()
+{
+    static Telemetry telemetry;
+    return telemetry;
+}
+
+void write_counter(
+    std::ostream& out,
+    const char* name,
+    const char* help,
+    std::uint64_t value)
+{
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " counter\n"
+        << name << " " << value << "\n";
+}
+}
+
+const char* timed_operation_name(Timed_operation operation)
+{
+    switch (operation)
+    {
+    case Timed_operation::init_hunt:
+        return "init_hunt";
+    case Timed_operation::move:
+        return "move";
+    case Timed_operation::shoot:
+        return "shoot";
+    default:
+        throw std::logic_error("Invalid timed operation");
+    }
+}
+
+void Telemetry::merge(const Telemetry& other)
+{
+    hunts += other.hunts;
+    for (int i = 0; i < num_game_states; ++i)
+        outcomes[i] += other.outcomes[i];
+    turns += other.turns;
+    bat_carries += other.bat_carries;
+    wumpus_moves += other.wumpus_moves;
+    arrows_used += other.arrows_used;
+    for (int i = 0; i < num_timed_operations; ++i)
+        latency[i].merge(other.latency[i]);
+}
+
+void Telemetry::clear()
+{
+    *this = Telemetry{};
+}
+
+#if WUMPUS_TELEMETRY
+
+namespace telemetry {
+
+namespace {
+
+// Hands its counts to the shared totals when its thread exits.
+struct Thread_telemetry
+{
+    Telemetry counts;
+
+    ~Thread_telemetry()
+    {
+        std::lock_guard<std::mutex> lock{shared_mutex()};
+        shared().merge(counts);
+    }
+};
+}
+
+Telemetry& local()
+{
+    thread_local Thread_telemetry telemetry;
+    return telemetry.counts;
+}
+}
+
+#endif
+
+Telemetry telemetry_snapshot()
+{
+    std::lock_guard<std::mutex> lock{shared_mutex()};
+    Telemetry result = shared();
+#if WUMPUS_TELEMETRY
+    result.merge(telemetry::local());
+#endif
+    return result;
+}
+
+void flush_telemetry()
+{
+#if WUMPUS_TELEMETRY
+    Telemetry& counts = telemetry::local();
+    std::lock_guard<std::mutex> lock{shared_mutex()};
+    shared().merge(counts);
+    counts.clear();
+#endif
+}
+
+void write_prometheus(std::ostream& out, const Telemetry& telemetry)
+{
+    // Formatted apart, so that the caller's stream keeps its settings.
+    std::ostringstream text;
+    text.precision(9);
+    write_counter(
+        text, "wumpus_hunts_total", "Hunts started.", telemetry.hunts);
+    text << "# HELP wumpus_hunts_ended_total Hunts ended, by outcome.\n"
+         << "# TYPE wumpus_hunts_ended_total counter\n";
+    for (int i = 1; i < num_game_states; ++i)
+    {
+        text << "wumpus_hunts_ended_total{outcome=\""
+             << game_state_name(static_cast<Game_state>(i)) << "\"} "
+             << telemetry.outcomes[i] << "\n";
+    }
+    write_counter(
+        text,
+        "wumpus_turns_total",
+        "Moves, shots and quits played.",
+        telemetry.turns);
+    write_counter(
+        text,
+        "wumpus_bat_carries_total",
+        "Times a bat carried the player away.",
+        telemetry.bat_carries);
+    write_counter(
+        text,
+        "wumpus_wumpus_moves_total",
+        "Times a missed arrow woke the wumpus.",
+        telemetry.wumpus_moves);
+    write_counter(
+        text,
+        "wumpus_arrows_used_total",
+        "Arrows shot.",
+        telemetry.arrows_used);
+
+    const char* name = "wumpus_operation_duration_seconds";
+    text << "# HELP " << name << " Time taken by game operations.\n"
+         << "# TYPE " << name << " histogram\n";
+    for (int i = 0; i < num_timed_operations; ++i)
+    {
+        const Latency_histogram& latency = telemetry.latency[i];
+        const char* operation =
+            timed_operation_name(static_cast<Timed_operation>(i));
+        for (std::uint64_t bound : bucket_bounds)
+        {
+            text << name << "_bucket{operation=\"" << operation << "\",le=\""
+                 << bound / 1e9 << "\"} " << latency.count_at_most(bound)
+                 << "\n";
+        }
+        text << name << "_bucket{operation=\"" << operation
+             << "\",le=\"+Inf\"} " << latency.count() << "\n"
+             << name << "_sum{operation=\"" << operation << "\"} "
+             << latency.sum() / 1e9 << "\n"
+             << name << "_count{operation=\"" << operation << "\"} "
+             << latency.count() << "\n";
+    }
+    out << text.str();
+}
+
+void write_prometheus(const std::string& path, const Telemetry& telemetry)
+{
+    const std::string temporary_path = path + ".tmp";
+    {
+        std::ofstream out{temporary_path};
+        write_prometheus(out, telemetry);
+        out.close();
+        if (!out)
+            throw std::runtime_error("Cannot write " + temporary_path);
+    }
+#if defined(_WIN32)
+    // Renaming does not replace an existing file here.
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary_path.c_str());
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "game.h"
+#include "latency.h"
+
+// The build defines WUMPUS_TELEMETRY to 1 to count what games do. Otherwise
+// the hooks the game calls are empty and compile to nothing.
+#ifndef WUMPUS_TELEMETRY
+#define WUMPUS_TELEMETRY 0
+#endif
+
+namespace wumpus {
+
+const bool telemetry_enabled = WUMPUS_TELEMETRY != 0;
+
+enum class Timed_operation : std::uint8_t
+{
+    init_hunt,
+    move,
+    shoot
+};
+
+const int num_timed_operations = static_cast<int>(Timed_operation::shoot) + 1;
+
+// Returns the name of the given operation, such as "init_hunt".
+const char* timed_operation_name(Timed_operation operation);
+
+// What the games have done: hunts started and how they ended, turns taken,
+// bat carries, wumpus moves and arrows shot, and how long each timed
+// operation took. Counts from separate threads merge by adding.
+struct Telemetry
+{
+    std::uint64_t hunts{0};
+    std::array<std::uint64_t, num_game_states> outcomes{};
+    std::uint64_t turns{0};
+    std::uint64_t bat_carries{0};
+    std::uint64_t wumpus_moves{0};
+    std::uint64_t arrows_used{0};
+    std::array<Latency_histogram, num_timed_operations> latency;
+
+    void merge(const Telemetry& other);
+    void clear();
+};
+
+// Each thread counts into its own Telemetry, without sharing cache lines or
+// locking, and adds it to the shared totals when it exits. Returns the shared
+// totals together with the counts of the calling thread.
+Telemetry telemetry_snapshot();
+
+// Adds the counts of the calling thread to the shared totals and clears them,
+// so that snapshots taken on other threads see them. Threads that live for
+// long call this from time to time.
+void flush_telemetry();
+
+// Writes the telemetry in the Prometheus text exposition format. The
+// latencies become histograms in seconds.
+void write_prometheus(std::ostream& out, const Telemetry& telemetry);
+
+// Writes the telemetry to a file in the same format, through a temporary file
+// renamed over it, so that a collector never reads half a file. Throws
+// std::runtime_error if it cannot be written.
+void write_prometheus(const std::string& path, const Telemetry& telemetry);
+
+namespace telemetry {
+
+#if WUMPUS_TELEMETRY
+
+Telemetry& local();
+
+inline void count_hunt()
+{
+    ++local().hunts;
+}
+
+inline void count_bat_carry()
+{
+    ++local().bat_carries;
+}
+
+inline void count_wumpus_move()
+{
+    ++local().wumpus_moves;
+}
+
+inline void count_arrow()
+{
+    ++local().arrows_used;
+}
+
+// Counts a turn as it goes out of scope, and its outcome if it ended the
+// hunt. Actions on a hunt that is already over count for nothing, so each
+// hunt's outcome counts once.
+class Turn
+{
+public:
+    explicit Turn(const Game_state& state)
+        : state{state}, is_hunt_on{state == Game_state::none}
+    {
+    }
+
+    ~Turn()
+    {
+        if (!is_hunt_on)
+            return;
+        Telemetry& counts = local();
+        ++counts.turns;
+        if (state != Game_state::none)
+            ++counts.outcomes[static_cast<int>(state)];
+    }
+
+    Turn(const Turn&) = delete;
+    Turn& operator=(const Turn&) = delete;
+
+private:
+    const Game_state& state;
+    const bool is_hunt_on;
+};
+
+// Times an operation from construction to destruction.
+class Timer
+{
+public:
+    explicit Timer(Timed_operation operation)
+        : operation{operation}, start{std::chrono::steady_clock::now()}
+    {
+    }
+
+    ~Timer()
+    {
+        const std::chrono::steady_clock::duration elapsed =
+            std::chrono::steady_clock::now() - start;
+        local().latency[static_cast<int>(operation)].record(
+            static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                    .count()));
+    }
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+private:
+    const Timed_operation operation;
+    const std::chrono::steady_clock::time_point start;
+};
+
+#else
+
+inline void count_hunt()
+{
+}
+
+inline void count_bat_carry()
+{
+}
+
+inline void count_wumpus_move()
+{
+}
+
+inline void count_arrow()
+{
+}
+
+class Turn
+{
+public:
+    explicit Turn(const Game_state&)
+    {
+    }
+};
+
+class Timer
+{
+public:
+    explicit Timer(Timed_operation)
+    {
+    }
+};
+
+#endif
+}
+}
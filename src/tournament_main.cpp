@@ -0,0 +1,216 @@
+// Plays agents against each other on the same seeded hunts across all cores
+// and reports each agent's win rate with a confidence interval, its turns
+// per hunt and its decisions per second.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "agent.h"
+#include "game.h"
+#include "random.h"
+
+using namespace wumpus;
+
+namespace {
+
+struct Options
+{
+    long long games{100000};
+    int threads{0};
+    int max_turns{1000};
+    std::uint64_t seed{random_seed()};
+    std::vector<std::string> agents{agent_names()};
+};
+
+struct Results
+{
+    std::array<long long, num_game_states> outcomes{};
+    long long turns{0};
+
+    void add(const Results& other)
+    {
+        for (int i = 0; i < num_game_states; ++i)
+            outcomes[i] += other.outcomes[i];
+        turns += other.turns;
+    }
+};
+
+// Plays hunts [first, last) with a new agent of the given name. Hunt i is
+// set up from the same seed for every agent.
+Results play(
+    const Options& options,
+    const std::string& name,
+    long long first,
+    long long last)
+{
+    std::unique_ptr<Agent> agent = make_agent(name);
+    Game game{*agent, 0};
+    Rng agent_rng{0};
+
+    Results results;
+    for (long long i = first; i < last; ++i)
+    {
+        const std::uint64_t seed = options.seed + 2 * i;
+        game.seed(seed);
+        agent_rng.seed(seed + 1);
+        game.init_hunt();
+        results.turns +=
+            play_hunt(game, *agent, agent_rng, options.max_turns);
+        ++results.outcomes[static_cast<int>(game.get_game_state())];
+    }
+    return results;
+}
+
+// Returns the 95% Wilson score interval of a proportion, which stays inside
+// [0, 1] and holds up for rates near either end.
+std::pair<double, double> wilson_interval(long long successes, long long trials)
+{
+    if (trials == 0)
+        return {0.0, 1.0};
+    const double z = 1.959963984540054;
+    const double n = static_cast<double>(trials);
+    const double p = successes / n;
+    const double denominator = 1 + z * z / n;
+    const double center = (p + z * z / (2 * n)) / denominator;
+    const double half_width =
+        z * std::sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / denominator;
+    return {std::max(0.0, center - half_width),
+            std::min(1.0, center + half_width)};
+}
+
+double percent(long long part, long long whole)
+{
+    return 100.0 * part / std::max(whole, 1LL);
+}
+
+std::vector<std::string> split_names(const std::string& list)
+{
+    std::vector<std::string> names;
+    std::stringstream ss{list};
+    std::string name;
+    while (std::getline(ss, name, ','))
+        names.push_back(name);
+    return names;
+}
+
+void print_usage()
+{
+    std::cerr << "Usage: wumpus_tournament [--games N] [--threads N] "
+                 "[--max-turns N] [--seed N]\n"
+                 "                         [--agents NAME,...]\n"
+                 "Agents:";
+    for (const std::string& name : agent_names())
+        std::cerr << " " << name;
+    std::cerr << std::endl;
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+            throw std::invalid_argument("Missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--games")
+            options.games = std::stoll(value);
+        else if (arg == "--threads")
+            options.threads = std::stoi(value);
+        else if (arg == "--max-turns")
+            options.max_turns = std::stoi(value);
+        else if (arg == "--seed")
+            options.seed = std::stoull(value);
+        else if (arg == "--agents")
+            options.agents = split_names(value);
+        else
+            throw std::invalid_argument("Unknown option: " + arg);
+    }
+    if (options.threads <= 0)
+        options.threads =
+            std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (options.games < 1 || options.agents.empty())
+        throw std::invalid_argument("Nothing to play");
+    for (const std::string& name : options.agents)
+        make_agent(name); // Validate the names before starting.
+    return options;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        options = parse_options(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "threads: " << options.threads << std::endl
+              << "seed: " << options.seed << std::endl
+              << "games: " << options.games << std::endl;
+
+    // The agents take turns, each playing every hunt on all cores, so that
+    // the time of each is its own.
+    for (const std::string& name : options.agents)
+    {
+        std::vector<Results> results(options.threads);
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < options.threads; ++i)
+        {
+            long long first = options.games * i / options.threads;
+            long long last = options.games * (i + 1) / options.threads;
+            threads.emplace_back([&options, &results, &name, i, first, last]() {
+                results[i] = play(options, name, first, last);
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        Results total;
+        for (const Results& result : results)
+            total.add(result);
+        const long long wins =
+            total.outcomes[static_cast<int>(Game_state::wumpus_dead)];
+        const std::pair<double, double> interval =
+            wilson_interval(wins, options.games);
+
+        std::cout << "agent: " << name << std::endl
+                  << std::fixed << std::setprecision(2) << "    win_rate: "
+                  << percent(wins, options.games) << "% (95% CI "
+                  << 100 * interval.first << "% to " << 100 * interval.second
+                  << "%)" << std::endl;
+        for (int i = 1; i < num_game_states; ++i)
+        {
+            std::cout << "    " << game_state_name(static_cast<Game_state>(i))
+                      << ": " << total.outcomes[i] << " ("
+                      << percent(total.outcomes[i], options.games) << "%)"
+                      << std::endl;
+        }
+        std::cout << "    turns/game: "
+                  << static_cast<double>(total.turns) / options.games
+                  << std::endl
+                  << "    decisions/sec: " << std::setprecision(0)
+                  << total.turns / elapsed.count() << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// The checks of the tests: each failed CHECK prints its expression and
+// location, and finish() turns the count of failures into the exit status.
+
+namespace wumpus {
+namespace test {
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline void check(
+    bool condition, const char* expression, const char* file, int line)
+{
+    if (condition)
+        return;
+    ++failures();
+    std::cerr << file << ":" << line << ": check failed: " << expression
+              << std::endl;
+}
+
+// Returns whether calling f throws an Exception.
+template <typename Exception, typename F>
+bool throws(F&& f)
+{
+    try
+    {
+        f();
+    }
+    catch (const Exception&)
+    {
+        return true;
+    }
+    return false;
+}
+
+inline int finish()
+{
+    if (failures() == 0)
+        return EXIT_SUCCESS;
+    std::cerr << failures() << " checks failed" << std::endl;
+    return EXIT_FAILURE;
+}
+}
+}
+
+// Variadic, so that braced lists with commas can appear in the condition.
+#define CHECK(...) \
+    ::wumpus::test::check((__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
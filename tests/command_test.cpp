@@ -0,0 +1,201 @@
+// Checks the parsing of the text commands and of scripts of hunts, at the
+// edges: missing and extra rooms, rooms out of range, numbers too long to
+// fit, and the blanks and line endings of files written anywhere.
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "check.h"
+#include "command.h"
+#include "events.h"
+#include "game.h"
+
+using namespace wumpus;
+
+namespace {
+
+bool parse(const char* text, Command& command)
+{
+    return parse_command(text, text + std::strlen(text), command);
+}
+
+bool parses(const char* text)
+{
+    Command command;
+    return parse(text, command);
+}
+
+bool parses_to(
+    const char* text,
+    Command::Type type,
+    const std::array<int, arrow_range>& targets)
+{
+    Command command;
+    return parse(text, command) && command.type == type &&
+        command.targets == targets;
+}
+
+bool number(const char* word, std::uint64_t& value)
+{
+    return parse_number(word, static_cast<int>(std::strlen(word)), value);
+}
+
+void check_numbers()
+{
+    std::uint64_t value = 0;
+    CHECK(number("0", value) && value == 0);
+    CHECK(number("42", value) && value == 42);
+    CHECK(number("9999999999999999999", value) &&
+          value == 9999999999999999999ULL);
+    CHECK(!number("12345678901234567890", value));
+    CHECK(!number("", value));
+    CHECK(!number("4a", value));
+    CHECK(!number("-1", value));
+}
+
+void check_words()
+{
+    const char* text = " \tm  7\r";
+    const char* begin = text;
+    const char* end = text + std::strlen(text);
+    const char* word;
+    int size;
+    CHECK(next_word(begin, end, word, size) && size == 1 && *word == 'm');
+    CHECK(next_word(begin, end, word, size) && size == 1 && *word == '7');
+    CHECK(!next_word(begin, end, word, size));
+    CHECK(begin == end);
+}
+
+void check_commands()
+{
+    const Command::Type move = Command::Type::move;
+    const Command::Type shoot = Command::Type::shoot;
+    const Command::Type quit = Command::Type::quit;
+
+    CHECK(parses_to("m 7", move, {{7, -1, -1}}));
+    CHECK(parses_to("m 1", move, {{1, -1, -1}}));
+    CHECK(parses_to("m 20", move, {{20, -1, -1}}));
+    CHECK(parses_to("  m\t7  ", move, {{7, -1, -1}}));
+    CHECK(parses_to("m 7\r", move, {{7, -1, -1}}));
+    CHECK(!parses("m"));
+    CHECK(!parses("m 0"));
+    CHECK(!parses("m 21"));
+    CHECK(!parses("m 7 8"));
+    CHECK(!parses("m -1"));
+    CHECK(!parses("m x"));
+    CHECK(!parses("m 12345678901234567890"));
+
+    CHECK(parses_to("s 3", shoot, {{3, -1, -1}}));
+    CHECK(parses_to("s 3 12", shoot, {{3, 12, -1}}));
+    CHECK(parses_to("s 3 12 9", shoot, {{3, 12, 9}}));
+    CHECK(parses_to("s 3 12 9\r", shoot, {{3, 12, 9}}));
+    CHECK(!parses("s"));
+    CHECK(!parses("s 3 12 9 4"));
+    CHECK(!parses("s 0"));
+    CHECK(!parses("s 3 21"));
+
+    CHECK(parses_to("q", quit, {{-1, -1, -1}}));
+    CHECK(parses_to("q\r", quit, {{-1, -1, -1}}));
+    CHECK(!parses("q 1"));
+
+    CHECK(!parses(""));
+    CHECK(!parses("   "));
+    CHECK(!parses("x"));
+    CHECK(!parses("mm 7"));
+    CHECK(!parses("M 7"));
+
+    // A failed parse of a longer command leaves no stale rooms behind.
+    Command command;
+    CHECK(parse("s 1 2 3", command));
+    CHECK(parse("m 4", command));
+    CHECK(command.targets == (std::array<int, arrow_range>{{4, -1, -1}}));
+}
+
+void check_apply()
+{
+    Null_event_sink sink;
+    Basic_game<Null_event_sink> game{sink, 1};
+    game.init_hunt();
+    const Hunt_state& hunt = game.get_state();
+    const int room = hunt.player_room();
+
+    Command command;
+    command.type = Command::Type::move;
+    // The number of the player's own room is never adjacent.
+    command.targets = {{hunt.numbers[room], -1, -1}};
+    CHECK(!apply_command(game, command));
+    CHECK(game.get_player_room() == room);
+
+    command.type = Command::Type::quit;
+    CHECK(apply_command(game, command));
+    CHECK(game.get_game_state() == Game_state::player_quit);
+}
+
+using Line_type = Script_reader::Line_type;
+
+void check_scripts()
+{
+    const std::string script = "# a comment\r\n"
+                               "\r\n"
+                               "g 42\r\n"
+                               "m 7\r\n"
+                               "  \t\n"
+                               "g\n"
+                               "s 1 2\n"
+                               "q";
+    Script_reader reader{script.data(), script.data() + script.size()};
+    bool has_seed = false;
+    std::uint64_t seed = 0;
+    Command command;
+    CHECK(reader.next(has_seed, seed, command) == Line_type::game);
+    CHECK(has_seed && seed == 42);
+    CHECK(reader.line_number() == 3);
+    CHECK(reader.next(has_seed, seed, command) == Line_type::command);
+    CHECK(command.type == Command::Type::move && command.targets[0] == 7);
+    CHECK(reader.next(has_seed, seed, command) == Line_type::game);
+    CHECK(!has_seed);
+    CHECK(reader.line_number() == 6);
+    CHECK(reader.next(has_seed, seed, command) == Line_type::command);
+    CHECK(command.type == Command::Type::shoot);
+    CHECK(reader.next(has_seed, seed, command) == Line_type::command);
+    CHECK(command.type == Command::Type::quit);
+    CHECK(reader.line_number() == 8);
+    CHECK(reader.next(has_seed, seed, command) == Line_type::end);
+    CHECK(reader.next(has_seed, seed, command) == Line_type::end);
+
+    const char* malformed[] = {
+        "g x", "g 1 2", "g 12345678901234567890", "m 21", "s", "hello"};
+    for (const char* line : malformed)
+    {
+        const std::string text = std::string{"m 1\n"} + line + "\nm 2\n";
+        Script_reader bad{text.data(), text.data() + text.size()};
+        CHECK(bad.next(has_seed, seed, command) == Line_type::command);
+        bool is_reported = false;
+        try
+        {
+            bad.next(has_seed, seed, command);
+        }
+        catch (const std::runtime_error& e)
+        {
+            is_reported = std::string{e.what()}.compare(0, 7, "Line 2:") == 0;
+        }
+        CHECK(is_reported);
+    }
+
+    Script_reader empty{script.data(), script.data()};
+    CHECK(empty.next(has_seed, seed, command) == Line_type::end);
+    CHECK(empty.line_number() == 0);
+}
+}
+
+int main()
+{
+    check_numbers();
+    check_words();
+    check_commands();
+    check_apply();
+    check_scripts();
+    return test::finish();
+}
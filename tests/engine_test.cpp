@@ -0,0 +1,276 @@
+// Checks that every cave engine plays the same hunts from the same seeds:
+// Basic_cave_game in a Cave, the Static_cave_game specialized for it, and the
+// hunt lanes with each kernel the processor has. The engines are stepped side
+// by side through random actions, allowed or not, and compared after each.
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "cave.h"
+#include "cave_game.h"
+#include "check.h"
+#include "events.h"
+#include "game.h"
+#include "hunt_lanes.h"
+#include "random.h"
+#include "static_cave_game.h"
+
+using namespace wumpus;
+
+namespace {
+
+using Dodecahedron_game =
+    Static_cave_game<Dodecahedron_topology, Classic_rules, Null_event_sink>;
+
+const int hunts_per_cave = 20000;
+
+struct Action
+{
+    enum class Type
+    {
+        move,
+        shoot,
+        quit
+    } type{Type::quit};
+    std::array<int, arrow_range> path{{-1, -1, -1}};
+};
+
+// Mostly moves to adjacent rooms, with some shots, quits and moves that are
+// not allowed, including to rooms that do not exist.
+Action random_action(const Cave& cave, int player_room, Rng& rng)
+{
+    Action action;
+    const int choice = rng.uniform(0, 100);
+    if (choice < 3)
+        return action;
+    if (choice < 18)
+    {
+        action.type = Action::Type::shoot;
+        for (int& room : action.path)
+            room = rng.uniform(0, cave.num_rooms() + 2) - 1;
+        if (rng.uniform(0, 2))
+        {
+            const Cave::Adjacent_rooms rooms =
+                cave.adjacent_rooms(player_room);
+            action.path[0] = rooms[rng.uniform(0, rooms.size())];
+        }
+        return action;
+    }
+    action.type = Action::Type::move;
+    if (choice < 30)
+    {
+        action.path[0] = rng.uniform(0, cave.num_rooms() + 2) - 1;
+        return action;
+    }
+    const Cave::Adjacent_rooms rooms = cave.adjacent_rooms(player_room);
+    action.path[0] = rooms[rng.uniform(0, rooms.size())];
+    return action;
+}
+
+template <typename Game>
+void apply(Game& game, const Action& action)
+{
+    switch (action.type)
+    {
+    case Action::Type::move:
+        if (game.can_move(action.path[0]))
+            game.move(action.path[0]);
+        break;
+    case Action::Type::shoot:
+        if (game.can_shoot(action.path))
+            game.shoot(action.path);
+        break;
+    case Action::Type::quit:
+        game.quit();
+        break;
+    }
+}
+
+template <typename A, typename B>
+bool same_percepts(const A& a, const B& b)
+{
+    const Percepts first = a.get_percepts();
+    const Percepts second = b.get_percepts();
+    return first.wumpus == second.wumpus && first.bat == second.bat &&
+        first.pit == second.pit;
+}
+
+template <typename A, typename B>
+bool same_hunt(const A& a, const B& b)
+{
+    return a.get_player_room() == b.get_player_room() &&
+        a.get_wumpus_room() == b.get_wumpus_room() &&
+        a.get_game_state() == b.get_game_state() &&
+        a.get_arrows() == b.get_arrows() && same_percepts(a, b);
+}
+
+template <typename Static_game>
+bool same_hazards(const Silent_cave_game& game, const Static_game& other)
+{
+    std::uint64_t bats = 0;
+    for (int room : game.get_bat_rooms())
+        bats |= std::uint64_t{1} << room;
+    std::uint64_t pits = 0;
+    for (int room : game.get_pit_rooms())
+        pits |= std::uint64_t{1} << room;
+    return bats == other.get_bat_mask() && pits == other.get_pit_mask();
+}
+
+// Plays the generic and the specialized engine side by side.
+template <typename Topology>
+void check_static_engine(const Cave& cave)
+{
+    Null_event_sink sink;
+    Silent_cave_game generic{cave, sink, Cave_rules{}, 0};
+    Static_cave_game<Topology, Classic_rules, Null_event_sink> specialized{
+        sink, 0};
+    Rng rng{3};
+    int mismatches = 0;
+    for (int hunt = 0; hunt < hunts_per_cave; ++hunt)
+    {
+        const std::uint64_t seed = 2 * static_cast<std::uint64_t>(hunt);
+        generic.seed(seed);
+        specialized.seed(seed);
+        generic.init_hunt();
+        specialized.init_hunt();
+        if (!same_hunt(generic, specialized) ||
+            !same_hazards(generic, specialized))
+        {
+            ++mismatches;
+            continue;
+        }
+        while (!generic.is_hunt_over())
+        {
+            const Action action =
+                random_action(cave, generic.get_player_room(), rng);
+            apply(generic, action);
+            apply(specialized, action);
+            if (!same_hunt(generic, specialized))
+            {
+                ++mismatches;
+                break;
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+bool same_lane(
+    const Hunt_lanes& lanes,
+    const std::int32_t* percepts,
+    int lane,
+    const Dodecahedron_game& game)
+{
+    const Percepts expected = game.get_percepts();
+    const std::int32_t expected_percepts =
+        (expected.wumpus ? wumpus_percept : 0) |
+        (expected.bat ? bat_percept : 0) | (expected.pit ? pit_percept : 0);
+    return lanes.player_room[lane] == game.get_player_room() &&
+        lanes.wumpus_room[lane] == game.get_wumpus_room() &&
+        lanes.bats[lane] == game.get_bat_mask() &&
+        lanes.pits[lane] == game.get_pit_mask() &&
+        lanes.state[lane] == static_cast<int>(game.get_game_state()) &&
+        lanes.arrows[lane] == game.get_arrows() &&
+        percepts[lane] == expected_percepts;
+}
+
+// Plays eight hunts at a time in lanes, each beside a specialized game of
+// the original cave. A lane whose hunt ends starts the next one.
+void check_lanes(Lane_kernel kernel)
+{
+    const Cave cave = Cave::dodecahedron();
+    Null_event_sink sink;
+    std::vector<Dodecahedron_game> games(num_lanes, Dodecahedron_game{sink, 0});
+    Hunt_lanes lanes{};
+    Lane_actions actions{};
+    std::int32_t percepts[num_lanes];
+    Rng rng{5};
+    int next_hunt = 0;
+    int mismatches = 0;
+    std::uint32_t running = 0;
+    while (true)
+    {
+        std::uint32_t starting = 0;
+        for (int lane = 0; lane < num_lanes; ++lane)
+        {
+            if (running & 1u << lane || next_hunt >= hunts_per_cave)
+                continue;
+            const std::uint64_t seed =
+                2 * static_cast<std::uint64_t>(next_hunt++);
+            seed_lane(lanes.rngs, lane, seed);
+            games[lane].seed(seed);
+            games[lane].init_hunt();
+            starting |= 1u << lane;
+        }
+        init_hunts(kernel, lanes, starting);
+        running |= starting;
+        if (!running)
+            break;
+
+        get_percepts(kernel, lanes, percepts);
+        for (int lane = 0; lane < num_lanes; ++lane)
+        {
+            actions.type[lane] = Lane_action::none;
+            if (!(running & 1u << lane))
+                continue;
+            if (!same_lane(lanes, percepts, lane, games[lane]))
+                ++mismatches;
+            const Action action =
+                random_action(cave, games[lane].get_player_room(), rng);
+            apply(games[lane], action);
+            actions.type[lane] = action.type == Action::Type::move
+                ? Lane_action::move
+                : action.type == Action::Type::shoot ? Lane_action::shoot
+                                                     : Lane_action::quit;
+            for (int i = 0; i < arrow_range; ++i)
+                actions.path[i][lane] = action.path[i];
+        }
+        step(kernel, lanes, actions);
+
+        get_percepts(kernel, lanes, percepts);
+        for (int lane = 0; lane < num_lanes; ++lane)
+        {
+            if (!(running & 1u << lane))
+                continue;
+            if (!same_lane(lanes, percepts, lane, games[lane]))
+                ++mismatches;
+            if (games[lane].is_hunt_over())
+                running &= ~(1u << lane);
+        }
+    }
+    CHECK(next_hunt == hunts_per_cave);
+    CHECK(mismatches == 0);
+}
+}
+
+// Rules the cave cannot hold are refused before anything is allocated.
+void check_rules()
+{
+    const Cave cave = Cave::dodecahedron();
+    Null_event_sink sink;
+    const Cave_rules rejected[] = {
+        {-1, num_pits, num_arrows},
+        {num_bats, -3, num_arrows},
+        {num_bats, num_pits, -1},
+        {9, 10, num_arrows}};
+    for (const Cave_rules& rules : rejected)
+        CHECK(test::throws<std::invalid_argument>(
+            [&]() { Silent_cave_game{cave, sink, rules, 0}; }));
+    Silent_cave_game full{cave, sink, Cave_rules{9, 9, 0}, 0};
+    full.init_hunt();
+    CHECK(full.get_arrows() == 0 && full.get_bat_rooms().size() == 9);
+}
+
+int main()
+{
+    check_rules();
+    check_static_engine<Dodecahedron_topology>(Cave::dodecahedron());
+    check_static_engine<Torus_4x4_topology>(Cave::torus(4, 4));
+    check_static_engine<Torus_8x8_topology>(Cave::torus(8, 8));
+    check_lanes(Lane_kernel::scalar);
+    if (best_lane_kernel() != Lane_kernel::scalar)
+        check_lanes(best_lane_kernel());
+    return test::finish();
+}
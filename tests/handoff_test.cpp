@@ -0,0 +1,177 @@
+// Checks the lock-free handoffs between threads: the single producer, single
+// consumer queue around its wraparound and across two threads, and the
+// snapshot buffer's latest-wins handoff of whole snapshots.
+
+#include <array>
+#include <cstdint>
+#include <thread>
+
+#include "check.h"
+#include "snapshot_buffer.h"
+#include "spsc_queue.h"
+
+using namespace wumpus;
+
+namespace {
+
+void check_queue_wraparound()
+{
+    Spsc_queue<int, 4> queue;
+    int value = -1;
+    CHECK(queue.empty());
+    CHECK(!queue.pop(value));
+
+    // The indices pass the capacity many times over at every fill level.
+    int next_push = 0;
+    int next_pop = 0;
+    for (int round = 0; round < 1000; ++round)
+    {
+        const int fill = round % 5;
+        for (int i = 0; i < fill; ++i)
+            CHECK(queue.push(next_push++));
+        if (fill == 4)
+            CHECK(!queue.push(-1));
+        for (int i = 0; i < fill; ++i)
+        {
+            CHECK(queue.pop(value));
+            CHECK(value == next_pop++);
+        }
+        CHECK(queue.empty());
+        CHECK(!queue.pop(value));
+    }
+
+    // Full, then half drained and refilled, keeps the order.
+    for (int i = 0; i < 4; ++i)
+        CHECK(queue.push(next_push++));
+    CHECK(!queue.push(-1));
+    for (int i = 0; i < 2; ++i)
+    {
+        CHECK(queue.pop(value));
+        CHECK(value == next_pop++);
+    }
+    for (int i = 0; i < 2; ++i)
+        CHECK(queue.push(next_push++));
+    CHECK(!queue.push(-1));
+    while (queue.pop(value))
+        CHECK(value == next_pop++);
+    CHECK(next_pop == next_push);
+}
+
+// Every value pushed on one thread pops on the other, once and in order.
+void check_queue_threads()
+{
+    const std::uint64_t count = 2000000;
+    Spsc_queue<std::uint64_t, 64> queue;
+    std::thread producer{[&queue, count]() {
+        for (std::uint64_t i = 0; i < count; ++i)
+            while (!queue.push(i))
+                std::this_thread::yield();
+    }};
+    std::uint64_t expected = 0;
+    bool is_ordered = true;
+    while (expected < count)
+    {
+        std::uint64_t value;
+        if (!queue.pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        is_ordered = is_ordered && value == expected;
+        ++expected;
+    }
+    producer.join();
+    CHECK(is_ordered);
+    CHECK(queue.empty());
+}
+
+struct Snapshot
+{
+    std::uint64_t version{0};
+    // Each a function of the version, so that a torn snapshot shows.
+    std::array<std::uint64_t, 15> values{};
+
+    void fill(std::uint64_t new_version)
+    {
+        version = new_version;
+        for (std::size_t i = 0; i < values.size(); ++i)
+            values[i] = new_version * 31 + i;
+    }
+
+    bool is_whole() const
+    {
+        for (std::size_t i = 0; i < values.size(); ++i)
+            if (values[i] != version * 31 + i)
+                return false;
+        return true;
+    }
+};
+
+void check_snapshots()
+{
+    Snapshot_buffer<Snapshot> buffer;
+    CHECK(!buffer.update());
+
+    buffer.back().fill(1);
+    buffer.publish();
+    CHECK(buffer.update());
+    CHECK(buffer.front().version == 1);
+    CHECK(!buffer.update());
+    CHECK(buffer.front().version == 1);
+
+    // The reader skips to the latest of several.
+    for (std::uint64_t version = 2; version <= 5; ++version)
+    {
+        buffer.back().fill(version);
+        buffer.publish();
+    }
+    CHECK(buffer.update());
+    CHECK(buffer.front().version == 5);
+    CHECK(buffer.front().is_whole());
+    CHECK(!buffer.update());
+}
+
+// The reader sees whole snapshots, never older than the last it took, and
+// the last one published.
+void check_snapshot_threads()
+{
+    const std::uint64_t count = 1000000;
+    Snapshot_buffer<Snapshot> buffer;
+    std::thread writer{[&buffer, count]() {
+        for (std::uint64_t version = 1; version <= count; ++version)
+        {
+            buffer.back().fill(version);
+            buffer.publish();
+        }
+    }};
+    std::uint64_t last = 0;
+    bool is_whole = true;
+    bool is_monotonic = true;
+    while (last < count)
+    {
+        if (!buffer.update())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        const Snapshot& snapshot = buffer.front();
+        is_whole = is_whole && snapshot.is_whole();
+        is_monotonic = is_monotonic && snapshot.version > last;
+        last = snapshot.version;
+    }
+    writer.join();
+    CHECK(is_whole);
+    CHECK(is_monotonic);
+    CHECK(last == count);
+    CHECK(!buffer.update());
+}
+}
+
+int main()
+{
+    check_queue_wraparound();
+    check_queue_threads();
+    check_snapshots();
+    check_snapshot_threads();
+    return test::finish();
+}
@@ -0,0 +1,297 @@
+// Checks that replay logs read back as written: hunts recorded from play,
+// records long enough to need several bytes of length, every truncation of a
+// log, and splitting a log into runs.
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "events.h"
+#include "game.h"
+#include "random.h"
+#include "replay.h"
+
+using namespace wumpus;
+
+namespace {
+
+const char* const log_path = "replay_test.log";
+const char* const damaged_path = "replay_test_damaged.log";
+
+struct Recorded_hunt
+{
+    std::uint64_t seed;
+    Game_state outcome;
+    std::vector<Replay_action> actions;
+};
+
+// Plays hunts with random actions, rejected ones included, and records the
+// accepted ones.
+std::vector<Recorded_hunt> record_hunts(int count, Replay_recorder& recorder)
+{
+    Null_event_sink sink;
+    Silent_game game{sink};
+    Rng rng{7};
+    std::vector<Recorded_hunt> hunts;
+    for (int i = 0; i < count; ++i)
+    {
+        Recorded_hunt hunt{1000 + 2 * static_cast<std::uint64_t>(i), {}, {}};
+        game.seed(hunt.seed);
+        game.init_hunt();
+        recorder.begin(hunt.seed, game.get_state());
+        while (!game.is_hunt_over())
+        {
+            Replay_action action;
+            const int choice = rng.uniform(0, 20);
+            if (choice == 0)
+            {
+                action.type = Replay_action::Type::quit;
+                game.quit();
+                recorder.quit();
+            }
+            else if (choice < 4)
+            {
+                action.type = Replay_action::Type::shoot;
+                const int length = rng.uniform(1, arrow_range + 1);
+                for (int j = 0; j < length; ++j)
+                    action.targets[j] = rng.uniform(1, num_rooms + 1);
+                if (!game.can_shoot(action.targets))
+                    continue;
+                game.shoot(action.targets);
+                recorder.shoot(action.targets);
+            }
+            else
+            {
+                action.type = Replay_action::Type::move;
+                action.targets[0] = rng.uniform(1, num_rooms + 1);
+                if (!game.can_move(action.targets[0]))
+                    continue;
+                game.move(action.targets[0]);
+                recorder.move(action.targets[0]);
+            }
+            hunt.actions.push_back(action);
+        }
+        hunt.outcome = game.get_game_state();
+        recorder.end(hunt.outcome);
+        hunts.push_back(hunt);
+    }
+    return hunts;
+}
+
+bool same_action(const Replay_action& a, const Replay_action& b)
+{
+    return a.type == b.type && a.targets == b.targets;
+}
+
+void write_log(const char* path, const std::vector<std::uint8_t>& records)
+{
+    std::remove(path);
+    Replay_writer writer{path};
+    writer.write(records);
+    writer.flush();
+}
+
+std::vector<char> read_file(const char* path)
+{
+    std::ifstream in{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{in}, {}};
+}
+
+void write_file(const char* path, const std::vector<char>& bytes)
+{
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Reads every record of the log and returns how many there were.
+int count_records(const char* path)
+{
+    Replay_reader reader{path};
+    std::size_t offset = reader.begin();
+    Replay_record record;
+    int count = 0;
+    while (reader.next(offset, record))
+    {
+        std::size_t action_offset = 0;
+        Replay_action action;
+        while (record.next_action(action_offset, action))
+        {
+        }
+        ++count;
+    }
+    return count;
+}
+
+void check_played_hunts()
+{
+    Replay_recorder recorder;
+    const std::vector<Recorded_hunt> hunts = record_hunts(2000, recorder);
+    write_log(log_path, recorder.data());
+
+    Replay_reader reader{log_path};
+    Null_event_sink sink;
+    Silent_game game{sink};
+    std::size_t offset = reader.begin();
+    Replay_record record;
+    for (const Recorded_hunt& hunt : hunts)
+    {
+        CHECK(reader.next(offset, record));
+        CHECK(record.seed == hunt.seed);
+        CHECK(record.outcome == hunt.outcome);
+        std::size_t action_offset = 0;
+        Replay_action action;
+        for (const Replay_action& expected : hunt.actions)
+        {
+            CHECK(record.next_action(action_offset, action));
+            CHECK(same_action(action, expected));
+        }
+        CHECK(!record.next_action(action_offset, action));
+        CHECK(replay(record, game));
+    }
+    CHECK(!reader.next(offset, record));
+    CHECK(offset == reader.size());
+}
+
+// Records of 128 bytes or more take two bytes of length, and of 16384 bytes
+// or more three. The actions need not be playable to be read back.
+void check_long_records()
+{
+    Null_event_sink sink;
+    Silent_game game{sink};
+    game.seed(1);
+    game.init_hunt();
+    Replay_recorder recorder;
+    const int lengths[] = {0, 100, 119, 120, 500, 16400, 40000};
+    for (int length : lengths)
+    {
+        recorder.begin(static_cast<std::uint64_t>(length), game.get_state());
+        for (int i = 0; i < length; ++i)
+            recorder.move(i % num_rooms + 1);
+        recorder.end(Game_state::player_quit);
+    }
+    write_log(log_path, recorder.data());
+
+    Replay_reader reader{log_path};
+    std::size_t offset = reader.begin();
+    Replay_record record;
+    for (int length : lengths)
+    {
+        CHECK(reader.next(offset, record));
+        CHECK(record.seed == static_cast<std::uint64_t>(length));
+        CHECK(record.actions_size == static_cast<std::size_t>(length));
+        std::size_t action_offset = 0;
+        Replay_action action;
+        int count = 0;
+        while (record.next_action(action_offset, action))
+        {
+            CHECK(action.type == Replay_action::Type::move);
+            CHECK(action.targets[0] == count % num_rooms + 1);
+            ++count;
+        }
+        CHECK(count == length);
+    }
+    CHECK(!reader.next(offset, record));
+}
+
+// Cutting a log short anywhere but between records must be reported, not
+// read past the end.
+void check_truncated_logs()
+{
+    Replay_recorder recorder;
+    record_hunts(20, recorder);
+    write_log(log_path, recorder.data());
+    const std::vector<char> bytes = read_file(log_path);
+    const int num_records = count_records(log_path);
+    CHECK(num_records == 20);
+
+    // The ends of the records, found by reading the whole log.
+    std::vector<std::size_t> record_ends;
+    {
+        Replay_reader reader{log_path};
+        std::size_t offset = reader.begin();
+        Replay_record record;
+        while (reader.next(offset, record))
+            record_ends.push_back(offset);
+    }
+
+    for (std::size_t size = 0; size < bytes.size(); ++size)
+    {
+        write_file(
+            damaged_path,
+            std::vector<char>{bytes.begin(), bytes.begin() + size});
+        if (size < 8)
+        {
+            CHECK(test::throws<std::runtime_error>(
+                [] { Replay_reader reader{damaged_path}; }));
+            continue;
+        }
+        int whole = 0;
+        bool is_boundary = size == 8;
+        for (std::size_t end : record_ends)
+        {
+            whole += end <= size;
+            is_boundary = is_boundary || end == size;
+        }
+        if (is_boundary)
+            CHECK(count_records(damaged_path) == whole);
+        else
+            CHECK(test::throws<std::runtime_error>(
+                [] { count_records(damaged_path); }));
+    }
+
+    // A length whose continuation bit is set on the last byte.
+    std::vector<char> damaged{bytes.begin(), bytes.begin() + 8};
+    damaged.push_back(static_cast<char>(0x80));
+    write_file(damaged_path, damaged);
+    CHECK(test::throws<std::runtime_error>(
+        [] { count_records(damaged_path); }));
+
+    // A log with the wrong magic string.
+    damaged = bytes;
+    damaged[0] = 'X';
+    write_file(damaged_path, damaged);
+    CHECK(test::throws<std::runtime_error>(
+        [] { Replay_reader reader{damaged_path}; }));
+}
+
+void check_split()
+{
+    Replay_recorder recorder;
+    record_hunts(500, recorder);
+    write_log(log_path, recorder.data());
+    Replay_reader reader{log_path};
+    for (int parts = 1; parts <= 16; ++parts)
+    {
+        const std::vector<std::size_t> bounds = reader.split(parts);
+        CHECK(bounds.size() == static_cast<std::size_t>(parts) + 1);
+        CHECK(bounds.front() == reader.begin());
+        CHECK(bounds.back() == reader.size());
+        int count = 0;
+        for (int i = 0; i < parts; ++i)
+        {
+            std::size_t offset = bounds[i];
+            Replay_record record;
+            while (offset < bounds[i + 1] && reader.next(offset, record))
+                ++count;
+            CHECK(offset == bounds[i + 1]);
+        }
+        CHECK(count == 500);
+    }
+}
+}
+
+int main()
+{
+    check_played_hunts();
+    check_long_records();
+    check_truncated_logs();
+    check_split();
+    std::remove(log_path);
+    std::remove(damaged_path);
+    return test::finish();
+}